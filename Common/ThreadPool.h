@@ -3,175 +3,457 @@
 
 #include <sched.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
-#include <map>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "OpenMP.h"
+
 namespace DP3
 {
 
+/**
+ * A thread pool with work stealing.
+ *
+ * The threads are created once, when constructing the pool. A call to
+ * For() splits the range in chunks (of 'grain size' iterations) that are
+ * put in the queue of the calling thread. The calling thread takes part in
+ * the work by taking chunks from the back of its own queue, while idle
+ * threads steal chunks from the front of the queues of other threads.
+ * Every queue has its own mutex, so threads hardly ever wait for each other.
+ *
+ * For() can be called from inside a For() loop (nested parallelism). The
+ * thread executing the outer iteration then executes or waits for the
+ * chunks of the inner loop, while the idle threads steal the rest.
+ *
+ * A thread that is not part of the pool gets thread index 0. When several
+ * such threads (e.g. the threads of a pipelined run) call For() at the
+ * same time, they take turns: a loop started by one of them has to finish
+ * before the next one can start.
+ *
+ * All steps share a single process-wide pool, obtained with GetInstance(),
+ * so that the total number of threads is bounded. The time spent by the
+ * pool threads can be accounted per step by a CoreUsage counter (see
+ * UsageScope).
+ */
 class ThreadPool
 {
 public:
+	/**
+	 * Accumulates the time spent by pool threads in the loops of a step.
+	 */
+	class CoreUsage
+	{
+	public:
+		CoreUsage() : _nanoseconds(0) { }
+
+		/**
+		 * Total time in seconds that the pool threads (excluding the
+		 * thread that called For()) spent on the loops.
+		 */
+		double Seconds() const { return _nanoseconds.load() * 1e-9; }
+
+		/**
+		 * The average number of cores in use during the given time, which
+		 * is normally the time that the step's calling thread was busy.
+		 */
+		double Cores(double elapsed) const
+		{
+			return elapsed > 0.0 ? 1.0 + Seconds() / elapsed : 1.0;
+		}
+
+		void Add(std::chrono::steady_clock::duration d)
+		{
+			_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+		}
+
+	private:
+		std::atomic<long long> _nanoseconds;
+	};
+
+	/**
+	 * While an object of this class exists, the work done by pool threads
+	 * for loops started by the current thread is added to the given counter.
+	 * The counter is passed on to nested loops.
+	 */
+	class UsageScope
+	{
+	public:
+		UsageScope(CoreUsage& usage) :
+			_previous(threadState().usage)
+		{
+			threadState().usage = &usage;
+		}
+		~UsageScope()
+		{
+			threadState().usage = _previous;
+		}
+		UsageScope(const UsageScope&) = delete;
+		UsageScope& operator=(const UsageScope&) = delete;
+	private:
+		CoreUsage* _previous;
+	};
+
 	ThreadPool() :
 		_isStopped(false),
-		_priority(0)
+		_pendingTasks(0)
 	{
-		size_t nThreads = cpus();
-		
-		// We reserve one thread less, because we always want a new For loop
-		// to be able to add a new thread (with index 0).
-		_threads.reserve(nThreads-1);
-		for(size_t i=1; i!=nThreads; ++i)
-			_threads.emplace_back(&ThreadPool::threadFunc, this, i);
+		start(cpus());
 	}
-	
+
 	ThreadPool(size_t nThreads) :
 		_isStopped(false),
-		_priority(0)
+		_pendingTasks(0)
 	{
-		// We reserve one thread less, because we always want a new For loop
-		// to be able to add a new thread (with index 0).
-		_threads.reserve(nThreads-1);
-		for(size_t i=1; i!=nThreads; ++i)
-			_threads.emplace_back(&ThreadPool::threadFunc, this, i);
+		start(nThreads);
 	}
-	
+
 	ThreadPool(const ThreadPool&) = delete;
 	ThreadPool& operator=(const ThreadPool&) = delete;
-	
+
 	~ThreadPool()
 	{
 		std::unique_lock<std::mutex> lock(_mutex);
 		_isStopped = true;
-		_onProgress.notify_all();
+		_onChange.notify_all();
 		lock.unlock();
 		for(std::thread& t : _threads)
 			t.join();
 	}
-	
+
 	size_t NThreads() const
 	{
 		return _threads.size()+1;
 	}
-	
+
+	/**
+	 * The process-wide pool. It is created at first use with the number
+	 * of threads set by SetInstanceNThreads(), or the number of cpus.
+	 */
+	static ThreadPool& GetInstance()
+	{
+		std::lock_guard<std::mutex> lock(instanceMutex());
+		std::unique_ptr<ThreadPool>& instance = instancePtr();
+		if(!instance)
+			instance.reset(new ThreadPool(instanceNThreads() == 0 ? cpus() : instanceNThreads()));
+		return *instance;
+	}
+
+	/**
+	 * Set the number of threads of the process-wide pool. This is the
+	 * maximum number of threads that is used by all steps together.
+	 * If the pool already exists with a different number of threads, it is
+	 * recreated, so this may not be called while the pool is in use.
+	 */
+	static void SetInstanceNThreads(size_t nThreads)
+	{
+		std::lock_guard<std::mutex> lock(instanceMutex());
+		instanceNThreads() = nThreads;
+		std::unique_ptr<ThreadPool>& instance = instancePtr();
+		if(instance && instance->NThreads() != std::max<size_t>(nThreads, 1))
+			instance.reset();
+	}
+
 	/**
 	 * Iteratively call a function in parallel.
-	 * 
+	 *
 	 * The function is expected to accept two size_t parameters, the loop
 	 * index and the thread id, e.g.:
 	 *   void loopFunction(size_t iteration, size_t threadID);
-	 * It is called (end-start) times.
+	 * It is called (end-start) times. The thread id is smaller than
+	 * NThreads(), and no two iterations with the same thread id are executed
+	 * at the same time.
+	 *
+	 * The grain size is chosen such that every thread gets a few chunks,
+	 * which balances the load when iterations have different costs.
 	 */
 	template<typename Func>
 	void For(size_t start, size_t end, Func func)
 	{
-		std::unique_lock<std::mutex> lock(_mutex);
-		size_t thisPriority = _priority;
-		++_priority;
-		lock.unlock();
-		
-		size_t progress = end-start;
-		
-		std::thread localThread(&ThreadPool::threadSpecificPriorityFunc, this, 0, thisPriority, &progress);
-		
-		// Queue tasks for all iterations
-		while(start!=end)
+		const size_t nChunks = NThreads() * 4;
+		size_t grainSize = (end > start) ? (end - start + nChunks - 1) / nChunks : 1;
+		For(start, end, grainSize, func);
+	}
+
+	/**
+	 * Iteratively call a function in parallel, with a given grain size.
+	 *
+	 * Same as For(start, end, func), but consecutive iterations are
+	 * executed by the same thread in chunks of grainSize iterations.
+	 * An exception thrown by the function is rethrown after all other
+	 * chunks have finished; chunks that did not start yet are skipped.
+	 */
+	template<typename Func>
+	void For(size_t start, size_t end, size_t grainSize, Func func)
+	{
+		if(end <= start)
+			return;
+		if(grainSize == 0)
+			grainSize = 1;
+		ThreadState& state = threadState();
+		if(state.pool != this)
 		{
-			write(thisPriority, std::bind(func, start, std::placeholders::_1), &progress);
-			++start;
+			// Threads that are not part of the pool share index 0, so
+			// make them take turns. Nested calls see the pool as their own.
+			std::lock_guard<std::mutex> externalLock(_externalMutex);
+			const ThreadState previous = state;
+			state.pool = this;
+			state.index = 0;
+			try {
+				For(start, end, grainSize, func);
+			} catch(...) {
+				state.pool = previous.pool;
+				state.index = previous.index;
+				throw;
+			}
+			state.pool = previous.pool;
+			state.index = previous.index;
+			return;
 		}
-			
-		// Wait untill we have performed all iterations
-		/*lock.lock();
-		while(progress != 0)
+		const size_t threadIndex = state.index;
+
+		// Small loops, or pools without extra threads, are done directly.
+		if(end - start <= grainSize || _threads.empty())
 		{
-			_onProgress.wait(lock);
-		}*/
-		localThread.join();
+			for(size_t i=start; i!=end; ++i)
+				func(i, threadIndex);
+			return;
+		}
+
+		const size_t nChunks = (end - start + grainSize - 1) / grainSize;
+		Job job(&runChunk<Func>, &func, nChunks, state.usage);
+
+		WorkQueue& queue = *_queues[threadIndex];
+		std::unique_lock<std::mutex> queueLock(queue.mutex);
+		// Add the chunks in reverse order, so that this thread starts with
+		// the first chunk and the thieves with the last chunk.
+		for(size_t chunk=nChunks; chunk!=0; --chunk)
+		{
+			size_t chunkStart = start + (chunk-1) * grainSize;
+			size_t chunkEnd = std::min(chunkStart + grainSize, end);
+			queue.tasks.push_back(Task{&job, chunkStart, chunkEnd});
+		}
+		// Count them while the queue is locked, so that the count can never
+		// be decreased by a thief before being increased.
+		_pendingTasks += nChunks;
+		queueLock.unlock();
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_onChange.notify_all();
+		lock.unlock();
+
+		// Do the chunks that have not been stolen.
+		Task task;
+		while(popOwnTask(threadIndex, &job, task))
+			execute(task, threadIndex, false);
+
+		// Wait for the chunks that were stolen. A pool thread does not
+		// count the waiting as work, because the thieves count their chunks.
+		const std::chrono::steady_clock::time_point waitStart =
+			std::chrono::steady_clock::now();
+		lock.lock();
+		while(job.remaining.load() != 0)
+			_onChange.wait(lock);
+		lock.unlock();
+		state.waited += std::chrono::steady_clock::now() - waitStart;
+
+		if(job.exception)
+			std::rethrow_exception(job.exception);
 	}
-	
+
 private:
-	void threadFunc(size_t threadId)
+	/**
+	 * The state of a single For() call.
+	 */
+	struct Job
 	{
-		std::pair<std::function<void(size_t)>, size_t*> func;
-		while(read_highest_priority(func))
-		{
-			func.first(threadId);
-			
-			std::unique_lock<std::mutex> lock(_mutex);
-			--(*func.second); // decrease progress counter (requires lock)
-			_onProgress.notify_all();
-		}
+		Job(void (*r)(void*, size_t, size_t, size_t), void* f, size_t n, CoreUsage* u) :
+			run(r), function(f), nChunks(n), usage(u), remaining(n), failed(false)
+		{ }
+		void (*run)(void* function, size_t start, size_t end, size_t threadIndex);
+		void* function;
+		size_t nChunks;
+		CoreUsage* usage;
+		std::atomic<size_t> remaining;
+		std::atomic<bool> failed;
+		std::mutex exceptionMutex;
+		std::exception_ptr exception;
+	};
+
+	struct Task
+	{
+		Job* job;
+		size_t start, end;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	struct ThreadState
+	{
+		const ThreadPool* pool;
+		size_t index;
+		// Counter of the step for which this thread is working.
+		CoreUsage* usage;
+		// Time spent waiting for stolen chunks of nested loops.
+		std::chrono::steady_clock::duration waited;
+	};
+
+	void start(size_t nThreads)
+	{
+		if(nThreads == 0)
+			nThreads = 1;
+		_queues.reserve(nThreads);
+		for(size_t i=0; i!=nThreads; ++i)
+			_queues.emplace_back(new WorkQueue());
+		// Index 0 is reserved for the thread that calls For(), so
+		// one thread less is created.
+		_threads.reserve(nThreads-1);
+		for(size_t i=1; i!=nThreads; ++i)
+			_threads.emplace_back(&ThreadPool::threadFunc, this, i);
 	}
-	
-	void threadSpecificPriorityFunc(size_t threadId, size_t priority, size_t* progressPtr)
+
+	template<typename Func>
+	static void runChunk(void* function, size_t start, size_t end, size_t threadIndex)
 	{
-		std::pair<std::function<void(size_t)>, size_t*> func;
-		while(read_specific_priority(priority, func, progressPtr))
-		{
-			func.first(threadId);
-			
-			std::unique_lock<std::mutex> lock(_mutex);
-			--(*progressPtr);
-			_onProgress.notify_all();
-		}
+		Func& func = *static_cast<Func*>(function);
+		for(size_t i=start; i!=end; ++i)
+			func(i, threadIndex);
 	}
-	
-	bool read_highest_priority(std::pair<std::function<void(size_t)>, size_t*>& func)
+
+	static ThreadState& threadState()
 	{
-		std::unique_lock<std::mutex> lock(_mutex);
-		while(!_isStopped && _tasks.empty())
-			_onProgress.wait(lock);
-		if(!_tasks.empty())
-		{
-			func = std::move(_tasks.begin()->second);
-			_tasks.erase(_tasks.begin());
-			_onProgress.notify_all();
-			return true;
-		}
-		else {
-			return false;
-		}
+		thread_local ThreadState state = { nullptr, 0, nullptr,
+			std::chrono::steady_clock::duration::zero() };
+		return state;
 	}
-	
-	bool read_specific_priority(size_t priority, std::pair<std::function<void(size_t)>, size_t*>& func, size_t* progress)
+
+	static std::mutex& instanceMutex()
 	{
-		std::unique_lock<std::mutex> lock(_mutex);
-		auto iter = _tasks.find(priority);
-		while(!_isStopped && (*progress)>0 && iter == _tasks.end())
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::unique_ptr<ThreadPool>& instancePtr()
+	{
+		static std::unique_ptr<ThreadPool> instance;
+		return instance;
+	}
+
+	static size_t& instanceNThreads()
+	{
+		static size_t nThreads = 0;
+		return nThreads;
+	}
+
+	void threadFunc(size_t threadIndex)
+	{
+		ThreadState& state = threadState();
+		state.pool = this;
+		state.index = threadIndex;
+		// The pool threads already use all cores that are allowed, so
+		// remaining OpenMP loops inside a chunk are done sequentially.
+		OpenMP::setNumThreads(1);
+		Task task;
+		while(steal(threadIndex, task))
+			execute(task, threadIndex, true);
+	}
+
+	/**
+	 * Execute a chunk. If isStolen, the time spent is added to the core
+	 * usage of the job; chunks executed by the thread that called For() are
+	 * already part of the time of the step or of a stolen chunk.
+	 */
+	void execute(const Task& task, size_t threadIndex, bool isStolen)
+	{
+		Job& job = *task.job;
+		if(!job.failed.load())
 		{
-			_onProgress.wait(lock);
-			iter = _tasks.find(priority);
+			// Nested loops are accounted to the same step.
+			ThreadState& state = threadState();
+			CoreUsage* previousUsage = state.usage;
+			const std::chrono::steady_clock::duration previousWaited = state.waited;
+			state.usage = job.usage;
+			state.waited = std::chrono::steady_clock::duration::zero();
+			const std::chrono::steady_clock::time_point chunkStart =
+				std::chrono::steady_clock::now();
+			try {
+				job.run(job.function, task.start, task.end, threadIndex);
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(job.exceptionMutex);
+				if(!job.exception)
+					job.exception = std::current_exception();
+				job.failed = true;
+			}
+			if(isStolen && job.usage != nullptr)
+				job.usage->Add(std::chrono::steady_clock::now() - chunkStart - state.waited);
+			state.usage = previousUsage;
+			state.waited += previousWaited;
 		}
-		if(iter != _tasks.end())
+		// The job can be destructed by its owner as soon as remaining
+		// reaches zero, so it may not be used after decreasing it.
+		if(job.remaining.fetch_sub(1) == 1)
 		{
-			func = std::move(iter->second);
-			_tasks.erase(iter);
-			_onProgress.notify_all();
-			return true;
+			std::lock_guard<std::mutex> lock(_mutex);
+			_onChange.notify_all();
 		}
-		else {
+	}
+
+	/**
+	 * Take a chunk of the given job from the back of the own queue.
+	 * Returns false when all chunks of the job have been taken.
+	 */
+	bool popOwnTask(size_t threadIndex, const Job* job, Task& task)
+	{
+		WorkQueue& queue = *_queues[threadIndex];
+		std::lock_guard<std::mutex> queueLock(queue.mutex);
+		if(queue.tasks.empty() || queue.tasks.back().job != job)
 			return false;
-		}
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		--_pendingTasks;
+		return true;
 	}
-	
-	void write(size_t priority, std::function<void(size_t)>&& func, size_t* progressPtr)
+
+	/**
+	 * Take a chunk from the front of another thread's queue. Waits until
+	 * there is work, and returns false when the pool is stopped.
+	 */
+	bool steal(size_t threadIndex, Task& task)
 	{
-		// Wait until there is space in the map (so that the map
-		// doesn't get too large)
-		std::unique_lock<std::mutex> lock(_mutex);
-		while(_tasks.count(priority) >= NThreads())
+		const size_t nQueues = _queues.size();
+		while(true)
 		{
-			_onProgress.wait(lock);
+			for(size_t i=1; i!=nQueues+1; ++i)
+			{
+				WorkQueue& queue = *_queues[(threadIndex + i) % nQueues];
+				std::lock_guard<std::mutex> queueLock(queue.mutex);
+				if(!queue.tasks.empty())
+				{
+					task = queue.tasks.front();
+					queue.tasks.pop_front();
+					--_pendingTasks;
+					return true;
+				}
+			}
+			std::unique_lock<std::mutex> lock(_mutex);
+			while(!_isStopped && _pendingTasks.load() == 0)
+				_onChange.wait(lock);
+			if(_isStopped)
+				return false;
 		}
-		_tasks.emplace(priority, std::make_pair(std::move(func), progressPtr));
-		_onProgress.notify_all();
 	}
-	
+
 	static unsigned cpus()
 	{
 #ifdef __APPLE__
@@ -190,18 +472,17 @@ private:
 		return count;
 #endif
 	}
-	
-	// Priority, (function, progress*)
+
 	bool _isStopped;
-	size_t _priority;
-	std::multimap<
-		size_t,
-		std::pair<std::function<void(size_t)>, size_t*>,
-		std::greater<size_t>
-	> _tasks;
+	// Number of chunks in the queues that have not been taken yet.
+	std::atomic<size_t> _pendingTasks;
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
 	std::vector<std::thread> _threads;
+	// Used for sleeping and waking up threads.
 	std::mutex _mutex;
-	std::condition_variable _onProgress;
+	std::condition_variable _onChange;
+	// Lets threads outside the pool call For() one at a time.
+	std::mutex _externalMutex;
 };
 
 };
@@ -26,7 +26,7 @@
 #include "../Common/ParameterSet.h"
 #include "../Common/Timer.h"
 #include "../Common/StringUtil.h"
-#include "../Common/OpenMP.h"
+#include "../Common/ThreadPool.h"
 
 #include "ApplyBeam.h"
 #include "DPInfo.h"
@@ -61,7 +61,9 @@ namespace DP3 {
           itsName(prefix),
           itsUpdateWeights(parset.getBool(prefix + "updateweights", false)),
           itsUseChannelFreq(parset.getBool(prefix + "usechannelfreq", true)),
-          itsDebugLevel(parset.getInt(prefix + "debuglevel", 0))
+          itsDebugLevel(parset.getInt(prefix + "debuglevel", 0)),
+          itsBeamUpdateTime(parset.getDouble(prefix + "beamupdatetime", 0.)),
+          itsBeamUpdateFreq(parset.getDouble(prefix + "beamupdatefreq", 0.))
     {
       // only read 'invert' parset key if it is a separate step
       // if applybeam is called from gaincal/predict, the invert key should always be false
@@ -109,24 +111,14 @@ namespace DP3 {
       const size_t nSt = info().nantenna();
       const size_t nCh = info().nchan();
 
-      itsBeamValues.resize(OpenMP::maxThreads());
-
-      // Create the Measure ITRF conversion info given the array position.
-      // The time and direction are filled in later.
-      itsMeasConverters.resize(OpenMP::maxThreads());
-      itsMeasFrames.resize(OpenMP::maxThreads());
-      itsAntBeamInfo.resize(OpenMP::maxThreads());
-
-      for (uint thread = 0; thread < OpenMP::maxThreads(); ++thread) {
-        itsBeamValues[thread].resize(nSt * nCh);
-        itsMeasFrames[thread].set(info().arrayPosCopy());
-        itsMeasFrames[thread].set(
-            MEpoch(MVEpoch(info().startTime() / 86400), MEpoch::UTC));
-        itsMeasConverters[thread].set(
-            MDirection::J2000,
-            MDirection::Ref(MDirection::ITRF, itsMeasFrames[thread]));
+      const size_t nThreads = ThreadPool::GetInstance().NThreads();
+      itsBeamValues.resize(nSt * nCh);
+      itsAntBeamInfo.resize(nThreads);
+      for (uint thread = 0; thread < nThreads; ++thread) {
         itsInput->fillBeamInfo(itsAntBeamInfo[thread], info().antennaNames());
       }
+      itsBeamCache = BeamCache::get(info(), info().antennaNames(),
+                                    itsBeamUpdateTime, itsBeamUpdateFreq);
     }
 
     void ApplyBeam::show(std::ostream& os) const
@@ -142,6 +134,8 @@ namespace DP3 {
       os << "  use channelfreq:   " << boolalpha << itsUseChannelFreq << endl;
       os << "  invert:            " << boolalpha << itsInvert << endl;
       os << "  update weights:    " << boolalpha << itsUpdateWeights << endl;
+      os << "  beam update time:  " << itsBeamUpdateTime << " s" << endl;
+      os << "  beam update freq:  " << itsBeamUpdateFreq << " Hz" << endl;
     }
 
     void ApplyBeam::showTimings(std::ostream& os, double duration) const
@@ -164,41 +158,19 @@ namespace DP3 {
 
       double time = itsBuffer.getTime();
 
-      //Set up directions for beam evaluation
-      LOFAR::StationResponse::vector3r_t refdir, tiledir;
-
-      for (uint thread = 0; thread < OpenMP::maxThreads(); ++thread) {
-        itsMeasFrames[thread].resetEpoch(
-            MEpoch(MVEpoch(time / 86400), MEpoch::UTC));
-        //Do a conversion on all threads, because converters are not
-        //thread safe and apparently need to be used at least once
-        refdir = dir2Itrf(info().delayCenter(), itsMeasConverters[thread]);
-        tiledir = dir2Itrf(info().tileBeamDir(), itsMeasConverters[thread]);
-      }
-
-      uint thread = OpenMP::threadNum();
-
-      LOFAR::StationResponse::vector3r_t srcdir = refdir;
-      applyBeam(info(), time, data, weight, srcdir, refdir, tiledir,
-                itsAntBeamInfo[thread], itsBeamValues[thread],
-                itsUseChannelFreq, itsInvert, itsMode, itsUpdateWeights);
+      // The beam is applied for the delay center.
+      itsBeamCache->getBeam(time, info().delayCenter(), info().chanFreqs(),
+                            itsUseChannelFreq ? 0. : info().refFreq(),
+                            itsMode, itsInvert, itsAntBeamInfo,
+                            itsBeamValues.data());
+      applyBeamValues(info(), data, weight, itsBeamValues,
+                      0, info().nbaselines(), itsUpdateWeights);
 
       itsTimer.stop();
       getNextStep()->process(itsBuffer);
       return false;
     }
 
-    LOFAR::StationResponse::vector3r_t ApplyBeam::dir2Itrf(
-        const MDirection& dir, MDirection::Convert& measConverter)
-    {
-      const MDirection& itrfDir = measConverter(dir);
-      const Vector<Double>& itrf = itrfDir.getValue().getValue();
-      LOFAR::StationResponse::vector3r_t vec;
-      vec[0] = itrf[0];
-      vec[1] = itrf[1];
-      vec[2] = itrf[2];
-      return vec;
-    }
 
     void ApplyBeam::finish()
     {
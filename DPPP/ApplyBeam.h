@@ -29,6 +29,7 @@
 // @file
 // @brief DPPP step class to apply the beam model (optionally inverted)
 
+#include "BeamCache.h"
 #include "DPInput.h"
 #include "DPBuffer.h"
 #include "Position.h"
@@ -97,11 +98,26 @@ namespace DP3 {
             bool useChannelFreq, bool invert, int mode,
             bool doUpdateWeights=false);
 
-      private:
-        LOFAR::StationResponse::vector3r_t dir2Itrf(
-            const casacore::MDirection& dir,
-            casacore::MDirection::Convert& measConverter);
+        // Compute the beam values of a station for all channels.
+        static void computeBeam(
+            const DPInfo& info, double time,
+            const LOFAR::StationResponse::vector3r_t& srcdir,
+            const LOFAR::StationResponse::vector3r_t& refdir,
+            const LOFAR::StationResponse::vector3r_t& tiledir,
+            const LOFAR::StationResponse::Station::Ptr& station,
+            LOFAR::StationResponse::matrix22c_t* beamValues,
+            bool useChannelFreq, bool invert, int mode);
 
+        // Apply the beam values of all stations (as filled by computeBeam)
+        // to the data of the baselines [blStart,blEnd). The data pointer
+        // points to the data of baseline 0.
+        template<typename T>
+        static void applyBeamValues(
+            const DPInfo& info, T* data0, float* weight0,
+            const vector<LOFAR::StationResponse::matrix22c_t>& beamValues,
+            size_t blStart, size_t blEnd, bool doUpdateWeights=false);
+
+      private:
         //# Data members.
         DPInput*             itsInput;
         string               itsName;
@@ -115,10 +131,12 @@ namespace DP3 {
         uint                 itsDebugLevel;
 
         // The info needed to calculate the station beams.
+        // The station objects are not thread safe, so each thread has its own.
         vector<vector<LOFAR::StationResponse::Station::Ptr> > itsAntBeamInfo;
-        vector<casacore::MeasFrame> itsMeasFrames;
-        vector<casacore::MDirection::Convert> itsMeasConverters;
-        vector<vector<LOFAR::StationResponse::matrix22c_t> > itsBeamValues;
+        vector<LOFAR::StationResponse::matrix22c_t> itsBeamValues; //# [nst,nchan]
+        double               itsBeamUpdateTime;
+        double               itsBeamUpdateFreq;
+        BeamCache::ShPtr     itsBeamCache;
 
         NSTimer itsTimer;
     };
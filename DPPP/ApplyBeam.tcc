@@ -80,76 +80,56 @@ void ApplyBeam::applyBeam(
       // Get the beam values for each station.
       uint nCh = info.chanFreqs().size();
       uint nSt = beamValues.size() / nCh;
-      uint nBl = info.nbaselines();
-
-      // Store array factor in diagonal matrix (in other modes this variable
-      // is not used).
-      LOFAR::StationResponse::diag22c_t af_tmp;
-
-      double reffreq=info.refFreq();
+      for (size_t st = 0; st < nSt; ++st) {
+        computeBeam (info, time, srcdir, refdir, tiledir, antBeamInfo[st],
+                     &(beamValues[nCh * st]), useChannelFreq, invert, mode);
+      }
 
       // Apply the beam values of both stations to the ApplyBeamed data.
-      dcomplex tmp[4];
+      applyBeamValues (info, data0, weight0, beamValues, 0, info.nbaselines(),
+                       doUpdateWeights);
+    }
+
+inline void ApplyBeam::computeBeam(
+        const DPInfo& info, double time,
+        const LOFAR::StationResponse::vector3r_t& srcdir,
+        const LOFAR::StationResponse::vector3r_t& refdir,
+        const LOFAR::StationResponse::vector3r_t& tiledir,
+        const LOFAR::StationResponse::Station::Ptr& station,
+        LOFAR::StationResponse::matrix22c_t* beamValues,
+        bool useChannelFreq, bool invert, int mode)
+    {
+      uint nCh = info.chanFreqs().size();
       for (size_t ch = 0; ch < nCh; ++ch) {
-        if (useChannelFreq) {
-          reffreq=info.chanFreqs()[ch];
+        double freq = info.chanFreqs()[ch];
+        beamValues[ch] = BeamCache::response(station, time, freq,
+                                             useChannelFreq ? freq : info.refFreq(),
+                                             srcdir, refdir, tiledir, mode);
+        if (invert) {
+          ApplyCal::invert((dcomplex*)(&(beamValues[ch])));
         }
+      }
+    }
 
-        switch (mode) {
-        case DEFAULT:
-          // Fill beamValues for channel ch
-          for (size_t st = 0; st < nSt; ++st) {
-            beamValues[nCh * st + ch] = antBeamInfo[st]->response(time,
-                                          info.chanFreqs()[ch], srcdir,
-                                          reffreq, refdir, tiledir);
-            if (invert) {
-              ApplyCal::invert((dcomplex*)(&(beamValues[nCh * st + ch])));
-            }
-          }
-          break;
-        case ARRAY_FACTOR:
-          // Fill beamValues for channel ch
-          for (size_t st = 0; st < nSt; ++st) {
-            af_tmp = antBeamInfo[st]->arrayFactor(time,
-                                          info.chanFreqs()[ch], srcdir,
-                                          reffreq, refdir, tiledir);
-            beamValues[nCh * st + ch][0][1]=0.;
-            beamValues[nCh * st + ch][1][0]=0.;
-
-            if (invert) {
-              beamValues[nCh * st + ch][0][0]=1./af_tmp[0];
-              beamValues[nCh * st + ch][1][1]=1./af_tmp[1];
-            } else {
-              beamValues[nCh * st + ch][0][0]=af_tmp[0];
-              beamValues[nCh * st + ch][1][1]=af_tmp[1];
-            }
-          }
-          break;
-        case ELEMENT:
-          // Fill beamValues for channel ch
-          for (size_t st = 0; st < nSt; ++st) {
-            LOFAR::StationResponse::AntennaField::ConstPtr field =
-                *(antBeamInfo[st]->beginFields());
-
-            beamValues[nCh * st + ch] = field->elementResponse(time,
-                                                 info.chanFreqs()[ch],
-                                                 srcdir);
-            if (invert) {
-              ApplyCal::invert((dcomplex*)(&(beamValues[nCh * st + ch])));
-            }
-          }
-          break;
-        }
+template<typename T>
+void ApplyBeam::applyBeamValues(
+        const DPInfo& info, T* data0, float* weight0,
+        const vector<LOFAR::StationResponse::matrix22c_t>& beamValues,
+        size_t blStart, size_t blEnd, bool doUpdateWeights)
+    {
+      uint nCh = info.chanFreqs().size();
 
-        // Apply beam for channel ch on all baselines
-        // For mode=ARRAY_FACTOR, too much work is done here because we know
-        // that r and l are diagonal
-        for (size_t bl = 0; bl < nBl; ++bl) {
+      // Apply the beam values of both stations to the ApplyBeamed data.
+      // For mode=ARRAY_FACTOR, too much work is done here because we know
+      // that r and l are diagonal
+      dcomplex tmp[4];
+      for (size_t bl = blStart; bl < blEnd; ++bl) {
+        const LOFAR::StationResponse::matrix22c_t *left = &(beamValues[nCh
+            * info.getAnt1()[bl]]);
+        const LOFAR::StationResponse::matrix22c_t *right = &(beamValues[nCh
+            * info.getAnt2()[bl]]);
+        for (size_t ch = 0; ch < nCh; ++ch) {
           T* data = data0 + bl * 4 * nCh + ch * 4;
-          LOFAR::StationResponse::matrix22c_t *left = &(beamValues[nCh
-              * info.getAnt1()[bl]]);
-          LOFAR::StationResponse::matrix22c_t *right = &(beamValues[nCh
-              * info.getAnt2()[bl]]);
           dcomplex l[] = { left[ch][0][0], left[ch][0][1],
                            left[ch][1][0], left[ch][1][1] };
           // Form transposed conjugate of right.
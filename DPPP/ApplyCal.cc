@@ -126,6 +126,12 @@ namespace DP3 {
       return true;
     }
 
+    bool ApplyCal::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      getNextStep()->processBatch(bufs);
+      return true;
+    }
+
 
     void ApplyCal::finish()
     {
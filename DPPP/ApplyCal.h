@@ -62,6 +62,9 @@ namespace DP3 {
       // When processed, it invokes the process function of the next step.
       virtual bool process (const DPBuffer&);
 
+      // Give the batch to the first OneApplyCal step.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish();
 
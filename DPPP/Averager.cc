@@ -152,6 +152,49 @@ namespace DP3 {
         return true;
       }
       itsTimer.start();
+      if (addBuffer (buf)) {
+        average (itsBufOut);
+        itsTimer.stop();
+        getNextStep()->process (itsBufOut);
+      } else {
+        itsTimer.stop();
+      }
+      return true;
+    }
+
+    bool Averager::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      if (itsNoAvg) {
+        getNextStep()->processBatch (bufs);
+        return true;
+      }
+      itsTimer.start();
+      // Average into the output batch; a batch can result in a varying
+      // number of averaged time slots.
+      size_t nout = 0;
+      for (const DPBuffer& buf : bufs) {
+        if (addBuffer (buf)) {
+          if (nout == itsBatchOut.size()) {
+            itsBatchOut.emplace_back();
+          }
+          average (itsBatchOut[nout]);
+          // The fullRes flags reference itsBuf which is reused.
+          itsBatchOut[nout++].getFullResFlags().unique();
+        }
+      }
+      itsTimer.stop();
+      if (nout == itsBatchOut.size()) {
+        getNextStep()->processBatch (itsBatchOut);
+      } else if (nout > 0) {
+        getNextStep()->processBatch
+          (std::vector<DPBuffer> (itsBatchOut.begin(),
+                                  itsBatchOut.begin() + nout));
+      }
+      return true;
+    }
+
+    bool Averager::addBuffer (const DPBuffer& buf)
+    {
       // Sum the data in time applying the weights.
       // The summing in channel and the averaging is done in function average.
       if (itsNTimes == 0) {
@@ -241,17 +284,9 @@ namespace DP3 {
           ++outnIter;
         }
       }
-      // Do the averaging if enough time steps have been processed.
+      // Tell if enough time steps have been processed for averaging.
       itsNTimes += 1;
-      if (itsNTimes >= itsNTimeAvg) {
-        average();
-        itsTimer.stop();
-        getNextStep()->process (itsBufOut);
-        itsNTimes = 0;
-      } else {
-        itsTimer.stop();
-      }
-      return true;
+      return itsNTimes >= itsNTimeAvg;
     }
 
     void Averager::finish()
@@ -259,24 +294,23 @@ namespace DP3 {
       // Average remaining entries.
       if (itsNTimes > 0) {
         itsTimer.start();
-        average();
+        average (itsBufOut);
         itsTimer.stop();
         getNextStep()->process (itsBufOut);
-        itsNTimes = 0;
       }
       // Let the next steps finish.
       getNextStep()->finish();
     }
 
-    void Averager::average()
+    void Averager::average (DPBuffer& bufOut)
     {
       IPosition shp = itsBuf.getData().shape();
       uint nchanin = shp[1];
       uint npin = shp[0] * nchanin;
       shp[1] = (shp[1] + itsNChanAvg - 1) / itsNChanAvg;
-      itsBufOut.getData().resize (shp);
-      itsBufOut.getWeights().resize (shp);
-      itsBufOut.getFlags().resize (shp);
+      bufOut.getData().resize (shp);
+      bufOut.getWeights().resize (shp);
+      bufOut.getFlags().resize (shp);
       uint ncorr = shp[0];
       uint nchan = shp[1];
       int  nbl   = shp[2];
@@ -289,9 +323,9 @@ namespace DP3 {
         const float* inwght = itsBuf.getWeights().data() + k*npin;
         const float* inallw = itsWeightAll.data() + k*npin;
         const int* innp = itsNPoints.data() + k*npin;
-        Complex* outdata = itsBufOut.getData().data() + k*npout;
-        float* outwght = itsBufOut.getWeights().data() + k*npout;
-        bool* outflags = itsBufOut.getFlags().data() + k*npout;
+        Complex* outdata = bufOut.getData().data() + k*npout;
+        float* outwght = bufOut.getWeights().data() + k*npout;
+        bool* outflags = bufOut.getFlags().data() + k*npout;
         for (uint i=0; i<ncorr; ++i) {
           uint inxi = i;
           uint inxo = i;
@@ -326,12 +360,13 @@ namespace DP3 {
         }
       }
       // Set the remaining values in the output buffer.
-      itsBufOut.setTime     (itsBuf.getTime());
-      itsBufOut.setExposure (itsBuf.getExposure());
-      itsBufOut.setFullResFlags (itsBuf.getFullResFlags());
+      bufOut.setTime     (itsBuf.getTime());
+      bufOut.setExposure (itsBuf.getExposure());
+      bufOut.setFullResFlags (itsBuf.getFullResFlags());
       // The result UVWs are the average of the input.
       // If ever needed, UVWCalculator can be used to calculate the UVWs.
-      itsBufOut.setUVW (itsBuf.getUVW() / double(itsNTimes));
+      bufOut.setUVW (itsBuf.getUVW() / double(itsNTimes));
+      itsNTimes = 0;
     }
 
     void Averager::copyFullResFlags (const Cube<bool>& fullResFlags,
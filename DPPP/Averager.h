@@ -69,6 +69,10 @@ namespace DP3 {
       // When processed, it invokes the process function of the next step.
       virtual bool process (const DPBuffer&);
 
+      // Process a batch of time slots.
+      // The averaged time slots are given to processBatch of the next step.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish();
 
@@ -82,8 +86,12 @@ namespace DP3 {
       virtual void showTimings (std::ostream&, double duration) const;
 
     private:
-      // Average into itsBufOut.
-      void average();
+      // Add the buffer to the sums. It returns true if enough time slots
+      // have been added to do the averaging.
+      bool addBuffer (const DPBuffer&);
+
+      // Average into the given buffer and reset the time count.
+      void average (DPBuffer& bufOut);
 
       // Copy the fullRes flags in the input buffer to the correct
       // time index in the output buffer.
@@ -102,6 +110,7 @@ namespace DP3 {
       DPBuffer        itsBuf;
       DPBuffer        itsBufTmp;
       DPBuffer        itsBufOut;
+      std::vector<DPBuffer> itsBatchOut;
       casacore::Cube<int> itsNPoints;
       casacore::Cube<casacore::Complex> itsAvgAll;
       casacore::Cube<float>         itsWeightAll;
@@ -0,0 +1,312 @@
+//# BeamCache.cc: Cache of station beam values shared between steps
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifdef HAVE_LOFAR_BEAM
+
+#include "BeamCache.h"
+#include "ApplyBeam.h"
+#include "ApplyCal.h"
+#include "DPInfo.h"
+
+#include "../Common/ThreadPool.h"
+
+#include <StationResponse/AntennaField.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+using namespace casacore;
+
+namespace DP3 {
+  namespace DPPP {
+
+    BeamCache::BeamCache (const DPInfo& info, double updateTime,
+                          double updateFreq)
+      : itsUpdateTime (updateTime),
+        itsUpdateFreq (updateFreq),
+        itsKeepTime   (4 * std::max(updateTime, info.timeInterval())),
+        itsLastTime   (0),
+        itsItrfConverter (ItrfConverter::get (info))
+    {}
+
+    BeamCache::ShPtr BeamCache::get (const DPInfo& info,
+                                     const std::vector<std::string>& antennaNames,
+                                     double updateTime, double updateFreq)
+    {
+      static std::mutex registryMutex;
+      static std::map<std::string, std::weak_ptr<BeamCache> > registry;
+      std::ostringstream key;
+      key << std::setprecision(17) << info.msName() << ' ' << updateTime
+          << ' ' << updateFreq;
+      for (const std::string& name : antennaNames) {
+        key << ' ' << name;
+      }
+      std::lock_guard<std::mutex> lock(registryMutex);
+      std::weak_ptr<BeamCache>& entry = registry[key.str()];
+      ShPtr cache = entry.lock();
+      if (! cache) {
+        cache = std::make_shared<BeamCache> (info, updateTime, updateFreq);
+        entry = cache;
+      }
+      return cache;
+    }
+
+    bool BeamCache::NodeKey::operator< (const NodeKey& other) const
+    {
+      // The time comes first, so old nodes are at the start of the map.
+      if (time != other.time) return time < other.time;
+      if (freq != other.freq) return freq < other.freq;
+      if (refFreq != other.refFreq) return refFreq < other.refFreq;
+      if (mode != other.mode) return mode < other.mode;
+      if (ref != other.ref) return ref < other.ref;
+      if (lon != other.lon) return lon < other.lon;
+      return lat < other.lat;
+    }
+
+    LOFAR::StationResponse::matrix22c_t BeamCache::response
+    (const LOFAR::StationResponse::Station::Ptr& station, double time,
+     double freq, double refFreq,
+     const LOFAR::StationResponse::vector3r_t& srcdir,
+     const LOFAR::StationResponse::vector3r_t& refdir,
+     const LOFAR::StationResponse::vector3r_t& tiledir, int mode)
+    {
+      LOFAR::StationResponse::matrix22c_t value;
+      switch (mode) {
+      case ApplyBeam::ARRAY_FACTOR:
+        {
+          LOFAR::StationResponse::diag22c_t af =
+            station->arrayFactor (time, freq, srcdir, refFreq, refdir, tiledir);
+          value[0][0] = af[0];
+          value[0][1] = 0.;
+          value[1][0] = 0.;
+          value[1][1] = af[1];
+        }
+        break;
+      case ApplyBeam::ELEMENT:
+        {
+          LOFAR::StationResponse::AntennaField::ConstPtr field =
+            *(station->beginFields());
+          value = field->elementResponse (time, freq, srcdir);
+        }
+        break;
+      default:
+        value = station->response (time, freq, srcdir, refFreq, refdir,
+                                   tiledir);
+        break;
+      }
+      return value;
+    }
+
+    void BeamCache::computeBeam (double time, const MDirection& direction,
+                                 const Vector<double>& chanFreqs,
+                                 double refFreq, int mode,
+                                 const std::vector<StationList>& stations,
+                                 LOFAR::StationResponse::matrix22c_t* beamValues)
+    {
+      const size_t nSt = stations[0].size();
+      const size_t nCh = chanFreqs.size();
+      const ItrfConverter::Directions dirs =
+        itsItrfConverter->directions (time, direction);
+      auto compute = [&](size_t st, size_t thread) {
+        for (size_t ch=0; ch<nCh; ++ch) {
+          beamValues[st*nCh + ch] =
+            response (stations[thread][st], time, chanFreqs[ch],
+                      refFreq == 0 ? chanFreqs[ch] : refFreq,
+                      dirs.srcdir, dirs.refdir, dirs.tiledir, mode);
+        }
+      };
+      if (stations.size() == 1) {
+        for (size_t st=0; st<nSt; ++st) {
+          compute (st, 0);
+        }
+      } else {
+        ThreadPool::GetInstance().For (0, nSt, compute);
+      }
+    }
+
+    void BeamCache::getBeam (double time, const MDirection& direction,
+                             const Vector<double>& chanFreqs, double refFreq,
+                             int mode, bool invert,
+                             const std::vector<StationList>& stations,
+                             LOFAR::StationResponse::matrix22c_t* beamValues)
+    {
+      const size_t nSt = stations[0].size();
+      const size_t nCh = chanFreqs.size();
+      if (itsUpdateTime <= 0  &&  itsUpdateFreq <= 0) {
+        computeBeam (time, direction, chanFreqs, refFreq, mode, stations,
+                     beamValues);
+      } else {
+        // Determine the grid times and frequencies around the time and
+        // channels, and the interpolation weights.
+        double times[2] = {time, time};
+        double timeWeight = 0;
+        size_t nTimes = 1;
+        if (itsUpdateTime > 0) {
+          const double index = std::floor (time / itsUpdateTime);
+          times[0] = index * itsUpdateTime;
+          times[1] = (index+1) * itsUpdateTime;
+          timeWeight = (time - times[0]) / itsUpdateTime;
+          nTimes = 2;
+        }
+        std::vector<double> freqs;
+        std::vector<double> gridFreqs(nCh);
+        std::vector<double> freqWeights(nCh, 0.);
+        freqs.reserve (2*nCh);
+        for (size_t ch=0; ch<nCh; ++ch) {
+          if (itsUpdateFreq > 0) {
+            const double index = std::floor (chanFreqs[ch] / itsUpdateFreq);
+            gridFreqs[ch] = index * itsUpdateFreq;
+            freqWeights[ch] = (chanFreqs[ch] - gridFreqs[ch]) / itsUpdateFreq;
+            freqs.push_back (gridFreqs[ch]);
+            freqs.push_back ((index+1) * itsUpdateFreq);
+          } else {
+            gridFreqs[ch] = chanFreqs[ch];
+            freqs.push_back (chanFreqs[ch]);
+          }
+        }
+        std::sort (freqs.begin(), freqs.end());
+        freqs.erase (std::unique (freqs.begin(), freqs.end()), freqs.end());
+        const size_t nFreqs = freqs.size();
+
+        // Look up the grid points. The missing ones are added and computed
+        // by this thread; other threads needing them wait until they are
+        // ready.
+        const Vector<Double> angles = direction.getValue().get();
+        NodeKey key;
+        key.refFreq = refFreq;
+        key.mode = mode;
+        key.ref = direction.getRef().getType();
+        key.lon = angles[0];
+        key.lat = angles[1];
+        std::vector<NodePtr> nodes(nTimes * nFreqs);
+        std::vector<size_t> todo;
+        std::vector<std::promise<void> > promises;
+        {
+          std::lock_guard<std::mutex> lock(itsMutex);
+          // Forget the nodes which are too old.
+          itsLastTime = std::max (itsLastTime, time);
+          while (! itsNodes.empty()  &&
+                 itsNodes.begin()->first.time < itsLastTime - itsKeepTime) {
+            itsNodes.erase (itsNodes.begin());
+          }
+          for (size_t i=0; i<nodes.size(); ++i) {
+            key.time = times[i / nFreqs];
+            key.freq = freqs[i % nFreqs];
+            NodePtr& node = itsNodes[key];
+            if (! node) {
+              node = std::make_shared<Node>();
+              node->values.resize (nSt);
+              promises.emplace_back();
+              node->ready = promises.back().get_future().share();
+              todo.push_back (i);
+            }
+            nodes[i] = node;
+          }
+        }
+        if (! todo.empty()) {
+          try {
+            ItrfConverter::Directions dirs[2];
+            for (size_t t=0; t<nTimes; ++t) {
+              dirs[t] = itsItrfConverter->directions (times[t], direction);
+            }
+            auto compute = [&](size_t i, size_t thread) {
+              const size_t node = todo[i / nSt];
+              const size_t st = i % nSt;
+              const size_t t = node / nFreqs;
+              const double freq = freqs[node % nFreqs];
+              nodes[node]->values[st] =
+                response (stations[thread][st], times[t], freq,
+                          refFreq == 0 ? freq : refFreq,
+                          dirs[t].srcdir, dirs[t].refdir, dirs[t].tiledir,
+                          mode);
+            };
+            // The nodes are computed by this thread only. Other threads
+            // may wait for them while holding the ThreadPool (e.g. a
+            // Predict run inside a For of DDECal), so using the pool here
+            // could deadlock.
+            for (size_t i=0; i<todo.size()*nSt; ++i) {
+              compute (i, 0);
+            }
+          } catch (...) {
+            // Remove the failed nodes and pass on the exception.
+            {
+              std::lock_guard<std::mutex> lock(itsMutex);
+              for (size_t i : todo) {
+                key.time = times[i / nFreqs];
+                key.freq = freqs[i % nFreqs];
+                std::map<NodeKey, NodePtr>::iterator iter = itsNodes.find(key);
+                if (iter != itsNodes.end()  &&  iter->second == nodes[i]) {
+                  itsNodes.erase (iter);
+                }
+              }
+            }
+            for (std::promise<void>& promise : promises) {
+              promise.set_exception (std::current_exception());
+            }
+            throw;
+          }
+          for (std::promise<void>& promise : promises) {
+            promise.set_value();
+          }
+        }
+        for (const NodePtr& node : nodes) {
+          node->ready.get();
+        }
+
+        // Interpolate bilinearly in time and frequency.
+        for (size_t ch=0; ch<nCh; ++ch) {
+          const size_t j0 = std::lower_bound (freqs.begin(), freqs.end(),
+                                              gridFreqs[ch]) - freqs.begin();
+          const size_t j1 = (itsUpdateFreq > 0 ? j0+1 : j0);
+          const double w[4] = {(1-timeWeight) * (1-freqWeights[ch]),
+                               (1-timeWeight) * freqWeights[ch],
+                               timeWeight * (1-freqWeights[ch]),
+                               timeWeight * freqWeights[ch]};
+          const size_t t1 = (nTimes-1) * nFreqs;
+          const Node* corners[4] = {nodes[j0].get(), nodes[j1].get(),
+                                    nodes[t1+j0].get(), nodes[t1+j1].get()};
+          for (size_t st=0; st<nSt; ++st) {
+            LOFAR::StationResponse::matrix22c_t& value = beamValues[st*nCh + ch];
+            for (size_t i=0; i<2; ++i) {
+              for (size_t j=0; j<2; ++j) {
+                value[i][j] = w[0] * corners[0]->values[st][i][j] +
+                              w[1] * corners[1]->values[st][i][j] +
+                              w[2] * corners[2]->values[st][i][j] +
+                              w[3] * corners[3]->values[st][i][j];
+              }
+            }
+          }
+        }
+      }
+
+      if (invert) {
+        for (size_t i=0; i<nSt*nCh; ++i) {
+          ApplyCal::invert ((DComplex*)(&(beamValues[i])));
+        }
+      }
+    }
+
+  } //# end namespace
+}
+
+#endif
@@ -0,0 +1,150 @@
+//# BeamCache.h: Cache of station beam values shared between steps
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#ifdef HAVE_LOFAR_BEAM
+
+#ifndef DPPP_BEAMCACHE_H
+#define DPPP_BEAMCACHE_H
+
+// @file
+// @brief Cache of station beam values shared between steps
+
+#include "ItrfConverter.h"
+
+#include <StationResponse/Station.h>
+#include <StationResponse/Types.h>
+
+#include <casacore/casa/Arrays/Vector.h>
+#include <casacore/measures/Measures/MDirection.h>
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    class DPInfo;
+
+    // @ingroup NDPPP
+
+    // This class computes the beam values (station responses) for the steps
+    // applying the beam (ApplyBeam, Predict and the demixer).
+    //
+    // The beam varies slowly in time and frequency. If an update interval in
+    // time (parset key <src>beamupdatetime</src>) and/or frequency
+    // (<src>beamupdatefreq</src>) is given, the responses are only computed
+    // on a grid of multiples of these intervals and linearly interpolated.
+    // The grid values are kept for a few grid times, so steps asking for the
+    // same direction share them. A cache is shared by all steps using the
+    // same MS, stations and update intervals (see get).
+    // If both intervals are 0, the responses are computed exactly for each
+    // time and channel, and nothing is kept.
+    //
+    // The directions are converted to ITRF by the ItrfConverter shared by
+    // all caches of the MS.
+
+    class BeamCache
+    {
+    public:
+      typedef std::shared_ptr<BeamCache> ShPtr;
+      typedef std::vector<LOFAR::StationResponse::Station::Ptr> StationList;
+
+      BeamCache (const DPInfo& info, double updateTime, double updateFreq);
+
+      // Get the cache shared by all steps using the same MS, stations
+      // and update intervals.
+      static ShPtr get (const DPInfo& info,
+                        const std::vector<std::string>& antennaNames,
+                        double updateTime, double updateFreq);
+
+      // Get the beam values [nst,nchan] for a direction at the given time
+      // and channel frequencies.
+      // If refFreq is 0, the channel frequency is used as reference frequency.
+      // The mode is one of ApplyBeam::BeamMode.
+      // The stations are given per thread of the ThreadPool. If only one
+      // list is given, the values are computed by the calling thread.
+      // Missing grid points are always computed by the calling thread using
+      // the first list, because other threads can wait for them inside a
+      // ThreadPool::For.
+      void getBeam (double time, const casacore::MDirection& direction,
+                    const casacore::Vector<double>& chanFreqs, double refFreq,
+                    int mode, bool invert,
+                    const std::vector<StationList>& stations,
+                    LOFAR::StationResponse::matrix22c_t* beamValues);
+
+      double updateTime() const
+        { return itsUpdateTime; }
+      double updateFreq() const
+        { return itsUpdateFreq; }
+
+      // Compute the (not inverted) response of a station for a frequency.
+      static LOFAR::StationResponse::matrix22c_t response
+      (const LOFAR::StationResponse::Station::Ptr& station, double time,
+       double freq, double refFreq,
+       const LOFAR::StationResponse::vector3r_t& srcdir,
+       const LOFAR::StationResponse::vector3r_t& refdir,
+       const LOFAR::StationResponse::vector3r_t& tiledir, int mode);
+
+    private:
+      // A grid point: time, frequency, reference frequency, mode and
+      // direction.
+      struct NodeKey {
+        double time, freq, refFreq;
+        int    mode, ref;
+        double lon, lat;
+        bool operator< (const NodeKey& other) const;
+      };
+
+      // The responses of all stations at a grid point. The values can be used
+      // when the future is ready.
+      struct Node {
+        std::vector<LOFAR::StationResponse::matrix22c_t> values;
+        std::shared_future<void> ready;
+      };
+      typedef std::shared_ptr<Node> NodePtr;
+
+      // Compute the beam exactly for each channel.
+      void computeBeam (double time, const casacore::MDirection& direction,
+                        const casacore::Vector<double>& chanFreqs,
+                        double refFreq, int mode,
+                        const std::vector<StationList>& stations,
+                        LOFAR::StationResponse::matrix22c_t* beamValues);
+
+      //# Data members.
+      double                        itsUpdateTime;
+      double                        itsUpdateFreq;
+      double                        itsKeepTime;  //# keep nodes this long
+      double                        itsLastTime;  //# latest time asked for
+      ItrfConverter::ShPtr          itsItrfConverter;
+      std::mutex                    itsMutex;     //# guards itsNodes
+      std::map<NodeKey, NodePtr>    itsNodes;
+    };
+
+  } //# end namespace
+}
+
+#endif
+#endif
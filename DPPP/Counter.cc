@@ -72,20 +72,9 @@ namespace DP3 {
 
     bool Counter::process (const DPBuffer& buf)
     {
-      const IPosition& shape = buf.getFlags().shape();
-      uint nrcorr = shape[0];
-      uint nrchan = shape[1];
-      uint nrbl   = shape[2];
-      const bool* flagPtr = buf.getFlags().data();
-      for (uint i=0; i<nrbl; ++i) {
-        for (uint j=0; j<nrchan; ++j) {
-          if (*flagPtr) {
-            itsFlagCounter.incrBaseline(i);
-            itsFlagCounter.incrChannel(j);
-          }
-          flagPtr += nrcorr;    // only count 1st corr
-        }
-      }
+      // Pack the flags (of the 1st corr only) and count the set bits.
+      itsFlags.fromCube (buf.getFlags());
+      itsFlagCounter.countFlags (itsFlags);
       // Let the next step do its processing.
       getNextStep()->process (buf);
       itsCount++;
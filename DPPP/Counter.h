@@ -29,6 +29,7 @@
 
 #include "DPInput.h"
 #include "DPBuffer.h"
+#include "FlagBitmap.h"
 #include "FlagCounter.h"
 
 namespace DP3 {
@@ -74,6 +75,7 @@ namespace DP3 {
       bool        itsFlagData;
       uint        itsCount;
       FlagCounter itsFlagCounter;
+      FlagBitmap  itsFlags;       //# packed flags of the current time slot
     };
 
   } //# end namespace
@@ -23,11 +23,36 @@
 
 #include "DPBuffer.h"
 
+#include <casacore/casa/Containers/Allocator.h>
+
+#include <utility>
+
 using namespace casacore;
 
 namespace DP3 {
   namespace DPPP {
 
+    namespace {
+      // Allocate an array with an extra time axis and return the parts
+      // for each time slot.
+      template<typename T>
+      std::vector<Array<T>> makeSlices (const IPosition& shape, uint ntime)
+      {
+        IPosition blockShape (shape.concatenate (IPosition(1, ntime)));
+        Array<T> block (blockShape, ArrayInitPolicies::NO_INIT,
+                        AlignedAllocator<T,64>::value);
+        IPosition start (blockShape.size(), 0);
+        IPosition end (blockShape - 1);
+        std::vector<Array<T>> slices;
+        slices.reserve (ntime);
+        for (uint i=0; i<ntime; ++i) {
+          start[shape.size()] = end[shape.size()] = i;
+          slices.push_back (block(start, end).reform(shape));
+        }
+        return slices;
+      }
+    }
+
     DPBuffer::DPBuffer()
       : itsTime     (0),
         itsExposure (0)
@@ -53,6 +78,25 @@ namespace DP3 {
       return *this;
     }
 
+    DPBuffer::DPBuffer (DPBuffer&& that)
+    {
+      operator= (std::move(that));
+    }
+
+    DPBuffer& DPBuffer::operator= (DPBuffer&& that)
+    {
+      if (this != &that) {
+        operator= (static_cast<const DPBuffer&>(that));
+        that.itsRowNrs.reference (Vector<uint>());
+        that.itsData.reference (Cube<Complex>());
+        that.itsFlags.reference (Cube<bool>());
+        that.itsWeights.reference (Cube<float>());
+        that.itsUVW.reference (Matrix<double>());
+        that.itsFullResFlags.reference (Cube<bool>());
+      }
+      return *this;
+    }
+
     void DPBuffer::copy (const DPBuffer& that)
     {
       if (this != &that) {
@@ -101,6 +145,37 @@ namespace DP3 {
       }
     }
 
+    std::vector<DPBuffer> DPBuffer::makeBatch (const IPosition& shape,
+                                               uint ntime, bool data,
+                                               bool weights, bool uvw)
+    {
+      std::vector<DPBuffer> bufs(ntime);
+      std::vector<Array<bool>> flags = makeSlices<bool> (shape, ntime);
+      for (uint i=0; i<ntime; ++i) {
+        bufs[i].itsFlags.reference (flags[i]);
+      }
+      if (data) {
+        std::vector<Array<Complex>> arrs = makeSlices<Complex> (shape, ntime);
+        for (uint i=0; i<ntime; ++i) {
+          bufs[i].itsData.reference (arrs[i]);
+        }
+      }
+      if (weights) {
+        std::vector<Array<float>> arrs = makeSlices<float> (shape, ntime);
+        for (uint i=0; i<ntime; ++i) {
+          bufs[i].itsWeights.reference (arrs[i]);
+        }
+      }
+      if (uvw) {
+        std::vector<Array<double>> arrs =
+          makeSlices<double> (IPosition(2, 3, shape[2]), ntime);
+        for (uint i=0; i<ntime; ++i) {
+          bufs[i].itsUVW.reference (arrs[i]);
+        }
+      }
+      return bufs;
+    }
+
     void DPBuffer::mergeFullResFlags (Cube<bool>& fullResFlags,
                                       const Cube<bool>& flags)
     {
@@ -31,6 +31,8 @@
 #include <casacore/casa/Arrays/Cube.h>
 #include <casacore/casa/BasicSL/Complex.h>
 
+#include <vector>
+
 namespace DP3 {
   namespace DPPP {
 
@@ -64,7 +66,11 @@ namespace DP3 {
     //   <td>The data flags as [ncorr,nchan,nbaseline] (True is bad).
     //       Note that the ncorr axis is redundant because NDPPP will always
     //       have the same flag for all correlations. The reason all
-    //       correlations are there is because the MS expects them.</td>
+    //       correlations are there is because the MS expects them.
+    //       DPBuffer always stores the flags as this Cube, because the
+    //       steps use it directly. A step keeping the flags of many time
+    //       slots or only counting them can convert them to a FlagBitmap,
+    //       which holds one bit per channel and baseline.</td>
     //  </tr>
     //  <tr>
     //   <td>WEIGHT</td>
@@ -128,12 +134,28 @@ namespace DP3 {
       // Assignment uses reference copies.
       DPBuffer& operator= (const DPBuffer&);
 
+      // The move constructor and assignment take over the arrays of that
+      // and leave that with empty arrays. They are used to hand a buffer on
+      // (e.g. from a DPBufferPool) without keeping a reference in the source,
+      // so the arrays are free again as soon as the new owner releases them.
+      DPBuffer (DPBuffer&&);
+      DPBuffer& operator= (DPBuffer&&);
+
       // Make a deep copy of all arrays in that to this.
       void copy (const DPBuffer& that);
 
       // Reference only the arrays that are filled in that.
       void referenceFilled (const DPBuffer& that);
 
+      // Make a batch of ntime buffers for DPStep::processBatch.
+      // The flags (and optionally data, weights and uvw) of the buffers
+      // are consecutive parts of single 64-byte aligned arrays with shape
+      // [ncorr,nchan,nbl,ntime] (uvw: [3,nbl,ntime]), where shape gives
+      // [ncorr,nchan,nbl]. The contents of the arrays are undefined.
+      static std::vector<DPBuffer> makeBatch (const casacore::IPosition& shape,
+                                              uint ntime, bool data,
+                                              bool weights, bool uvw);
+
       // Set or get the visibility data per corr,chan,baseline.
       void setData (const casacore::Cube<casacore::Complex>& data)
         { itsData.reference (data); }
@@ -0,0 +1,148 @@
+//# DPBufferPool.cc: Process-wide pool of recycled DPBuffer arrays
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include "DPBufferPool.h"
+
+#include <casacore/casa/Containers/Allocator.h>
+
+#include <algorithm>
+
+using namespace casacore;
+
+namespace DP3 {
+  namespace DPPP {
+
+    namespace {
+      // An array is free if only the pool references it.
+      template<typename T>
+      bool isFree (const Array<T>& arr)
+      {
+        return arr.empty()  ||  arr.nrefs() == 1;
+      }
+
+      bool isFree (const DPBuffer& buf)
+      {
+        return isFree(buf.getData())  &&  isFree(buf.getFlags())  &&
+          isFree(buf.getWeights())  &&  isFree(buf.getUVW());
+      }
+
+      bool hasLayout (const DPBuffer& buf, const IPosition& shape,
+                      bool data, bool weights, bool uvw)
+      {
+        return buf.getFlags().shape().isEqual(shape)  &&
+          data    == !buf.getData().empty()  &&
+          weights == !buf.getWeights().empty()  &&
+          uvw     == !buf.getUVW().empty();
+      }
+    }
+
+    DPBufferPool& DPBufferPool::instance()
+    {
+      static DPBufferPool pool;
+      return pool;
+    }
+
+    DPBuffer DPBufferPool::get (const IPosition& shape,
+                                bool weights, bool uvw)
+    {
+      std::lock_guard<std::mutex> lock(itsMutex);
+      return find (shape, true, weights, uvw);
+    }
+
+    DPBuffer DPBufferPool::copy (const DPBuffer& that)
+    {
+      DPBuffer buf;
+      const IPosition& shape = that.getFlags().shape();
+      // Flags should always be filled, but do not fail if not.
+      if (that.getFlags().empty()  ||
+          !(that.getData().empty()  ||
+            that.getData().shape().isEqual(shape))) {
+        buf.copy (that);
+        return buf;
+      }
+      {
+        std::lock_guard<std::mutex> lock(itsMutex);
+        buf = find (shape, !that.getData().empty(),
+                    !that.getWeights().empty(), !that.getUVW().empty());
+      }
+      // The shapes match, so the copy is done in the pooled arrays.
+      buf.copy (that);
+      return buf;
+    }
+
+    DPBuffer& DPBufferPool::find (const IPosition& shape,
+                                  bool data, bool weights, bool uvw)
+    {
+      for (DPBuffer& buf : itsBuffers) {
+        if (hasLayout (buf, shape, data, weights, uvw)  &&  isFree (buf)) {
+          return buf;
+        }
+      }
+      // No free buffer; first release the free buffers that have another
+      // layout, because they are probably not needed anymore.
+      itsBuffers.erase (std::remove_if (itsBuffers.begin(), itsBuffers.end(),
+                                        [](const DPBuffer& buf)
+                                        { return isFree(buf); }),
+                        itsBuffers.end());
+      DPBuffer buf;
+      if (data) {
+        buf.setData (Cube<Complex> (shape, ArrayInitPolicies::NO_INIT,
+                                    AlignedAllocator<Complex,64>::value));
+      }
+      buf.setFlags (Cube<bool> (shape, ArrayInitPolicies::NO_INIT,
+                                AlignedAllocator<bool,64>::value));
+      if (weights) {
+        buf.setWeights (Cube<float> (shape, ArrayInitPolicies::NO_INIT,
+                                     AlignedAllocator<float,64>::value));
+      }
+      if (uvw) {
+        buf.setUVW (Matrix<double> (IPosition(2, 3, shape[2]),
+                                    ArrayInitPolicies::NO_INIT,
+                                    AlignedAllocator<double,64>::value));
+      }
+      itsBuffers.push_back (std::move(buf));
+      return itsBuffers.back();
+    }
+
+    void DPBufferPool::clear()
+    {
+      std::lock_guard<std::mutex> lock(itsMutex);
+      itsBuffers.erase (std::remove_if (itsBuffers.begin(), itsBuffers.end(),
+                                        [](const DPBuffer& buf)
+                                        { return isFree(buf); }),
+                        itsBuffers.end());
+    }
+
+    size_t DPBufferPool::size() const
+    {
+      std::lock_guard<std::mutex> lock(itsMutex);
+      return itsBuffers.size();
+    }
+
+    size_t DPBufferPool::nused() const
+    {
+      std::lock_guard<std::mutex> lock(itsMutex);
+      return std::count_if (itsBuffers.begin(), itsBuffers.end(),
+                            [](const DPBuffer& buf) { return !isFree(buf); });
+    }
+
+  } //# end namespace
+}
@@ -0,0 +1,98 @@
+//# DPBufferPool.h: Process-wide pool of recycled DPBuffer arrays
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_DPBUFFERPOOL_H
+#define DPPP_DPBUFFERPOOL_H
+
+/// @file
+/// @brief Process-wide pool of recycled DPBuffer arrays
+
+#include "DPBuffer.h"
+
+#include <casacore/casa/Arrays/IPosition.h>
+
+#include <mutex>
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    // @ingroup NDPPP
+
+    // This class keeps the DPBuffer arrays of steps that hold on to many
+    // time slots (e.g. Interpolate), so they are recycled instead of
+    // allocated and freed for each time slot.
+    //
+    // The pool uses the reference counting of the casacore arrays to hand
+    // out ownership. A buffer returned by get or copy references arrays that
+    // are also referenced by the pool. As soon as all other references are
+    // gone (e.g. the DPBuffer is destructed or its arrays are resized or
+    // reference other arrays), the arrays are free again and can be handed
+    // out by a next call. Thus a buffer can be passed on, moved or kept
+    // by a next step without telling the pool.
+    //
+    // The data, flag, weight and uvw arrays are allocated with 64-byte
+    // alignment, so vectorized loops over them can use aligned loads.
+    // The contents of a new or recycled array are undefined.
+    //
+    // The functions are thread-safe, so steps running in different threads
+    // can share the pool.
+
+    class DPBufferPool
+    {
+    public:
+      // Get the process-wide pool.
+      static DPBufferPool& instance();
+
+      // Get a buffer with data and flags arrays with shape [ncorr,nchan,nbl].
+      // Optionally the buffer gets weights of the same shape and
+      // uvw with shape [3,nbl] as well.
+      DPBuffer get (const casacore::IPosition& shape,
+                    bool weights=false, bool uvw=false);
+
+      // Get a buffer holding a deep copy of that.
+      // Only the arrays filled in that are filled in the buffer.
+      DPBuffer copy (const DPBuffer& that);
+
+      // Release all free arrays.
+      void clear();
+
+      // Get the number of buffers kept by the pool and how many are in use.
+      size_t size() const;
+      size_t nused() const;
+
+    private:
+      DPBufferPool() = default;
+
+      // Find or allocate a buffer with the given shape and arrays.
+      // The mutex must be locked.
+      DPBuffer& find (const casacore::IPosition& shape,
+                      bool data, bool weights, bool uvw);
+
+      //# Data members.
+      mutable std::mutex    itsMutex;
+      std::vector<DPBuffer> itsBuffers;
+    };
+
+  } //# end namespace
+}
+
+#endif
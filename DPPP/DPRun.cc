@@ -49,12 +49,14 @@
 #include "Upsample.h"
 #include "Filter.h"
 #include "Counter.h"
+#include "QueueStep.h"
 #include "ProgressMeter.h"
 #include "DPLogger.h"
 
 #include "../Common/Timer.h"
 #include "../Common/StreamUtil.h"
 #include "../Common/OpenMP.h"
+#include "../Common/ThreadPool.h"
 
 #include <casacore/casa/OS/Path.h>
 #include <casacore/casa/OS/DirectoryIterator.h>
@@ -62,6 +64,8 @@
 #include <casacore/casa/OS/DynLib.h>
 #include <casacore/casa/Utilities/Regex.h>
 
+#include <algorithm>
+
 namespace DP3 {
   namespace DPPP {
 
@@ -131,12 +135,37 @@ namespace DP3 {
 
       bool showcounts = parset.getBool ("showcounts", true);
 
+      // numthreads is the size of the thread pool shared by all steps and
+      // the OpenMP thread count. It is not a hard cap on the number of
+      // threads: queue, read-ahead and write-behind threads, the read pool
+      // of MultiMSReader and the asynchronous solve of DDECal come on top.
       uint numThreads = parset.getInt("numthreads", OpenMP::maxThreads());
       OpenMP::setNumThreads(numThreads);
+      ThreadPool::SetInstanceNThreads(numThreads);
 
       // Create the steps, link them toggether
       DPStep::ShPtr firstStep = makeSteps (parset, "", 0);
 
+      // Each queue runs the next steps in its own thread, so the OpenMP
+      // threads are divided over the queue threads and this thread.
+      // The ThreadPool is not divided; steps in different threads take
+      // turns using it.
+      std::vector<QueueStep*> queues;
+      for (DPStep::ShPtr step = firstStep; step; step = step->getNextStep()) {
+        QueueStep* queue = dynamic_cast<QueueStep*>(step.get());
+        if (queue) {
+          queues.push_back (queue);
+        }
+      }
+      if (! queues.empty()) {
+        uint nThreadsPerStage = std::max (1u, uint(numThreads /
+                                                   (queues.size() + 1)));
+        OpenMP::setNumThreads (nThreadsPerStage);
+        for (QueueStep* queue : queues) {
+          queue->setNThreads (nThreadsPerStage);
+        }
+      }
+
       // Let all steps fill their DPInfo object using the info from the previous step.
       DPInfo lastInfo = firstStep->setInfo (DPInfo());
 
@@ -240,6 +269,13 @@ namespace DP3 {
     {
       DPStep::ShPtr firstStep;
       DPStep::ShPtr lastStep;
+      // In pipelined mode the steps of the main pipeline are executed in
+      // their own threads. The steps in a Split step are always executed
+      // in the thread of the Split step.
+      uint queueSize = 0;
+      if (!reader  &&  parset.getBool ("pipelined", false)) {
+        queueSize = parset.getUint ("pipelinequeuesize", 4);
+      }
       if (!reader) {
         // Get input and output MS name.
         // Those parameters were always called msin and msout.
@@ -280,7 +316,10 @@ namespace DP3 {
         // In the future it might be possible to have a simulation step instead.
         // Create MSReader step if input ms given.
         if (inNames.size() == 1) {
-          reader = new MSReader (inNames[0], parset, "msin.");
+          MSReader* msReader = new MSReader (inNames[0], parset, "msin.");
+          msReader->setBatchSize (parset.getUint ("batchsize", 1));
+          msReader->setReadAhead (parset.getUint ("msin.readahead", 0));
+          reader = msReader;
         } else {
           reader = new MultiMSReader (inNames, parset, "msin.");
         }
@@ -305,6 +344,8 @@ namespace DP3 {
         }
 
         string type = parset.getString(prefix+"type", defaulttype);
+        // An output step can write in the background.
+        uint writeBehind = 0;
         boost::algorithm::to_lower(type);
         // Define correct name for AOFlagger synonyms.
         if (type == "aoflagger") {
@@ -350,10 +391,17 @@ namespace DP3 {
           step = DPStep::ShPtr(new Split (reader, parset, prefix));
         } else if (type == "out" || type=="output" || type=="msout") {
           step = makeOutputStep(dynamic_cast<MSReader*>(reader), parset, prefix, currentMSName);
+          writeBehind = parset.getUint (prefix + "writebehind", 0);
         } else {
           // Maybe the step is defined in a dynamic library.
           step = findStepCtor(type) (reader, parset, prefix);
         }
+        if (writeBehind > 0) {
+          addQueueStep (parset, prefix, std::max(queueSize, writeBehind),
+                        lastStep, writeBehind);
+        } else if (queueSize > 0) {
+          addQueueStep (parset, prefix, queueSize, lastStep);
+        }
         if (lastStep) {
           lastStep->setNextStep (step);
         }
@@ -370,6 +418,13 @@ namespace DP3 {
           steps[steps.size()-1] != "msout" &&
           steps[steps.size()-1] != "split")) {
         step = makeOutputStep(dynamic_cast<MSReader*>(reader), parset, "msout.", currentMSName);
+        uint writeBehind = parset.getUint ("msout.writebehind", 0);
+        if (writeBehind > 0) {
+          addQueueStep (parset, "msout.", std::max(queueSize, writeBehind),
+                        lastStep, writeBehind);
+        } else if (queueSize > 0) {
+          addQueueStep (parset, "msout.", queueSize, lastStep);
+        }
         lastStep->setNextStep (step);
         lastStep = step;
       }
@@ -384,6 +439,22 @@ namespace DP3 {
       return firstStep;
     }
 
+    void DPRun::addQueueStep (const ParameterSet& parset,
+                              const string& prefix, uint queueSize,
+                              DPStep::ShPtr& lastStep, uint maxBatch)
+    {
+      // A step can share the thread of its previous step, which is useful
+      // for cheap steps. Nothing is done for the first step.
+      if (!lastStep  ||  !parset.getBool (prefix + "thread", true)) {
+        return;
+      }
+      DPStep::ShPtr queue (new QueueStep (queueSize,
+                                          prefix.substr(0, prefix.size()-1),
+                                          maxBatch));
+      lastStep->setNextStep (queue);
+      lastStep = queue;
+    }
+
     DPStep::ShPtr DPRun::makeOutputStep (MSReader* reader,
                                          const ParameterSet& parset,
                                          const string& prefix,
@@ -40,6 +40,22 @@ namespace DP3 {
     // This class contains a single static function that creates and executes
     // the steps defined in the parset file.
     // The parset file is documented on the LOFAR wiki.
+    //
+    // Normally all steps are executed in the same thread, one time slot after
+    // the other. If <src>pipelined=true</src> is given, each step runs in its
+    // own thread; the steps are connected by QueueStep objects holding at most
+    // <src>pipelinequeuesize</src> (default 4) time slots. In this way, for
+    // example, reading, flagging and writing overlap in time. A cheap step can
+    // stay in the thread of its previous step using <src>step.thread=false</src>.
+    //
+    // With <src>batchsize=n</src> the MSReader gives n time slots at a time
+    // to DPStep::processBatch, which reduces the per time slot overhead of
+    // steps having a native implementation of it.
+    // With <src>msin.readahead=k</src> a background thread reads up to k
+    // time slots ahead, so the steps do not have to wait for the disk.
+    // Similarly, with <src>msout.writebehind=k</src> the output step runs in
+    // a separate thread with a queue of k time slots, and writes the queued
+    // time slots together.
 
     class DPRun
     {
@@ -68,6 +84,15 @@ namespace DP3 {
                                       DPInput* reader);
 
     private:
+      // Insert a QueueStep after lastStep, so the step to be added next
+      // (and the steps after it) run in a separate thread.
+      // It is not done if the step's parameter <src>thread</src> is false.
+      // If maxBatch > 1, the queued time slots are given in batches to the
+      // next step (used for write-behind).
+      static void addQueueStep (const ParameterSet& parset,
+                                const string& prefix, uint queueSize,
+                                DPStep::ShPtr& lastStep, uint maxBatch=1);
+
       // Create an output step, either an MSWriter or an MSUpdater
       // If no data are modified (for example if only count was done),
       // still an MSUpdater is created, but it will not write anything.
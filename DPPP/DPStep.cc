@@ -31,6 +31,14 @@ namespace DP3 {
     DPStep::~DPStep()
     {}
 
+    bool DPStep::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      for (const DPBuffer& buf : bufs) {
+        process (buf);
+      }
+      return true;
+    }
+
     const DPInfo& DPStep::setInfo (const DPInfo& info)
     {
       // Update the info of this step using the given info.
@@ -34,6 +34,7 @@
 
 #include <iosfwd>
 #include <memory>
+#include <vector>
 
 namespace DP3 {
   namespace DPPP {
@@ -52,6 +53,8 @@ namespace DP3 {
     //  <li> 'process' is called continuously to process the next time slot.
     //        When processed, it should call 'process' of the next step.
     //        When done (i.e. at the end of the input), it should return False.
+    //  <li> 'processBatch' can be called instead of 'process' to process
+    //        a number of consecutive time slots at once.
     //  <li> 'finish' finishes the processing which could mean that 'process'
     //       of the next step has to be called several times. When done,
     //       it should call 'finish' of the next step.
@@ -82,6 +85,14 @@ namespace DP3 {
       // It should return False at the end.
       virtual bool process (const DPBuffer&) = 0;
 
+      // Process a batch of consecutive time slots.
+      // The buffers have the same shape. Usually their arrays are parts of
+      // contiguous [ncorr,nchan,nbl,ntime] arrays (see DPBuffer::makeBatch),
+      // so a step can loop over all time slots and baselines at once.
+      // When processed, it invokes processBatch (or process) of the next step.
+      // The default implementation calls process for each buffer.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish() = 0;
 
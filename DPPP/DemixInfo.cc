@@ -32,7 +32,7 @@
 
 #include "../Common/ParameterSet.h"
 #include "../Common/StreamUtil.h"
-#include "../Common/OpenMP.h"
+#include "../Common/ThreadPool.h"
 
 #include <casacore/measures/Measures/MDirection.h>
 #include <casacore/measures/Measures/MCDirection.h>
@@ -63,6 +63,8 @@ namespace DP3 {
         itsPropagateSolution(parset.getBool   (prefix+"propagatesolutions",
                                                false)),
         itsApplyBeam        (parset.getBool   (prefix+"applybeam", true)),
+        itsBeamUpdateTime   (parset.getDouble (prefix+"beamupdatetime", 0.)),
+        itsBeamUpdateFreq   (parset.getDouble (prefix+"beamupdatefreq", 0.)),
         itsSolveBoth        (parset.getBool   (prefix+"solveboth", false)),
         itsDoSubtract       (parset.getBool   (prefix+"subtract", true)),
         itsTargetHandling   (parset.getUint   (prefix+"targethandling", 0)),
@@ -88,7 +90,7 @@ namespace DP3 {
         itsTimeIntervalAvg  (0)
     {
       if (itsNTimeChunk == 0) {
-        itsNTimeChunk = OpenMP::maxThreads();
+        itsNTimeChunk = ThreadPool::GetInstance().NThreads();
       }
       // Get delta in arcsec and take cosine of it (convert to radians first).
       double delta = parset.getDouble (prefix+"target.delta", 60.);
@@ -338,6 +340,8 @@ namespace DP3 {
       os << "  propagatesolutions: " << (itsPropagateSolution ? "True":"False")
          << endl;
       os << "  applybeam:          " << (itsApplyBeam ? "True":"False") << endl;
+      os << "  beamupdatetime:     " << itsBeamUpdateTime << endl;
+      os << "  beamupdatefreq:     " << itsBeamUpdateFreq << endl;
       os << "  solveboth:          " << (itsSolveBoth ? "True":"False") << endl;
       os << "  subtract:           " << (itsDoSubtract ? "True":"False")
          << endl;
@@ -89,6 +89,8 @@ namespace DP3 {
       bool   isAteamNearby() const               {return itsIsAteamNearby;}
       bool   propagateSolution() const           {return itsPropagateSolution;}
       bool   applyBeam() const                   {return itsApplyBeam;}
+      double beamUpdateTime() const              {return itsBeamUpdateTime;}
+      double beamUpdateFreq() const              {return itsBeamUpdateFreq;}
       bool   solveBoth() const                   {return itsSolveBoth;}
       bool   doSubtract() const                  {return itsDoSubtract;}
       const BaselineSelection& selBL() const     {return itsSelBL;}
@@ -162,6 +164,8 @@ namespace DP3 {
       bool                    itsIsAteamNearby;
       bool                    itsPropagateSolution;
       bool                    itsApplyBeam;
+      double                  itsBeamUpdateTime;    //# 0 = exact per time
+      double                  itsBeamUpdateFreq;    //# 0 = exact per channel
       bool                    itsSolveBoth;    //# solve if both stat solvable
       bool                    itsDoSubtract;
       uint                    itsTargetHandling;
@@ -23,6 +23,7 @@
 
 #include "DemixWorker.h"
 #include "Apply.h"
+#include "ApplyBeam.h"
 #include "Averager.h"
 #include "CursorUtilCasa.h"
 #include "DPBuffer.h"
@@ -106,7 +107,8 @@ namespace DP3 {
 
       // Read the antenna beam info from the MS.
       // Only take the stations actually used.
-      input->fillBeamInfo (itsAntBeamInfo, itsMix->antennaNames());
+      itsAntBeamInfo.resize (1);
+      input->fillBeamInfo (itsAntBeamInfo[0], itsMix->antennaNames());
 
       // Create the solve and subtract steps for the sources to be removed.
       // Solving consists of the following steps:
@@ -240,44 +242,10 @@ namespace DP3 {
                           itsMix->nchanOut(), itsMix->maxIter(),
                           itsMix->propagateSolution());
       itsBeamValues.resize (itsMix->nchanOutSubtr() * itsMix->nstation());
-      // Make a copy of the array position and directions, because using the
-      // same Measure object in multiple threads is not safe.
-      // The only way to make a deep copy if using a MeasureHolder which
-      // gets converted to/from a Record.
-      String msg;
-      {
-        Record rec;
-        MeasureHolder mh1(info.arrayPos());
-        assert (mh1.toRecord (msg, rec));
-        MeasureHolder mh2;
-        assert (mh2.fromRecord (msg, rec));
-        itsArrayPos = mh2.asMPosition();
-      }
-      {
-        Record rec;
-        MeasureHolder mh1(info.delayCenter());
-        assert (mh1.toRecord (msg, rec));
-        MeasureHolder mh2;
-        assert (mh2.fromRecord (msg, rec));
-        itsDelayCenter = mh2.asMDirection();
-      }
-      {
-        Record rec;
-        MeasureHolder mh1(info.tileBeamDir());
-        assert (mh1.toRecord (msg, rec));
-        MeasureHolder mh2;
-        assert (mh2.fromRecord (msg, rec));
-        itsTileBeamDir = mh2.asMDirection();
-      }
-      // Create the Measure ITRF conversion info given the array position.
-      // The time and direction are filled in later.
-      itsMeasFrame.set (itsArrayPos);
-      itsMeasFrame.set (MEpoch(MVEpoch(info.startTime()/86400), MEpoch::UTC));
-      itsMeasConverter.set (MDirection::J2000,
-                            MDirection::Ref(MDirection::ITRF, itsMeasFrame));
-      // Do a dummy conversion, because Measure initialization does not
-      // seem to be thread-safe.
-      dir2Itrf(itsDelayCenter);
+      // The beam cache is shared by all workers.
+      itsBeamCache = BeamCache::get (info, itsMix->antennaNames(),
+                                     itsMix->beamUpdateTime(),
+                                     itsMix->beamUpdateFreq());
     }
 
     void DemixWorker::process (const DPBuffer* bufin, uint nbufin,
@@ -448,10 +416,7 @@ namespace DP3 {
                               itsMix->freqDemix(),
                               uvwiter.matrix(),
                               itsPredictVis);
-          for(size_t i = 0; i < patchList[dr]->nComponents(); ++i)
-          {
-            simulator.simulate(patchList[dr]->component(i));
-          }
+          simulator.simulate(patchList[dr]->begin(), patchList[dr]->end());
           // Get and apply beam for target patch.
           applyBeam (t, patchList[dr]->position(), True);
           addStokesI (miter.matrix());
@@ -497,10 +462,7 @@ namespace DP3 {
                               itsMix->freqDemix(),
                               uvwiter.matrix(),
                               itsPredictVis);
-          for(size_t i = 0; i < patchList[dr]->nComponents(); ++i)
-          {
-            simulator.simulate(patchList[dr]->component(i));
-          }
+          simulator.simulate(patchList[dr]->begin(), patchList[dr]->end());
           // Get and apply beam.
           applyBeam (t, patchList[dr]->position(), True);
           // Keep the StokesI ampl ((XX+YY)/2).
@@ -763,20 +725,13 @@ namespace DP3 {
       if (! apply) {
         return;
       }
-      // Convert the directions to ITRF for the given time.
-      itsMeasFrame.resetEpoch (MEpoch(MVEpoch(time/86400), MEpoch::UTC));
-      LOFAR::StationResponse::vector3r_t refdir  = dir2Itrf(itsDelayCenter);
-      LOFAR::StationResponse::vector3r_t tiledir = dir2Itrf(itsTileBeamDir);
+      // Get the beam values for each station. The workers run in parallel,
+      // so the worker computes the values itself.
       MDirection dir (MVDirection(pos[0], pos[1]), MDirection::J2000);
-      LOFAR::StationResponse::vector3r_t srcdir = dir2Itrf(dir);
-      // Get the beam values for each station.
       uint nchan = chanFreqs.size();
-      for (size_t st=0; st<itsMix->nstation(); ++st) {
-        itsAntBeamInfo[st]->response (nchan, time, chanFreqs.cbegin(),
-                                      srcdir, itsMix->getInfo().refFreq(),
-                                      refdir, tiledir,
-                                      &(itsBeamValues[nchan*st]));
-      }
+      itsBeamCache->getBeam (time, dir, chanFreqs, itsMix->getInfo().refFreq(),
+                             ApplyBeam::DEFAULT, false, itsAntBeamInfo,
+                             itsBeamValues.data());
       // Apply the beam values of both stations to the predicted data.
       dcomplex tmp[4];
       for (size_t bl=0; bl<itsMix->nbl(); ++bl) {
@@ -805,17 +760,6 @@ namespace DP3 {
       }
     }
 
-    LOFAR::StationResponse::vector3r_t DemixWorker::dir2Itrf (const MDirection& dir)
-    {
-      const MDirection& itrfDir = itsMeasConverter(dir);
-      const Vector<Double>& itrf = itrfDir.getValue().getValue();
-      LOFAR::StationResponse::vector3r_t vec;
-      vec[0] = itrf[0];
-      vec[1] = itrf[1];
-      vec[2] = itrf[2];
-      return vec;
-    }
-
     void DemixWorker::addFactors (const DPBuffer& newBuf,
                                   Array<DComplex>& factorBuf)
     {
@@ -1121,10 +1065,8 @@ namespace DP3 {
               Simulator simulator(itsMix->phaseRef(), nSt, nBl, nCh,
                                   itsMix->baselines(), itsMix->freqDemix(),
                                   itsUVW, itsPredictVis);
-              for(size_t j = 0; j < itsMix->targetDemixList()[i]->nComponents(); ++j)
-              {
-                simulator.simulate(itsMix->targetDemixList()[i]->component(j));
-              }
+              simulator.simulate(itsMix->targetDemixList()[i]->begin(),
+                                 itsMix->targetDemixList()[i]->end());
               applyBeam (time, itsMix->targetDemixList()[i]->position(),
                          itsMix->applyBeam());
               itsModelVisDemix[dr]+=itsPredictVis;
@@ -1134,10 +1076,7 @@ namespace DP3 {
             Simulator simulator(itsDemixList[dr]->position(), nSt, nBl, nCh,
                                 itsMix->baselines(), itsMix->freqDemix(),
                                 itsUVW, itsModelVisDemix[dr]);
-            for(size_t i = 0; i < itsDemixList[dr]->nComponents(); ++i)
-            {
-              simulator.simulate(itsDemixList[dr]->component(i));
-            }
+            simulator.simulate(itsDemixList[dr]->begin(), itsDemixList[dr]->end());
             applyBeam (time, itsMix->ateamDemixList()[drOrig]->position(),
                        itsMix->applyBeam(), itsMix->freqDemix(),
                        itsModelVisDemix[dr].data());
@@ -1242,10 +1181,8 @@ namespace DP3 {
                                     nSt, nBl, nChSubtr, itsMix->baselines(),
                                     itsMix->freqSubtr(), itsUVW,
                                     itsModelVisSubtr[0]);
-                for(size_t i = 0; i < itsMix->ateamList()[drOrig]->nComponents(); ++i)
-                {
-                  simulator.simulate(itsMix->ateamList()[drOrig]->component(i));
-                }
+                simulator.simulate(itsMix->ateamList()[drOrig]->begin(),
+                                   itsMix->ateamList()[drOrig]->end());
 
                 applyBeam (subtrTime,
                            itsMix->ateamDemixList()[drOrig]->position(),
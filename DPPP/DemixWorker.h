@@ -29,6 +29,7 @@
 // @file
 // @brief DPPP step class to average in time and/or freq
 
+#include "BeamCache.h"
 #include "DemixInfo.h"
 #include "DPInput.h"
 #include "DPBuffer.h"
@@ -176,9 +177,6 @@ namespace DP3 {
                       const casacore::Vector<double>& chanFreqs,
                       dcomplex* data);
 
-      // Convert a direction to ITRF.
-      LOFAR::StationResponse::vector3r_t dir2Itrf (const casacore::MDirection&);
-      
       // Calculate the StokesI amplitude from the predicted visibilities.
       // (0.5 * (XX+YY))
       void calcStokesI (casacore::Matrix<float>& ampl);
@@ -239,13 +237,11 @@ namespace DP3 {
       vector<Patch::ConstPtr>               itsDemixList;
 #ifdef HAVE_LOFAR_BEAM
       //# The info needed to calculate the station beams.
-      vector<LOFAR::StationResponse::Station::Ptr> itsAntBeamInfo;
+      //# It is a list of one, because the worker computes the beam itself.
+      vector<BeamCache::StationList>        itsAntBeamInfo;
+      //# The beam cache shared with the other workers and steps.
+      BeamCache::ShPtr                      itsBeamCache;
 #endif
-      //# Measure objects unique to this worker (thread).
-      //# This is needed because they are not thread-safe.
-      casacore::MPosition                       itsArrayPos;
-      casacore::MDirection                      itsDelayCenter;
-      casacore::MDirection                      itsTileBeamDir;
 
       //# Variables set by setupDemix and used by handleDemix.
       uint                                  itsNDir;
@@ -270,9 +266,6 @@ namespace DP3 {
       //# shape #directions x #directions.
       vector<casacore::Array<casacore::DComplex> >  itsFactorsSubtr;
 
-      //# Variables for conversion of directions to ITRF.
-      casacore::MeasFrame                       itsMeasFrame;
-      casacore::MDirection::Convert             itsMeasConverter;
       vector<LOFAR::StationResponse::matrix22c_t>  itsBeamValues;  //# [nst,nch]
 
       //# Indices telling which Ateam sources to use.
@@ -44,7 +44,7 @@
 #include "../ParmDB/Parm.h"
 
 #include "../Common/ParameterSet.h"
-#include "../Common/OpenMP.h"
+#include "../Common/ThreadPool.h"
 #include "../Common/StreamUtil.h"
 
 #include <casacore/casa/Quanta/MVAngle.h>
@@ -146,7 +146,7 @@ namespace DP3 {
       itsFilter.setNextStep (nullStep);
       // Default nr of time chunks is maximum number of threads.
       if (itsNTimeChunk == 0) {
-        itsNTimeChunk = OpenMP::maxThreads();
+        itsNTimeChunk = ThreadPool::GetInstance().NThreads();
       }
       // Check that time windows fit integrally.
       if ((itsNTimeChunk * itsNTimeAvg) % itsNTimeAvgSubtr != 0)
@@ -425,7 +425,9 @@ namespace DP3 {
 
       os << "  ";
       FlagCounter::showPerc1 (os, self, duration);
-      os << " Demixer " << itsName << endl;
+      os << " Demixer " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(self));
+      os << endl;
 
       os << "          ";
       FlagCounter::showPerc1 (os, itsTimerPhaseShift.getElapsed(), self);
@@ -619,6 +621,7 @@ namespace DP3 {
     {
       // Nothing to do if only target direction.
       if (itsNDir <= 1) return;
+      ThreadPool::UsageScope usageScope(itsCoreUsage);
       int ncorr  = newBuf.getData().shape()[0];
       int nchan  = newBuf.getData().shape()[1];
       int nbl    = newBuf.getData().shape()[2];
@@ -636,8 +639,7 @@ namespace DP3 {
           if (i0 == itsNDir-1) {
             // The last direction is the target direction, so no need to
             // combine the factors. Take conj to get shift source to target.
-#pragma omp parallel for
-            for (int i=0; i<nbl; ++i) {
+            ThreadPool::GetInstance().For(0, nbl, [&](size_t i, size_t /*thread*/) {
               const bool*   flagPtr   = newBuf.getFlags().data() + i*ncc;
               const float*  weightPtr = newBuf.getWeights().data() + i*ncc;
               DComplex* factorPtr     = factorBuf.data() + (dirnr*nbl + i)*ncc;
@@ -654,11 +656,10 @@ namespace DP3 {
                   factorPtr++;
                 }
               }
-            } // end omp parallel for
+            });
           } else {
             // Different source directions; take both phase terms into account.
-#pragma omp parallel for
-            for (int i=0; i<nbl; ++i) {
+            ThreadPool::GetInstance().For(0, nbl, [&](size_t i, size_t /*thread*/) {
               const bool*   flagPtr   = newBuf.getFlags().data() + i*ncc;
               const float*  weightPtr = newBuf.getWeights().data() + i*ncc;
               DComplex* factorPtr     = factorBuf.data() + (dirnr*nbl + i)*ncc;
@@ -677,7 +678,7 @@ namespace DP3 {
                   factorPtr++;
                 }
               }
-            } // end omp parallel for
+            });
           }
 
           // Next direction pair.
@@ -695,6 +696,7 @@ namespace DP3 {
       // Nothing to do if only target direction.
       if (itsNDir <= 1) return;
       assert (! weightSums.empty());
+      ThreadPool::UsageScope usageScope(itsCoreUsage);
       bufOut.resize (IPosition(5, itsNDir, itsNDir,
                                itsNCorr, nChanOut, itsNBl));
       bufOut = DComplex(1,0);
@@ -705,12 +707,11 @@ namespace DP3 {
       uint dirnr = 0;
       for (uint d0=0; d0<itsNDir; ++d0) {
         for (uint d1=d0+1; d1<itsNDir; ++d1) {
-#pragma omp parallel for
           // Average factors by summing channels.
           // Note that summing in time is done in addFactors.
           // The sum per output channel is divided by the summed weight.
           // Note there is a summed weight per baseline,outchan,corr.
-          for (int k=0; k<int(itsNBl); ++k) {
+          ThreadPool::GetInstance().For(0, itsNBl, [&](size_t k, size_t /*thread*/) {
             const DComplex* phin = bufIn.data() + (dirnr*itsNBl + k)*nccin;
             DComplex* ph1 = bufOut.data() + k*nccdd + (d0*itsNDir + d1);
             DComplex* ph2 = bufOut.data() + k*nccdd + (d1*itsNDir + d0);
@@ -733,7 +734,7 @@ namespace DP3 {
                 ph2 += itsNDir*itsNDir;
               }
             }
-          } // end omp parallel for
+          });
           // Next input direction pair.
           dirnr++;
         }
@@ -855,7 +856,9 @@ namespace DP3 {
 
     void Demixer::demix()
     {
-      const size_t nThread = OpenMP::maxThreads();
+      ThreadPool& pool = ThreadPool::GetInstance();
+      ThreadPool::UsageScope usageScope(itsCoreUsage);
+      const size_t nThread = pool.NThreads();
       const size_t nTime = itsAvgResults[0]->size();
       const size_t nTimeSubtr = itsAvgResultSubtr->size();
       const size_t multiplier = itsNTimeAvg / itsNTimeAvgSubtr;
@@ -885,10 +888,9 @@ namespace DP3 {
 
       const_cursor<Baseline> cr_baseline(&(itsBaselines[0]));
 
-#pragma omp parallel for
-      for(size_t ts = 0; ts < nTime; ++ts)
+      // Every time slot is a large piece of work, so use a grain size of 1.
+      pool.For(0, nTime, 1, [&](size_t ts, size_t thread)
       {
-        const size_t thread = OpenMP::threadNum();
         ThreadPrivateStorage &storage = threadStorage[thread];
 
         // If solution propagation is disabled, re-initialize the thread-private
@@ -913,10 +915,7 @@ namespace DP3 {
           Simulator simulator(itsPatchList[dr]->position(), nSt, nBl, nCh,
                               itsBaselines, itsFreqDemix, storage.uvw,
                               storage.model[dr]);
-          for(size_t i = 0; i < itsPatchList[dr]->nComponents(); ++i)
-          {
-            simulator.simulate(itsPatchList[dr]->component(i));
-          }
+          simulator.simulate(itsPatchList[dr]->begin(), itsPatchList[dr]->end());
 
         }
         ///cout<<"modelvis="<<storage.model<<endl;
@@ -998,10 +997,7 @@ namespace DP3 {
               Simulator simulator(itsPatchList[dr]->position(), nSt, nBl,
                                   nChSubtr, itsBaselines, itsFreqSubtr,
                                   storage.uvw, storage.model_subtr);
-              for(size_t i = 0; i < itsPatchList[dr]->nComponents(); ++i)
-              {
-                simulator.simulate(itsPatchList[dr]->component(i));
-              }
+              simulator.simulate(itsPatchList[dr]->begin(), itsPatchList[dr]->end());
             }
 
             // Apply Jones matrices.
@@ -1051,7 +1047,7 @@ namespace DP3 {
         // Copy solutions to global solution array.
         copy(storage.unknowns.begin(), storage.unknowns.end(),
           &(itsUnknowns[(itsTimeIndex + ts) * nDr * nSt * 8]));
-      }
+      });
 
       // Store last known solutions.
       if(itsPropagateSolutions && nTime > 0)
@@ -34,6 +34,8 @@
 #include "PhaseShift.h"
 #include "Filter.h"
 
+#include "../Common/ThreadPool.h"
+
 #include <casacore/casa/Arrays/Cube.h>
 #include <casacore/casa/Quanta/Quantum.h>
 #include <casacore/measures/Measures/MDirection.h>
@@ -208,6 +210,7 @@ namespace DP3 {
       NSTimer                               itsTimerDemix;
       NSTimer                               itsTimerSolve;
       NSTimer                               itsTimerDump;
+      ThreadPool::CoreUsage                 itsCoreUsage;
     };
 
   } //# end namespace
@@ -32,7 +32,7 @@
 #include "../ParmDB/ParmValue.h"
 
 #include "../Common/ParameterSet.h"
-#include "../Common/OpenMP.h"
+#include "../Common/ThreadPool.h"
 #include "../Common/StreamUtil.h"
 
 #include <casacore/casa/Arrays/ArrayPartMath.h>
@@ -80,7 +80,7 @@ namespace DP3 {
       itsBufOut.resize(itsDemixInfo.ntimeChunk() * itsDemixInfo.ntimeOutSubtr());
       itsSolutions.resize(itsDemixInfo.ntimeChunk() * itsDemixInfo.ntimeOut());
       // Create a worker per thread.
-      int nthread = OpenMP::maxThreads();
+      int nthread = ThreadPool::GetInstance().NThreads();
       itsWorkers.reserve (nthread);
       for (int i=0; i<nthread; ++i) {
         itsWorkers.push_back (DemixWorker (itsInput, itsName, itsDemixInfo,
@@ -310,7 +310,9 @@ namespace DP3 {
       }
       os << "  ";
       FlagCounter::showPerc1 (os, self, duration);
-      os << " DemixerNew " << itsName << endl;
+      os << " DemixerNew " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(self));
+      os << endl;
       os << "          ";
       FlagCounter::showPerc1 (os, demix, self);
       os << " of it spent in demixing the data of which" << endl;
@@ -369,21 +371,24 @@ namespace DP3 {
                       / itsDemixInfo.ntimeAvgSubtr());
       int ntimeSol = ((itsNTime + itsDemixInfo.ntimeAvg() - 1)
                       / itsDemixInfo.ntimeAvg());
-#pragma omp parallel for schedule(dynamic)
-      for (int i=0; i<=lastChunk; ++i) {
-        if (i == lastChunk) {
-          itsWorkers[OpenMP::threadNum()].process
-            (&(itsBufIn[i*timeWindowIn]), lastNTimeIn,
-             &(itsBufOut[i*timeWindowOut]),
-             &(itsSolutions[i*timeWindowSol]),
-             itsNChunk+i);
-        } else {
-          itsWorkers[OpenMP::threadNum()].process
-            (&(itsBufIn[i*timeWindowIn]), timeWindowIn,
-             &(itsBufOut[i*timeWindowOut]),
-             &(itsSolutions[i*timeWindowSol]),
-             itsNChunk+i);
-        }
+      // Each chunk is a large piece of work, so use a grain size of 1.
+      {
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
+        ThreadPool::GetInstance().For(0, lastChunk+1, 1, [&](size_t i, size_t thread) {
+          if (int(i) == lastChunk) {
+            itsWorkers[thread].process
+              (&(itsBufIn[i*timeWindowIn]), lastNTimeIn,
+               &(itsBufOut[i*timeWindowOut]),
+               &(itsSolutions[i*timeWindowSol]),
+               itsNChunk+i);
+          } else {
+            itsWorkers[thread].process
+              (&(itsBufIn[i*timeWindowIn]), timeWindowIn,
+               &(itsBufOut[i*timeWindowOut]),
+               &(itsSolutions[i*timeWindowSol]),
+               itsNChunk+i);
+          }
+        });
       }
       itsNChunk += lastChunk+1;
       itsTimerDemix.stop();
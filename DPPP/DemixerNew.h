@@ -36,6 +36,8 @@
 
 #include "../ParmDB/ParmDB.h"
 
+#include "../Common/ThreadPool.h"
+
 #include <ostream>
 
 namespace DP3 {
@@ -137,6 +139,7 @@ namespace DP3 {
       NSTimer itsTimerDemix;
       NSTimer itsTimerDump;  //# writeSolutions
       NSTimer itsTimerNext;  //# next step (parallel to writeSolutions)
+      ThreadPool::CoreUsage itsCoreUsage;
     };
 
   } //# end namespace
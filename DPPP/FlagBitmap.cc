@@ -0,0 +1,162 @@
+//# FlagBitmap.cc: Flags packed as one bit per channel and baseline
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#include "FlagBitmap.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+
+using namespace casacore;
+
+namespace DP3 {
+  namespace DPPP {
+
+    FlagBitmap::FlagBitmap()
+      : itsNChan  (0),
+        itsNBl    (0),
+        itsNWords (0)
+    {}
+
+    FlagBitmap::FlagBitmap (uint nchan, uint nbl)
+    {
+      resize (nchan, nbl);
+    }
+
+    void FlagBitmap::resize (uint nchan, uint nbl)
+    {
+      itsNChan  = nchan;
+      itsNBl    = nbl;
+      itsNWords = (nchan + 63) / 64;
+      itsBits.assign (size_t(itsNWords) * nbl, 0);
+    }
+
+    void FlagBitmap::setAll (bool flag)
+    {
+      if (! flag) {
+        std::fill (itsBits.begin(), itsBits.end(), 0);
+        return;
+      }
+      if (itsNWords == 0) {
+        return;
+      }
+      // Keep the unused bits in the last word of a baseline 0.
+      uint64_t last = (itsNChan%64 == 0 ? ~uint64_t(0) :
+                       (uint64_t(1) << (itsNChan%64)) - 1);
+      for (uint bl=0; bl<itsNBl; ++bl) {
+        uint64_t* words = &(itsBits[bl*itsNWords]);
+        std::fill (words, words+itsNWords-1, ~uint64_t(0));
+        words[itsNWords-1] = last;
+      }
+    }
+
+    void FlagBitmap::fromCube (const Cube<bool>& flags)
+    {
+      const IPosition& shape = flags.shape();
+      uint ncorr = shape[0];
+      if (uint(shape[1]) != itsNChan  ||  uint(shape[2]) != itsNBl) {
+        resize (shape[1], shape[2]);
+      }
+      const bool* flagPtr = flags.data();
+      uint64_t* words = itsBits.data();
+      for (uint bl=0; bl<itsNBl; ++bl) {
+        for (uint w=0; w<itsNWords; ++w) {
+          uint nr = std::min (64u, itsNChan - w*64);
+          uint64_t word = 0;
+          for (uint i=0; i<nr; ++i) {
+            word |= uint64_t(*flagPtr) << i;
+            flagPtr += ncorr;
+          }
+          *words++ = word;
+        }
+      }
+    }
+
+    void FlagBitmap::toCube (Cube<bool>& flags, uint ncorr) const
+    {
+      IPosition shape (3, ncorr, itsNChan, itsNBl);
+      if (! flags.shape().isEqual (shape)) {
+        flags.resize (shape);
+      }
+      bool* flagPtr = flags.data();
+      const uint64_t* words = itsBits.data();
+      for (uint bl=0; bl<itsNBl; ++bl) {
+        for (uint w=0; w<itsNWords; ++w) {
+          uint nr = std::min (64u, itsNChan - w*64);
+          uint64_t word = *words++;
+          for (uint i=0; i<nr; ++i) {
+            bool flag = (word >> i) & 1;
+            std::fill (flagPtr, flagPtr+ncorr, flag);
+            flagPtr += ncorr;
+          }
+        }
+      }
+    }
+
+    FlagBitmap& FlagBitmap::operator|= (const FlagBitmap& that)
+    {
+      assert (that.itsBits.size() == itsBits.size());
+      for (size_t i=0; i<itsBits.size(); ++i) {
+        itsBits[i] |= that.itsBits[i];
+      }
+      return *this;
+    }
+
+    FlagBitmap& FlagBitmap::operator&= (const FlagBitmap& that)
+    {
+      assert (that.itsBits.size() == itsBits.size());
+      for (size_t i=0; i<itsBits.size(); ++i) {
+        itsBits[i] &= that.itsBits[i];
+      }
+      return *this;
+    }
+
+    FlagBitmap& FlagBitmap::andNot (const FlagBitmap& that)
+    {
+      assert (that.itsBits.size() == itsBits.size());
+      for (size_t i=0; i<itsBits.size(); ++i) {
+        itsBits[i] &= ~that.itsBits[i];
+      }
+      return *this;
+    }
+
+    uint64_t FlagBitmap::count() const
+    {
+      uint64_t nr = 0;
+      for (uint64_t word : itsBits) {
+        nr += std::bitset<64>(word).count();
+      }
+      return nr;
+    }
+
+    uint FlagBitmap::countBaseline (uint bl) const
+    {
+      uint nr = 0;
+      const uint64_t* words = baseline(bl);
+      for (uint w=0; w<itsNWords; ++w) {
+        nr += std::bitset<64>(words[w]).count();
+      }
+      return nr;
+    }
+
+  } //# end namespace
+}
@@ -0,0 +1,124 @@
+//# FlagBitmap.h: Flags packed as one bit per channel and baseline
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#ifndef DPPP_FLAGBITMAP_H
+#define DPPP_FLAGBITMAP_H
+
+// @file
+// @brief Flags packed as one bit per channel and baseline
+
+#include <casacore/casa/Arrays/Cube.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    // @ingroup NDPPP
+
+    // This class holds the flags of a time slot as one bit per channel and
+    // baseline. As described in DPBuffer, the flags of all correlations of a
+    // data point are the same, so the correlation axis is not stored. It
+    // uses 32 times less memory than the [ncorr,nchan,nbl] Cube<bool> of
+    // 4 correlations, which matters for steps keeping the flags of many
+    // time slots (like AOFlaggerStep).
+    //
+    // The bits of a baseline start at a new 64-bit word, so the flags can be
+    // combined and counted a word at a time, and different threads can
+    // change the flags of different baselines.
+    //
+    // It is not the flag store of DPBuffer; fromCube and toCube convert
+    // from and to the Cube<bool> flags in a DPBuffer.
+
+    class FlagBitmap
+    {
+    public:
+      // Create an empty bitmap.
+      FlagBitmap();
+
+      // Create a bitmap for the given number of channels and baselines.
+      // All flags are cleared.
+      FlagBitmap (uint nchan, uint nbl);
+
+      // Resize the bitmap and clear all flags.
+      void resize (uint nchan, uint nbl);
+
+      // Get the sizes.
+      uint nchan() const
+        { return itsNChan; }
+      uint nbaselines() const
+        { return itsNBl; }
+
+      // Get the number of 64-bit words used per baseline.
+      uint wordsPerBaseline() const
+        { return itsNWords; }
+
+      // Get the number of bytes used for the given sizes.
+      static size_t nbytes (uint nchan, uint nbl)
+        { return sizeof(uint64_t) * nbl * ((nchan + 63) / 64); }
+
+      // Get or set the flag of a data point.
+      bool get (uint chan, uint bl) const
+        { return (itsBits[bl*itsNWords + chan/64] >> (chan%64)) & 1; }
+      void set (uint chan, uint bl)
+        { itsBits[bl*itsNWords + chan/64] |= uint64_t(1) << (chan%64); }
+      void clear (uint chan, uint bl)
+        { itsBits[bl*itsNWords + chan/64] &= ~(uint64_t(1) << (chan%64)); }
+
+      // Get a pointer to the words of a baseline. Channel i is bit i%64 of
+      // word i/64; the unused bits in the last word are always 0.
+      const uint64_t* baseline (uint bl) const
+        { return &(itsBits[bl*itsNWords]); }
+
+      // Set or clear all flags.
+      void setAll (bool flag);
+
+      // Take over the flags of the first correlation of the cube with shape
+      // [ncorr,nchan,nbl]. The bitmap is resized if needed.
+      void fromCube (const casacore::Cube<bool>& flags);
+
+      // Fill all correlations of the cube from the bitmap. The cube is
+      // resized to [ncorr,nchan,nbl] if its shape differs.
+      void toCube (casacore::Cube<bool>& flags, uint ncorr) const;
+
+      // Combine the flags with those of that. The shapes must be the same.
+      // andNot clears the flags set in that.
+      FlagBitmap& operator|= (const FlagBitmap& that);
+      FlagBitmap& operator&= (const FlagBitmap& that);
+      FlagBitmap& andNot (const FlagBitmap& that);
+
+      // Count the number of flags set in all baselines or in one baseline.
+      uint64_t count() const;
+      uint countBaseline (uint bl) const;
+
+    private:
+      uint itsNChan;
+      uint itsNBl;
+      uint itsNWords;                  //# nr of words per baseline
+      std::vector<uint64_t> itsBits;   //# nwords,nbl
+    };
+
+  } //# end namespace
+}
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "FlagCounter.h"
 #include "DPInput.h"
+#include "FlagBitmap.h"
 
 #include <casacore/tables/Tables/Table.h>
 #include <casacore/tables/Tables/TableDesc.h>
@@ -99,6 +100,22 @@ namespace DP3 {
       std::fill (itsCorrCounts.begin(),itsCorrCounts.end(), 0);
     }
 
+    void FlagCounter::countFlags (const FlagBitmap& flags)
+    {
+      assert (flags.nbaselines() == itsBLCounts.size());
+      assert (flags.nchan() == itsChanCounts.size());
+      for (uint bl=0; bl<flags.nbaselines(); ++bl) {
+        const uint64_t* words = flags.baseline(bl);
+        for (uint w=0; w<flags.wordsPerBaseline(); ++w) {
+          // Only visit the bits set by clearing the lowest one each time.
+          for (uint64_t word=words[w]; word!=0; word&=word-1) {
+            itsBLCounts[bl]++;
+            itsChanCounts[w*64 + __builtin_ctzll(word)]++;
+          }
+        }
+      }
+    }
+
     void FlagCounter::add (const FlagCounter& that)
     {
       // Add that to this after checking for equal sizes.
@@ -329,6 +346,12 @@ namespace DP3 {
       os.fill (prev);
     }
 
+    void FlagCounter::showCores (ostream& os, double cores)
+    {
+      int ncores = int(10. * cores + 0.5);
+      os << " (" << ncores/10 << '.' << ncores%10 << " cores)";
+    }
+
     void FlagCounter::saveStation (int64_t npoints, const Vector<int64_t>& nused,
                                    const Vector<int64_t>& count) const
     {
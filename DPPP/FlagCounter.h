@@ -38,6 +38,7 @@ namespace DP3 {
   namespace DPPP {
     //# Forward Declarations.
     class DPInfo;
+    class FlagBitmap;
 
     // @ingroup NDPPP
 
@@ -76,6 +77,10 @@ namespace DP3 {
       void incrCorrelation (uint corr)
         { itsCorrCounts[corr]++; }
 
+      // Increment the counts per baseline and channel for all flags set
+      // in the bitmap.
+      void countFlags (const FlagBitmap& flags);
+
       // Add the contents of that to this.
       void add (const FlagCounter& that);
 
@@ -98,6 +103,10 @@ namespace DP3 {
       // Show percentage with 3 decimals.
       static void showPerc3 (std::ostream&, double value, double total);
 
+      // Show the average number of cores used (with 1 decimal) as
+      // " (x.y cores)".
+      static void showCores (std::ostream&, double cores);
+
     private:
       // Save the percentages per station in a table.
       void saveStation (int64_t npoints, const casacore::Vector<int64_t>& nused,
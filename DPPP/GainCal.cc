@@ -40,7 +40,7 @@
 
 #include "../Common/ParameterSet.h"
 #include "../Common/StringUtil.h"
-#include "../Common/OpenMP.h"
+#include "../Common/ThreadPool.h"
 
 #include <fstream>
 #include <ctime>
@@ -302,7 +302,7 @@ namespace DP3 {
       itsChunkStartTime = info().startTime();
 
       if (itsDebugLevel>0) {
-        assert(OpenMP::maxThreads()==1);
+        assert(ThreadPool::GetInstance().NThreads()==1);
         assert(itsTimeSlotsPerParmUpdate >= info().ntime());
         itsAllSolutions.resize(IPosition(6,
                                iS[0].numCorrelations(),
@@ -358,7 +358,9 @@ namespace DP3 {
       double totaltime=itsTimer.getElapsed();
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " GainCal " << itsName << endl;
+      os << " GainCal " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(totaltime));
+      os << endl;
 
       os << "          ";
       FlagCounter::showPerc1 (os, itsTimerPredict.getElapsed(), totaltime);
@@ -584,24 +586,11 @@ namespace DP3 {
               iS[ch/itsNChan].incrementWeight(weight[bl*nCr*nCh+ch*nCr]);
             }
 
-            for (uint cr=0;cr<nCr;++cr) {
-              // The nCrDiv is there such that for nCr==2 the visibilities end up at (0,0) for cr==0, (1,1) for cr==1
-              uint nCrDiv = (nCr==4?2:1);
-              iS[ch/itsNChan].getVis() (IPosition(6,ant1,cr/nCrDiv,itsStepInSolInt,ch%itsNChan,cr%2,ant2)) =
-                  DComplex(data [bl*nCr*nCh+ch*nCr+cr]) *
-                  DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-              iS[ch/itsNChan].getMVis()(IPosition(6,ant1,cr/nCrDiv,itsStepInSolInt,ch%itsNChan,cr%2,ant2)) =
-                  DComplex(model[bl*nCr*nCh+ch*nCr+cr]) *
-                  DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-
-              // conjugate transpose
-              iS[ch/itsNChan].getVis() (IPosition(6,ant2,cr%2,itsStepInSolInt,ch%itsNChan,cr/nCrDiv,ant1)) =
-                  DComplex(conj(data [bl*nCr*nCh+ch*nCr+cr])) *
-                  DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-              iS[ch/itsNChan].getMVis()(IPosition(6,ant2,cr%2,itsStepInSolInt,ch%itsNChan,cr/nCrDiv,ant1)) =
-                  DComplex(conj(model[bl*nCr*nCh+ch*nCr+cr] )) *
-                  DComplex(sqrt(weight[bl*nCr*nCh+ch*nCr+cr]));
-            }
+            const size_t offset = bl*nCr*nCh+ch*nCr;
+            iS[ch/itsNChan].setVisibilities(ant1, ant2, itsStepInSolInt,
+                                            ch%itsNChan, data+offset,
+                                            model+offset, weight+offset,
+                                            nCr);
           }
         }
       }
@@ -619,6 +608,8 @@ namespace DP3 {
 
     void GainCal::stefcal () {
       itsTimerSolve.start();
+      ThreadPool& pool = ThreadPool::GetInstance();
+      ThreadPool::UsageScope usageScope(itsCoreUsage);
 
       for (uint freqCell=0; freqCell<itsNFreqCells; ++freqCell) {
         if (itsPropagateSolutions) {
@@ -635,20 +626,16 @@ namespace DP3 {
 
       vector<StefCal::Status> converged(itsNFreqCells,StefCal::NOTCONVERGED);
       for (;iter<itsMaxIter;++iter) {
-        bool allConverged=true;
-#pragma omp parallel for
-        for (uint freqCell=0; freqCell<itsNFreqCells; ++freqCell) {
+        pool.For(0, itsNFreqCells, [&](size_t freqCell, size_t /*thread*/) {
           // Do another step when stalled and not all converged
-          if (converged[freqCell]==StefCal::CONVERGED) {
-            continue;
+          if (converged[freqCell]!=StefCal::CONVERGED) {
+            converged[freqCell] = iS[freqCell].doStep(iter);
           }
-          converged[freqCell] = iS[freqCell].doStep(iter);
-          // Only continue if there are steps worth continuing
-          // (so not converged, failed or stalled)
-          if (converged[freqCell]==StefCal::NOTCONVERGED) {
-            allConverged = false;
-          }
-        }
+        });
+        // Only continue if there are steps worth continuing
+        // (so not converged, failed or stalled)
+        bool allConverged = std::find(converged.begin(), converged.end(),
+                                      StefCal::NOTCONVERGED) == converged.end();
 
         if (itsDebugLevel>0) {
           for (uint freqCell=0; freqCell<itsNFreqCells; ++freqCell) {
@@ -688,8 +675,7 @@ namespace DP3 {
             }
           }
 
-#pragma omp parallel for
-          for (uint st=0; st<nSt; ++st) {
+          pool.For(0, nSt, [&](size_t st, size_t /*thread*/) {
             uint numpoints=0;
             double* phases = itsPhaseFitters[st]->PhaseData();
             double* weights = itsPhaseFitters[st]->WeightData();
@@ -747,7 +733,7 @@ namespace DP3 {
                                                      ))));
               }
             }
-          }
+          });
           itsTimerPhaseFit.stop();
           itsTimerSolve.start();
         }
@@ -42,6 +42,8 @@
 #include "../ParmDB/ParmFacade.h"
 #include "../ParmDB/ParmSet.h"
 
+#include "../Common/ThreadPool.h"
+
 #ifdef HAVE_LOFAR_BEAM
 #include <StationResponse/Station.h>
 #include <StationResponse/Types.h>
@@ -219,6 +221,7 @@ namespace DP3 {
       NSTimer          itsTimerPhaseFit;
       NSTimer          itsTimerWrite;
       NSTimer          itsTimerFill;
+      ThreadPool::CoreUsage itsCoreUsage;
     };
 
   } //# end namespace
@@ -168,6 +168,14 @@ namespace DP3 {
                                         const std::vector<double>& times,
                                         const std::vector<double>& freqs,
                                         uint pol, uint dir);
+
+          // Get the values or weights of this SolTab for all times, antennas,
+          // polarizations and directions, and nfreq frequencies from
+          // startfreq. They are read with one read call and are ordered
+          // like the axes (fastest varying last).
+          std::vector<double> getValuesOrWeights(
+                                        const std::string& valOrWeight,
+                                        uint startfreq, uint nfreq);
         private:
           // Get the values or weights of this SolTab for a given antenna.
           std::vector<double> getValuesOrWeights(
@@ -25,7 +25,6 @@
 
 #include "Exceptions.h"
 
-#include "../Common/OpenMP.h"
 #include "../Common/ParameterSet.h"
 #include "../Common/StreamUtil.h"
 #include "../Common/StringUtil.h"
@@ -49,8 +48,7 @@ namespace DP3 {
                       const string& prefix) :
       itsInput(input),
       itsH5ParmName(parset.getString(prefix+"applycal.parmdb")),
-      itsDirections(parset.getStringVector(prefix+"directions", vector<string> ())),
-      itsThreadPool(OpenMP::maxThreads())
+      itsDirections(parset.getStringVector(prefix+"directions", vector<string> ()))
     {
       H5Parm h5parm = H5Parm(itsH5ParmName, false);
       std::string soltabName = parset.getString(prefix+"applycal.correction"); 
@@ -95,7 +93,6 @@ namespace DP3 {
         if (i>0) {
           itsPredictSteps[i-1]->setNextStep(itsPredictSteps[i]);
         }
-        itsPredictSteps[i]->setThreadPool(itsThreadPool);
       }
 
       itsResultStep=new ResultStep();
@@ -32,8 +32,6 @@
 #include "Predict.h"
 #include "H5Parm.h"
 
-#include "../Common/ThreadPool.h"
-
 #include <utility>
 
 namespace DP3 {
@@ -87,7 +85,6 @@ namespace DP3 {
       std::vector<std::string> itsDirections;
 
       NSTimer          itsTimer;
-      ThreadPool itsThreadPool;
     };
 
   } //# end namespace
@@ -0,0 +1,175 @@
+//# ItrfConverter.cc: Thread-safe conversion of directions to ITRF
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#ifdef HAVE_LOFAR_BEAM
+
+#include "ItrfConverter.h"
+#include "DPInfo.h"
+#include "Exceptions.h"
+
+#include <casacore/casa/Containers/Record.h>
+#include <casacore/measures/Measures/MEpoch.h>
+#include <casacore/measures/Measures/MeasureHolder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+
+using namespace casacore;
+
+namespace DP3 {
+  namespace DPPP {
+
+    namespace {
+      // The mutex guarding all measures conversions.
+      std::mutex& measuresMutex()
+      {
+        static std::mutex mutex;
+        return mutex;
+      }
+
+      // Make a deep copy of a measure, because using the same Measure object
+      // in multiple threads is not safe. The only way to make a deep copy is
+      // using a MeasureHolder which gets converted to/from a Record.
+      MeasureHolder deepCopy (const Measure& measure)
+      {
+        String msg;
+        Record rec;
+        MeasureHolder mh1(measure);
+        MeasureHolder mh2;
+        if (! (mh1.toRecord (msg, rec)  &&  mh2.fromRecord (msg, rec))) {
+          throw Exception ("ItrfConverter: cannot copy measure: " + msg);
+        }
+        return mh2;
+      }
+    }
+
+    ItrfConverter::ItrfConverter (const DPInfo& info)
+      : itsKeepTime (4 * info.timeInterval()),
+        itsTable    (std::make_shared<const Table>())
+    {
+      std::lock_guard<std::mutex> lock(measuresMutex());
+      itsArrayPos    = deepCopy(info.arrayPos()).asMPosition();
+      itsDelayCenter = deepCopy(info.delayCenter()).asMDirection();
+      itsTileBeamDir = deepCopy(info.tileBeamDir()).asMDirection();
+      // Create the Measure ITRF conversion info given the array position.
+      // The time is filled in later.
+      itsMeasFrame.set (itsArrayPos);
+      itsMeasFrame.set (MEpoch(MVEpoch(info.startTime()/86400), MEpoch::UTC));
+      itsMeasConverter.set (MDirection::J2000,
+                            MDirection::Ref(MDirection::ITRF, itsMeasFrame));
+    }
+
+    ItrfConverter::ShPtr ItrfConverter::get (const DPInfo& info)
+    {
+      static std::mutex registryMutex;
+      static std::map<std::string, std::weak_ptr<ItrfConverter> > registry;
+      std::lock_guard<std::mutex> lock(registryMutex);
+      std::weak_ptr<ItrfConverter>& entry = registry[info.msName()];
+      ShPtr converter = entry.lock();
+      if (! converter) {
+        converter = std::make_shared<ItrfConverter> (info);
+        entry = converter;
+      }
+      return converter;
+    }
+
+    bool ItrfConverter::Entry::operator< (const Entry& other) const
+    {
+      if (time != other.time) return time < other.time;
+      if (ref != other.ref) return ref < other.ref;
+      if (lon != other.lon) return lon < other.lon;
+      return lat < other.lat;
+    }
+
+    LOFAR::StationResponse::vector3r_t ItrfConverter::toItrf
+    (double time, const MDirection& direction)
+    {
+      const Vector<Double> angles = direction.getValue().get();
+      Entry entry;
+      entry.time = time;
+      entry.ref  = direction.getRef().getType();
+      entry.lon  = angles[0];
+      entry.lat  = angles[1];
+      // Look in the current table without locking.
+      std::shared_ptr<const Table> table = std::atomic_load (&itsTable);
+      Table::const_iterator iter = std::lower_bound (table->begin(),
+                                                     table->end(), entry);
+      if (iter != table->end()  &&  !(entry < *iter)) {
+        return iter->itrf;
+      }
+      std::lock_guard<std::mutex> lock(measuresMutex());
+      // Another thread may have converted it in the meantime.
+      table = std::atomic_load (&itsTable);
+      iter = std::lower_bound (table->begin(), table->end(), entry);
+      if (iter != table->end()  &&  !(entry < *iter)) {
+        return iter->itrf;
+      }
+      // Convert a new direction object, so the caller's object is not used
+      // by the (not thread-safe) converter.
+      itsMeasFrame.resetEpoch (MEpoch(MVEpoch(time/86400), MEpoch::UTC));
+      const MDirection dir (MVDirection(entry.lon, entry.lat),
+                            MDirection::Ref(entry.ref));
+      const Vector<Double>& itrf = itsMeasConverter(dir).getValue().getValue();
+      entry.itrf[0] = itrf[0];
+      entry.itrf[1] = itrf[1];
+      entry.itrf[2] = itrf[2];
+      // Make a new table without the old entries and with the new one.
+      // The entries are ordered on time, so the old ones are at the start.
+      double lastTime = time;
+      if (! table->empty()) {
+        lastTime = std::max (lastTime, table->back().time);
+      }
+      Entry first;
+      first.time = lastTime - itsKeepTime;
+      first.ref  = -1;
+      first.lon  = 0;
+      first.lat  = 0;
+      Table::const_iterator keep = std::lower_bound (table->begin(),
+                                                     table->end(), first);
+      std::shared_ptr<Table> newTable = std::make_shared<Table>();
+      const Table::const_iterator split = std::max (keep, iter);
+      newTable->reserve (table->end() - keep + 1);
+      newTable->insert (newTable->end(), keep, split);
+      if (time >= first.time) {
+        newTable->push_back (entry);
+      }
+      newTable->insert (newTable->end(), split, table->end());
+      std::atomic_store (&itsTable, std::shared_ptr<const Table>(newTable));
+      return entry.itrf;
+    }
+
+    ItrfConverter::Directions ItrfConverter::directions
+    (double time, const MDirection& direction)
+    {
+      Directions dirs;
+      dirs.srcdir  = toItrf (time, direction);
+      dirs.refdir  = toItrf (time, itsDelayCenter);
+      dirs.tiledir = toItrf (time, itsTileBeamDir);
+      return dirs;
+    }
+
+  } //# end namespace
+}
+
+#endif
@@ -0,0 +1,117 @@
+//# ItrfConverter.h: Thread-safe conversion of directions to ITRF
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#ifdef HAVE_LOFAR_BEAM
+
+#ifndef DPPP_ITRFCONVERTER_H
+#define DPPP_ITRFCONVERTER_H
+
+// @file
+// @brief Thread-safe conversion of directions to ITRF
+
+#include <StationResponse/Types.h>
+
+#include <casacore/measures/Measures/MDirection.h>
+#include <casacore/measures/Measures/MPosition.h>
+#include <casacore/measures/Measures/MeasConvert.h>
+#include <casacore/measures/Measures/MeasFrame.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    class DPInfo;
+
+    // @ingroup NDPPP
+
+    // This class converts directions to ITRF at a given time for the
+    // beam calculations. It is shared by all steps and threads using the
+    // same MS (see get).
+    //
+    // The casacore measures are not thread-safe, so a conversion is done
+    // under a process-wide mutex. However, each direction is converted only
+    // once per time; the result is stored in a table which is replaced (not
+    // changed) when a conversion is added. Threads asking for a direction
+    // already converted only read the current table, so they do not lock.
+    // The entries older than a few time slots are removed when the table
+    // is replaced.
+    //
+    // Note that the J2000 to ITRF conversion is not a pure rotation, because
+    // it includes the (direction dependent) aberration. Therefore the
+    // conversions are stored per direction instead of as a rotation matrix
+    // per time.
+
+    class ItrfConverter
+    {
+    public:
+      typedef std::shared_ptr<ItrfConverter> ShPtr;
+
+      // The ITRF directions used by the beam.
+      struct Directions {
+        LOFAR::StationResponse::vector3r_t srcdir, refdir, tiledir;
+      };
+
+      explicit ItrfConverter (const DPInfo& info);
+
+      // Get the converter shared by all steps using the same MS.
+      static ShPtr get (const DPInfo& info);
+
+      // Convert a direction to ITRF for the given time.
+      LOFAR::StationResponse::vector3r_t toItrf
+      (double time, const casacore::MDirection& direction);
+
+      // Convert a direction, the delay center and the tile beam direction
+      // to ITRF for the given time.
+      Directions directions (double time,
+                             const casacore::MDirection& direction);
+
+    private:
+      // A converted direction. The table is ordered on time first.
+      struct Entry {
+        double time;
+        int    ref;
+        double lon, lat;
+        LOFAR::StationResponse::vector3r_t itrf;
+        bool operator< (const Entry& other) const;
+      };
+      typedef std::vector<Entry> Table;
+
+      //# Data members.
+      double                        itsKeepTime;  //# keep entries this long
+      casacore::MPosition           itsArrayPos;
+      casacore::MDirection          itsDelayCenter;
+      casacore::MDirection          itsTileBeamDir;
+      casacore::MeasFrame           itsMeasFrame;
+      casacore::MDirection::Convert itsMeasConverter;
+      //# The current table. It is only accessed using std::atomic_load and
+      //# std::atomic_store; the Table itself is never changed.
+      std::shared_ptr<const Table>  itsTable;
+    };
+
+  } //# end namespace
+}
+
+#endif
+#endif
@@ -64,7 +64,12 @@ namespace DP3 {
       : itsReadVisData   (False),
         itsLastMSTime    (0),
         itsNrRead        (0),
-        itsNrInserted    (0)
+        itsNrInserted    (0),
+        itsBatchSize     (1),
+        itsNrBatched     (0),
+        itsReadAhead     (0),
+        itsPrefetchWeights (false),
+        itsPrefetchUVW   (false)
     {}
 
     MSReader::MSReader (const string& msName,
@@ -75,7 +80,12 @@ namespace DP3 {
         itsMissingData   (missingData),
         itsLastMSTime    (0),
         itsNrRead        (0),
-        itsNrInserted    (0)
+        itsNrInserted    (0),
+        itsBatchSize     (1),
+        itsNrBatched     (0),
+        itsReadAhead     (0),
+        itsPrefetchWeights (false),
+        itsPrefetchUVW   (false)
     {
       NSTimer::StartStop sstime(itsTimer);
       // Get info from parset.
@@ -209,7 +219,13 @@ namespace DP3 {
     }
 
     MSReader::~MSReader()
-    {}
+    {
+      // Only happens if the pipeline was aborted before finish.
+      if (itsReadThread.joinable()) {
+        itsFreeBuffers.write_end();
+        itsReadThread.join();
+      }
+    }
 
     void MSReader::updateInfo (const DPInfo&)
     {}
@@ -226,18 +242,40 @@ namespace DP3 {
 
     bool MSReader::process (const DPBuffer&)
     {
-      if (itsNrRead == 0) {
-        if (itsReadVisData) {
-          itsBuffer.getData().resize (itsNrCorr, itsNrChan, itsNrBl);
-        }
-        if (itsUseFlags) {
-          itsBuffer.getFlags().resize (itsNrCorr, itsNrChan, itsNrBl);
+      if (itsReadAhead > 0) {
+        return processReadAhead();
+      }
+      if (itsBatchSize > 1) {
+        // Read directly into the next buffer of the batch.
+        if (itsBatch.empty()) {
+          itsBatch = DPBuffer::makeBatch (IPosition(3, itsNrCorr, itsNrChan,
+                                                    itsNrBl),
+                                          itsBatchSize, itsReadVisData,
+                                          false, false);
         }
-        ///cout<<(void*)(itsBuffer.getData().data())<<" upd"<<endl;
+        itsBuffer = itsBatch[itsNrBatched];
+      }
+      if (! readNext (itsBuffer)) {
+        return false;
+      }
+      sendBuffer();
+      return true;
+    }
+
+    bool MSReader::readNext (DPBuffer& buf)
+    {
+      // Only the first time (or for a new read-ahead buffer) the arrays
+      // need to be sized.
+      if (itsReadVisData) {
+        buf.getData().resize (itsNrCorr, itsNrChan, itsNrBl);
+      }
+      if (itsUseFlags) {
+        buf.getFlags().resize (itsNrCorr, itsNrChan, itsNrBl);
       }
       {
+        std::lock_guard<std::mutex> lock(itsTableMutex);
         NSTimer::StartStop sstime(itsTimer);
-        ///        itsBuffer.clear();
+        ///        buf.clear();
         // Use time from the current time slot in the MS.
         bool useIter = false;
         while (!itsIter.pastEnd()) {
@@ -276,86 +314,187 @@ namespace DP3 {
           return false;
         }
         // Fill the buffer.
-        itsBuffer.setTime (itsNextTime);
-        ///cout << "read time " <<itsBuffer.getTime() - 4472025855.0<<endl;
+        buf.setTime (itsNextTime);
+        ///cout << "read time " <<buf.getTime() - 4472025855.0<<endl;
         if (!useIter) {
           // Need to insert a fully flagged time slot.
-          itsBuffer.setRowNrs (Vector<uint>());
-          itsBuffer.setExposure (itsTimeInterval);
-          itsBuffer.getFlags() = true;
+          buf.setRowNrs (Vector<uint>());
+          buf.setExposure (itsTimeInterval);
+          buf.getFlags() = true;
           if (itsReadVisData){
-            itsBuffer.getData() = Complex();
+            buf.getData() = Complex();
           }
           itsNrInserted++;
         } else {
-          itsBuffer.setRowNrs (itsIter.table().rowNumbers(itsMS, True));
+          buf.setRowNrs (itsIter.table().rowNumbers(itsMS, True));
           if (itsMissingData) {
             // Data column not present, so fill a fully flagged time slot.
-            itsBuffer.setExposure (itsTimeInterval);
-            itsBuffer.getFlags() = true;
+            buf.setExposure (itsTimeInterval);
+            buf.getFlags() = true;
             if (itsReadVisData) {
-              itsBuffer.getData() = Complex();
+              buf.getData() = Complex();
             }
           } else {
             // Set exposure.
-            itsBuffer.setExposure (ROScalarColumn<double>
+            buf.setExposure (ROScalarColumn<double>
                                    (itsIter.table(), "EXPOSURE")(0));
             // Get data and flags from the MS.
             ///            if (itsNrRead%50 < 4) {
-            ///              cout<<(void*)(itsBuffer.getData().data())<<" rd1"<<endl;
+            ///              cout<<(void*)(buf.getData().data())<<" rd1"<<endl;
             ///}
             if (itsReadVisData) {
               ROArrayColumn<Complex> dataCol(itsIter.table(), itsDataColName);
               if (itsUseAllChan) {
-                dataCol.getColumn (itsBuffer.getData());
+                dataCol.getColumn (buf.getData());
               } else {
-                dataCol.getColumn (itsColSlicer, itsBuffer.getData());
+                dataCol.getColumn (itsColSlicer, buf.getData());
               }
             }
             ///if (itsNrRead%50 < 4) {
-            ///cout<<(void*)(itsBuffer.getData().data())<<" rd2"<<endl;
+            ///cout<<(void*)(buf.getData().data())<<" rd2"<<endl;
             ///}
             if (itsUseFlags) {
               ROArrayColumn<bool> flagCol(itsIter.table(), "FLAG");
               if (itsUseAllChan) {
-                flagCol.getColumn (itsBuffer.getFlags());
+                flagCol.getColumn (buf.getFlags());
               } else {
-                flagCol.getColumn(itsColSlicer, itsBuffer.getFlags());
+                flagCol.getColumn(itsColSlicer, buf.getFlags());
               }
               // Set flags if FLAG_ROW is set.
               ROScalarColumn<bool> flagrowCol(itsIter.table(), "FLAG_ROW");
               for (uint i=0; i<itsIter.table().nrow(); ++i) {
                 if (flagrowCol(i)) {
-                  itsBuffer.getFlags()
+                  buf.getFlags()
                     (IPosition(3,0,0,i),
                      IPosition(3,itsNrCorr-1,itsNrChan-1,i)) = true;
                 }
               }
             } else {
               // Do not use FLAG from the MS.
-              itsBuffer.getFlags().resize (itsNrCorr, itsNrChan, itsNrBl);
-              itsBuffer.getFlags() = false;
+              buf.getFlags().resize (itsNrCorr, itsNrChan, itsNrBl);
+              buf.getFlags() = false;
             }
             // Flag invalid data (NaN, infinite).
-            flagInfNaN(itsBuffer.getData(), itsBuffer.getFlags(),
+            flagInfNaN(buf.getData(), buf.getFlags(),
                        itsFlagCounter);
           }
           itsLastMSTime = itsNextTime;
           itsNrRead++;
           itsIter.next();
         }
-        if (itsBuffer.getFlags().shape()[2] != int(itsNrBl))
+        if (buf.getFlags().shape()[2] != int(itsNrBl))
           throw Exception(
                    "#baselines is not the same for all time slots in the MS");
       }   // end of scope stops the timer.
-      // Let the next step in the pipeline process this time slot.
-      getNextStep()->process (itsBuffer);
-      ///      cout << "Reader: " << itsNextTime-4.75e9<<endl;
       // Do not add to previous time, because it introduces round-off errors.
       itsNextTime = itsFirstTime + (itsNrRead+itsNrInserted) * itsTimeInterval;
       return true;
     }
 
+    bool MSReader::sendBuffer()
+    {
+      // Let the next step in the pipeline process this time slot.
+      if (itsBatchSize > 1) {
+        // The time and rownrs are not set in the batch buffer itself.
+        itsBatch[itsNrBatched++] = itsBuffer;
+        if (itsNrBatched < itsBatchSize) {
+          return false;
+        }
+        getNextStep()->processBatch (itsBatch);
+        itsNrBatched = 0;
+      } else {
+        getNextStep()->process (itsBuffer);
+      }
+      return true;
+    }
+
+    bool MSReader::processReadAhead()
+    {
+      if (! itsReadThread.joinable()  &&  itsReadBuffers.empty()) {
+        // Besides the read-ahead buffers, the buffers of a batch being
+        // collected are in use.
+        uint nbuf = itsReadAhead + itsBatchSize;
+        itsReadBuffers = DPBuffer::makeBatch (IPosition(3, itsNrCorr,
+                                                        itsNrChan, itsNrBl),
+                                              nbuf, itsReadVisData,
+                                              false, false);
+        // The batch only references the read-ahead buffers.
+        itsBatch.resize (itsBatchSize);
+        itsFreeBuffers.resize (nbuf);
+        itsFullBuffers.resize (nbuf);
+        for (uint i=0; i<nbuf; ++i) {
+          itsFreeBuffers.write (i);
+        }
+        itsReadThread = std::thread (&MSReader::readAhead, this);
+      }
+      size_t index;
+      bool filled;
+      {
+        NSTimer::StartStop sstime(itsWaitTimer);
+        filled = itsFullBuffers.read (index);
+      }
+      if (! filled) {
+        stopReadAhead();
+        return false;
+      }
+      itsBuffer = itsReadBuffers[index];
+      itsHeldBuffers.push_back (index);
+      if (sendBuffer()) {
+        releaseBuffers();
+      }
+      return true;
+    }
+
+    void MSReader::releaseBuffers()
+    {
+      for (size_t index : itsHeldBuffers) {
+        itsFreeBuffers.write (index);
+      }
+      itsHeldBuffers.clear();
+    }
+
+    void MSReader::readAhead()
+    {
+      size_t index;
+      try {
+        while (itsFreeBuffers.read (index)) {
+          DPBuffer& buf = itsReadBuffers[index];
+          if (! readNext (buf)) {
+            break;
+          }
+          // Also read the weights and UVW once a step has asked for them.
+          // Those functions lock the MS themselves.
+          if (itsPrefetchWeights) {
+            getWeights (buf.getRowNrs(), buf);
+          }
+          if (itsPrefetchUVW) {
+            getUVW (buf.getRowNrs(), buf.getTime(), buf);
+          }
+          itsFullBuffers.write (index);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(itsTableMutex);
+        itsReadException = std::current_exception();
+      }
+      itsFullBuffers.write_end();
+    }
+
+    void MSReader::stopReadAhead()
+    {
+      if (itsReadThread.joinable()) {
+        itsFreeBuffers.write_end();
+        itsReadThread.join();
+        std::exception_ptr exc;
+        {
+          std::lock_guard<std::mutex> lock(itsTableMutex);
+          std::swap (exc, itsReadException);
+        }
+        if (exc) {
+          std::rethrow_exception (exc);
+        }
+      }
+    }
+
     void MSReader::flagInfNaN(const casacore::Cube<casacore::Complex>& dataCube,
                               casacore::Cube<bool>& flagsCube,
                               FlagCounter& flagCounter) {
@@ -383,6 +522,15 @@ namespace DP3 {
 
     void MSReader::finish()
     {
+      // Process the remaining time slots of an incomplete batch.
+      if (itsNrBatched > 0) {
+        getNextStep()->processBatch
+          (std::vector<DPBuffer> (itsBatch.begin(),
+                                  itsBatch.begin() + itsNrBatched));
+        itsNrBatched = 0;
+      }
+      releaseBuffers();
+      stopReadAhead();
       getNextStep()->finish();
     }
 
@@ -413,6 +561,9 @@ namespace DP3 {
         os << std::endl;
         os << "  WEIGHT column:  " << itsWeightColName << std::endl;
         os << "  autoweight:     " << boolalpha << itsAutoWeight << std::endl;
+        if (itsReadAhead > 0) {
+          os << "  readahead:      " << itsReadAhead << std::endl;
+        }
       }
     }
 
@@ -430,6 +581,13 @@ namespace DP3 {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
       os << " MSReader" << endl;
+      if (itsReadAhead > 0) {
+        // The reading is done in the background, so show the time the
+        // pipeline had to wait for it.
+        os << "  ";
+        FlagCounter::showPerc1 (os, itsWaitTimer.getElapsed(), duration);
+        os << " MSReader (waiting for read-ahead)" << endl;
+      }
     }
 
     void MSReader::prepare (double& firstTime, double& lastTime,
@@ -671,15 +829,15 @@ namespace DP3 {
     {
       Matrix<double>& uvws = buf.getUVW();
       uvws.resize (3, itsNrBl);
-      const Vector<Int>& ant1 = getInfo().getAnt1();
-      const Vector<Int>& ant2 = getInfo().getAnt2();
-      for (uint i=0; i<itsNrBl; ++i) {
-        uvws.column(i) = itsUVWCalc.getUVW (ant1[i], ant2[i], time);
-      }
+      itsUVWCalc.getUVWs (getInfo().getAnt1(), getInfo().getAnt2(), time,
+                          uvws.data());
     }
 
     void MSReader::getUVW (const RefRows& rowNrs, double time, DPBuffer& buf)
     {
+      // From now on let the read-ahead thread read the UVWs.
+      itsPrefetchUVW = itsReadAhead > 0;
+      std::lock_guard<std::mutex> lock(itsTableMutex);
       NSTimer::StartStop sstime(itsTimer);
       // Calculate UVWs if empty rownrs (i.e., missing data).
       if (rowNrs.rowVector().empty()) {
@@ -692,6 +850,9 @@ namespace DP3 {
 
     void MSReader::getWeights (const RefRows& rowNrs, DPBuffer& buf)
     {
+      // From now on let the read-ahead thread read the weights.
+      itsPrefetchWeights = itsReadAhead > 0;
+      std::lock_guard<std::mutex> lock(itsTableMutex);
       NSTimer::StartStop sstime(itsTimer);
       Cube<float>& weights = buf.getWeights();
       // Resize if needed (probably when called for first time).
@@ -791,6 +952,7 @@ namespace DP3 {
 
     bool MSReader::getFullResFlags (const RefRows& rowNrs, DPBuffer& buf)
     {
+      std::lock_guard<std::mutex> lock(itsTableMutex);
       NSTimer::StartStop sstime(itsTimer);
       Cube<bool>& flags = buf.getFullResFlags();
       int norigchan = itsNrChan * itsFullResNChanAvg;
@@ -839,6 +1001,7 @@ namespace DP3 {
     void MSReader::getModelData (const casacore::RefRows& rowNrs,
                                  casacore::Cube<casacore::Complex>& arr)
     {
+      std::lock_guard<std::mutex> lock(itsTableMutex);
       NSTimer::StartStop sstime(itsTimer);
       if (rowNrs.rowVector().empty()) {
         arr.resize (itsNrCorr, itsNrChan, itsNrBl);
@@ -36,6 +36,15 @@
 #include <casacore/tables/Tables/RefRows.h>
 #include <casacore/casa/Arrays/Slicer.h>
 
+#include "../Common/Lane.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace DP3 {
 
   class ParameterSet;
@@ -196,6 +205,19 @@ namespace DP3 {
       // Tell if the visibility data are to be read.
       virtual void setReadVisData (bool readVisData);
 
+      // Set the number of time slots to be read before they are given
+      // together to processBatch of the next step. Default is 1, thus
+      // each time slot is given to process.
+      void setBatchSize (uint batchSize)
+        { itsBatchSize = std::max (batchSize, 1u); }
+
+      // Set the number of time slots to be read ahead by a background
+      // thread. Default is 0, thus reading is done in process.
+      // The read-ahead thread also reads the weights and UVW as soon as a
+      // step has asked for them using getWeights or getUVW.
+      void setReadAhead (uint readAhead)
+        { itsReadAhead = readAhead; }
+
       // Get the main MS table.
       casacore::Table& table()
         { return itsMS; }
@@ -259,11 +281,40 @@ namespace DP3 {
       const DPBuffer& getBuffer() const
         { return itsBuffer; }
 
+      // Get the mutex guarding the access to the MS.
+      // The get functions and the reading in process lock it, so the
+      // fetch functions can be used by steps running in another thread
+      // (see QueueStep). Other steps accessing the same MS (MSUpdater)
+      // have to lock it as well.
+      std::mutex& tableMutex()
+        { return itsTableMutex; }
+
       // Flags inf and NaN
       static void flagInfNaN(const casacore::Cube<casacore::Complex>& dataCube,
                        casacore::Cube<bool>& flagsCube, FlagCounter& flagCounter);
 
     private:
+      // Read the next time slot into the buffer.
+      // It returns false if at the end of the MS.
+      bool readNext (DPBuffer& buf);
+
+      // Give itsBuffer to the next step, possibly as part of a batch.
+      // It returns true if the buffers have been processed by the next step.
+      bool sendBuffer();
+
+      // Process the next time slot read by the read-ahead thread.
+      bool processReadAhead();
+
+      // The function executed by the read-ahead thread.
+      void readAhead();
+
+      // Give the buffers processed by the next step back to the read-ahead
+      // thread.
+      void releaseBuffers();
+
+      // Stop the read-ahead thread and rethrow a possible exception.
+      void stopReadAhead();
+
       // Prepare the access to the MS.
       // Return the first and last time and the interval.
       void prepare (double& firstTime, double& lastTime,
@@ -322,10 +373,24 @@ namespace DP3 {
       uint                itsFullResNChanAvg;
       uint                itsFullResNTimeAvg;
       DPBuffer            itsBuffer;
+      uint                itsBatchSize;
+      uint                itsNrBatched;     //# nr of time slots in itsBatch
+      std::vector<DPBuffer> itsBatch;
+      uint                itsReadAhead;
+      std::vector<DPBuffer> itsReadBuffers; //# buffers of read-ahead thread
+      ao::lane<size_t>    itsFreeBuffers;   //# indices of free buffers
+      ao::lane<size_t>    itsFullBuffers;   //# indices of read buffers
+      std::vector<size_t> itsHeldBuffers;   //# indices in use by next steps
+      std::thread         itsReadThread;
+      std::exception_ptr  itsReadException;
+      std::atomic<bool>   itsPrefetchWeights;
+      std::atomic<bool>   itsPrefetchUVW;
+      NSTimer             itsWaitTimer;     //# time waiting for read-ahead
       UVWCalculator       itsUVWCalc;
       casacore::Vector<uint>  itsBaseRowNrs;    //# rownrs for meta of missing times
       FlagCounter         itsFlagCounter;
       NSTimer             itsTimer;
+      std::mutex          itsTableMutex;    //# guards access to the MS
     };
 
   } //# end namespace
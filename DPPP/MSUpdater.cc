@@ -130,7 +130,41 @@ namespace DP3 {
 
     bool MSUpdater::process (const DPBuffer& buf)
     {
-      NSTimer::StartStop sstime(itsTimer);
+      {
+        NSTimer::StartStop sstime(itsTimer);
+        writeBuffer (buf);
+        flush (1);
+      }
+      getNextStep()->process(buf);
+      return true;
+    }
+
+    bool MSUpdater::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      {
+        NSTimer::StartStop sstime(itsTimer);
+        for (const DPBuffer& buf : bufs) {
+          writeBuffer (buf);
+        }
+        flush (bufs.size());
+      }
+      getNextStep()->processBatch(bufs);
+      return true;
+    }
+
+    void MSUpdater::flush (uint nrTimes)
+    {
+      uint nrDone = itsNrDone;
+      itsNrDone += nrTimes;
+      if (itsNrTimesFlush > 0  &&
+          itsNrDone/itsNrTimesFlush != nrDone/itsNrTimesFlush) {
+        std::lock_guard<std::mutex> lock(itsReader->tableMutex());
+        itsMS.flush();
+      }
+    }
+
+    void MSUpdater::writeBuffer (const DPBuffer& buf)
+    {
       if (itsWriteFlags) {
         putFlags (buf.getRowNrs(), buf.getFlags());
       }
@@ -180,12 +214,6 @@ namespace DP3 {
           putWeights (buf.getRowNrs(), weights);
         }
       }
-      itsNrDone++;
-      if (itsNrTimesFlush > 0  &&  itsNrDone%itsNrTimesFlush == 0) {
-        itsMS.flush();
-      }
-      getNextStep()->process(buf);
-      return true;
     }
 
     void MSUpdater::finish()
@@ -304,6 +332,8 @@ namespace DP3 {
     void MSUpdater::putFlags (const RefRows& rowNrs,
                               const Cube<bool>& flags)
     {
+      // The reader might be reading the same MS in another thread.
+      std::lock_guard<std::mutex> lock(itsReader->tableMutex());
       // Only put if rownrs are filled, thus if data were not inserted.
       if (! rowNrs.rowVector().empty()) {
         Slicer colSlicer(IPosition(2, 0, info().startchan()),
@@ -330,6 +360,7 @@ namespace DP3 {
     void MSUpdater::putWeights (const RefRows& rowNrs,
                                 const Cube<float>& weights)
     {
+      std::lock_guard<std::mutex> lock(itsReader->tableMutex());
       // Only put if rownrs are filled, thus if data were not inserted.
       if (! rowNrs.rowVector().empty()) {
         Slicer colSlicer(IPosition(2, 0, info().startchan()),
@@ -350,6 +381,7 @@ namespace DP3 {
     void MSUpdater::putData (const RefRows& rowNrs,
                              const Cube<Complex>& data)
     {
+      std::lock_guard<std::mutex> lock(itsReader->tableMutex());
       // Only put if rownrs are filled, thus if data were not inserted.
       if (! rowNrs.rowVector().empty()) {
         Slicer colSlicer(IPosition(2, 0, info().startchan()),
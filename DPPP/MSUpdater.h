@@ -64,6 +64,9 @@ namespace DP3 {
       // It returns false when at the end.
       virtual bool process (const DPBuffer&);
 
+      // Write a batch of time slots.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish();
 
@@ -87,6 +90,12 @@ namespace DP3 {
                                   bool throwError=true);
 
     private:
+      // Write the flags, data and weights of a time slot as needed.
+      void writeBuffer (const DPBuffer& buf);
+
+      // Count the written time slots and flush the MS if needed.
+      void flush (uint nrTimes);
+
       // Write the flags at the given row numbers.
       void putFlags (const casacore::RefRows& rowNrs,
                      const casacore::Cube<bool>& flags);
@@ -103,7 +103,7 @@ namespace DP3 {
       // Copy the input columns that do not change.
       writeMeta (out, buf);
       // Now write the data and flags.
-      writeData (out, buf);
+      writeData (out, RefRows(0, itsNrBl-1), buf);
       // Flush if sufficient time slots are written.
       itsNrDone++;
       if (itsNrTimesFlush > 0  &&  itsNrDone%itsNrTimesFlush == 0) {
@@ -116,6 +116,38 @@ namespace DP3 {
       return true;
     }
 
+    bool MSWriter::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      NSTimer::StartStop sstime(itsTimer);
+      const uint nslot = bufs.size();
+      // Add the rows of all time slots at once.
+      const uint firstRow = itsMS.nrow();
+      itsMS.addRow (itsNrBl * nslot);
+      itsBatch.resize (nslot);
+      for (uint t=0; t<nslot; ++t) {
+        const uint startRow = firstRow + t*itsNrBl;
+        Vector<uint> rownrs (itsNrBl);
+        indgen (rownrs, startRow);
+        // The meta data differ per time slot, so write them per time slot.
+        Table out(itsMS(rownrs));
+        writeMeta (out, bufs[t]);
+        // The data are put directly into the rows of the time slot, so
+        // they do not need to be combined into arrays of all time slots.
+        writeData (itsMS, RefRows(startRow, startRow + itsNrBl - 1), bufs[t]);
+        itsBatch[t].referenceFilled (bufs[t]);
+        itsBatch[t].setRowNrs (rownrs);
+      }
+      // Flush if sufficient time slots are written.
+      uint nrDone = itsNrDone;
+      itsNrDone += nslot;
+      if (itsNrTimesFlush > 0  &&
+          itsNrDone/itsNrTimesFlush != nrDone/itsNrTimesFlush) {
+        itsMS.flush();
+      }
+      getNextStep()->processBatch(itsBatch);
+      return true;
+    }
+
     void MSWriter::finish()
     {
       NSTimer::StartStop sstime(itsTimer);
@@ -547,7 +579,8 @@ namespace DP3 {
       cli.put         (rownr, clivec);
     }
 
-    void MSWriter::writeData (Table& out, const DPBuffer& buf)
+    void MSWriter::writeData (Table& out, const RefRows& rows,
+                              const DPBuffer& buf)
     {
       ArrayColumn<Complex> dataCol(out, itsDataColName);
       ArrayColumn<Bool>    flagCol(out, "FLAG");
@@ -580,30 +613,31 @@ namespace DP3 {
           ++dataIter;
           ++weightsIter;
         }
-        dataCol.putColumn (dataCopy);
-        weightCol.putColumn (weightsCopy);
+        dataCol.putColumnCells (rows, dataCopy);
+        weightCol.putColumnCells (rows, weightsCopy);
       }
       else {
-        dataCol.putColumn (buf.getData());
-        weightCol.putColumn (weights);
+        dataCol.putColumnCells (rows, buf.getData());
+        weightCol.putColumnCells (rows, weights);
       }
       
-      flagCol.putColumn (buf.getFlags());
+      flagCol.putColumnCells (rows, buf.getFlags());
       // A row is flagged if no flags in the row are False.
       Vector<Bool> rowFlags (partialNFalse(buf.getFlags(), IPosition(2,0,1)) == 0u);
-      flagRowCol.putColumn (rowFlags);
+      flagRowCol.putColumnCells (rows, rowFlags);
       if (itsWriteFullResFlags) {
-        writeFullResFlags (out, buf);
+        writeFullResFlags (out, rows, buf);
       }
 
       // Write UVW
       ArrayColumn<Double> uvwCol(out, "UVW");
       const Array<Double>& uvws = itsReader->fetchUVW (buf, itsBuffer,
                                                        itsTimer);
-      uvwCol.putColumn (uvws);
+      uvwCol.putColumnCells (rows, uvws);
     }
 
-    void MSWriter::writeFullResFlags (Table& out, const DPBuffer& buf)
+    void MSWriter::writeFullResFlags (Table& out, const RefRows& rows,
+                                      const DPBuffer& buf)
     {
       // Get the flags.
       const Cube<bool>& flags = itsReader->fetchFullResFlags (buf, itsBuffer,
@@ -636,7 +670,7 @@ namespace DP3 {
         fullResCol.rwKeywordSet().define ("NCHAN_AVG", int(itsNChanAvg));
         fullResCol.rwKeywordSet().define ("NTIME_AVG", int(itsNTimeAvg));
       }
-      fullResCol.putColumn (chars);
+      fullResCol.putColumnCells (rows, chars);
     } 
 
     void MSWriter::writeMeta (Table& out, const DPBuffer& buf)
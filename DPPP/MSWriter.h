@@ -35,6 +35,7 @@
 #include <casacore/tables/Tables/ColumnDesc.h>
 #include <casacore/tables/Tables/ScalarColumn.h>
 #include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/tables/Tables/RefRows.h>
 #include <casacore/tables/DataMan/TiledColumnStMan.h>
 
 namespace DP3 {
@@ -71,6 +72,11 @@ namespace DP3 {
       // It returns false when at the end.
       virtual bool process (const DPBuffer&);
 
+      // Write a batch of time slots. The rows of all time slots are added
+      // to the MS at once and the data, flags, weights and UVW of each time
+      // slot are put directly into its row range.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish();
 
@@ -112,11 +118,14 @@ namespace DP3 {
       // Update the FIELD table with the new phase center.
       void updateField (const string& outName, const DPInfo& info);
 
-      // Write the data, flags, etc.
-      void writeData (casacore::Table& out, const DPBuffer& buf);
+      // Write the data, flags, etc. into the given rows of the table.
+      void writeData (casacore::Table& out, const casacore::RefRows& rows,
+                      const DPBuffer& buf);
 
       // Write the full resolution flags (flags before any averaging).
-      void writeFullResFlags (casacore::Table& out, const DPBuffer& buf);
+      void writeFullResFlags (casacore::Table& out,
+                              const casacore::RefRows& rows,
+                              const DPBuffer& buf);
 
       // Write all meta data columns for a time slot (ANTENNA1, etc.)
       void writeMeta (casacore::Table& out, const DPBuffer& buf);
@@ -169,6 +178,7 @@ namespace DP3 {
       string          itsName;
       string          itsOutName;
       DPBuffer        itsBuffer;
+      std::vector<DPBuffer> itsBatch;
       casacore::Table     itsMS;
       ParameterSet    itsParset; //# parset for writing history
       casacore::String    itsDataColName;
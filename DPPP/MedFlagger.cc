@@ -29,6 +29,7 @@
 
 #include "../Common/ParameterSet.h"
 #include "../Common/StreamUtil.h"
+#include "../Common/ThreadPool.h"
 
 #include <casacore/casa/Arrays/ArrayMath.h>
 #include <casacore/casa/Containers/Record.h>
@@ -99,7 +100,9 @@ namespace DP3 {
       double flagDur = itsTimer.getElapsed();
       os << "  ";
       FlagCounter::showPerc1 (os, flagDur, duration);
-      os << " MADFlagger " << itsName << endl;
+      os << " MADFlagger " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(flagDur));
+      os << endl;
       os << "          ";
       // move time and median time are sum of all threads.
       // Scale them to a single elapsed time.
@@ -161,8 +164,13 @@ namespace DP3 {
         }
       }
       itsFlagCorr = flagCorr;
-      // Initialize the flag counters.
+      // Initialize the flag counters; the ones per thread are added to the
+      // overall one in finish.
       itsFlagCounter.init (getInfo());
+      itsFlagCounters.resize (ThreadPool::GetInstance().NThreads());
+      for (FlagCounter& counter : itsFlagCounters) {
+        counter.init (getInfo());
+      }
     }
 
     bool MedFlagger::process (const DPBuffer& buf)
@@ -259,6 +267,10 @@ namespace DP3 {
         flag (itsNTimesDone%itsTimeWindow, timeEntries);
         itsNTimesDone++;
       }
+      // Add the counters to the overall object.
+      for (const FlagCounter& counter : itsFlagCounters) {
+        itsFlagCounter.add (counter);
+      }
       itsTimer.stop();
       // Let the next step finish its processing.
       getNextStep()->finish();
@@ -285,23 +297,28 @@ namespace DP3 {
       itsComputeTimer.start();
       // Now flag each baseline, channel and correlation for this time window.
       // This can be done in parallel.
-#pragma omp parallel
+      ThreadPool& pool = ThreadPool::GetInstance();
+      const size_t nthread = pool.NThreads();
+      // Create a temporary buffer (per thread) to hold data for determining
+      // the medians.
+      // Also create thread-private timer objects.
+      vector<Block<float> > tempBufs(nthread);
+      vector<NSTimer> moveTimers(nthread);
+      vector<NSTimer> medianTimers(nthread);
+      for (size_t i=0; i<nthread; ++i) {
+        tempBufs[i].resize (itsFreqWindow*ntime);
+      }
+      // The sliding medians are kept per thread and correlation.
+      itsMedians.resize (nthread);
+      for (size_t i=0; i<nthread; ++i) {
+        itsMedians[i].resize (itsFlagCorr.size());
+      }
+      // The loop is done with a grain size of 1, because the execution time
+      // of each iteration can vary a lot.
       {
-        // Create a temporary buffer (per thread) to hold data for determining
-        // the medians.
-        // Also create thread-private counter and timer objects.
-        Block<float> tempBuf(itsFreqWindow*ntime);
-        FlagCounter counter;
-        counter.init (getInfo());
-        NSTimer moveTimer;
-        NSTimer medianTimer;
-        float Z1, Z2;
-        // The for loop can be parallellized. This must be done dynamically,
-        // because the execution time of each iteration can vary a lot.
-#pragma omp for schedule(dynamic)
-        // GCC-4.3 only supports OpenMP 2.5 that needs signed iteration
-        // variables.
-        for (int ib=0; ib<nrbl; ++ib) {
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
+        pool.For(0, nrbl, 1, [&](size_t ib, size_t thread) {
+          float Z1, Z2;
           const float* dataPtr = bufDataPtr + ib*blsize;
           bool* flagPtr = bufFlagPtr + ib*blsize;
           double threshold = itsThresholdArr[ib];
@@ -310,12 +327,42 @@ namespace DP3 {
           if ((!itsApplyAutoCorr  &&  itsBLength[ib] >= itsMinBLength  &&
               itsBLength[ib] <= itsMaxBLength)  ||
               (itsApplyAutoCorr  &&  ant1[ib] == ant2[ib])) {
+            // For larger windows the medians are updated incrementally
+            // while the window slides along the channels. For small
+            // windows selecting them from scratch is faster.
+            const bool sliding =
+              (itsFreqWindowArr[ib] >= theirMinSlidingFreqWindow  &&
+               itsTimeWindowArr[ib] >= theirMinSlidingTimeWindow);
+            vector<WindowMedian>& medians = itsMedians[thread];
+            if (sliding) {
+              moveTimers[thread].start();
+              const uint timeWindow = itsTimeWindowArr[ib];
+              vector<const float*> rowData(timeWindow);
+              vector<const bool*> rowFlags(timeWindow);
+              for (size_t i=0; i<itsFlagCorr.size(); ++i) {
+                uint offset = ib*blsize + itsFlagCorr[i];
+                for (uint it=0; it<timeWindow; ++it) {
+                  rowData[it] = itsAmpl[timeEntries[it]].data() + offset;
+                  rowFlags[it] =
+                    itsBuf[timeEntries[it]].getFlags().data() + offset;
+                }
+                medians[i].init (rowData, rowFlags, nchan, ncorr,
+                                 itsFreqWindowArr[ib]);
+              }
+              moveTimers[thread].stop();
+            }
             for (uint ic=0; ic<nchan; ++ic) {
               bool corrIsFlagged = false;
+              if (sliding) {
+                moveTimers[thread].start();
+                for (WindowMedian& median : medians) {
+                  median.move (ic);
+                }
+                moveTimers[thread].stop();
+              }
               // Iterate over given correlations.
-              for (vector<uint>::const_iterator iter = itsFlagCorr.begin();
-                  iter != itsFlagCorr.end(); ++iter) {
-                uint ip = *iter;
+              for (size_t i=0; i<itsFlagCorr.size(); ++i) {
+                uint ip = itsFlagCorr[i];
                 // If one correlation is flagged, all of them will be flagged.
                 // So no need to check others.
                 if (flagPtr[ip]) {
@@ -323,14 +370,20 @@ namespace DP3 {
                   break;
                 }
                 // Calculate values from the median.
-                computeFactors (timeEntries, ib, ic, ip, nchan, ncorr,
-                    Z1, Z2, tempBuf.storage(),
-                    moveTimer, medianTimer);
+                if (sliding) {
+                  medianTimers[thread].start();
+                  medians[i].getMedians (Z1, Z2);
+                  medianTimers[thread].stop();
+                } else {
+                  computeFactors (timeEntries, ib, ic, ip, nchan, ncorr,
+                      Z1, Z2, tempBufs[thread].storage(),
+                      moveTimers[thread], medianTimers[thread]);
+                }
                 if (dataPtr[ip] > Z1 + threshold * Z2 * MAD) {
                   corrIsFlagged = true;
-                  counter.incrBaseline(ib);
-                  counter.incrChannel(ic);
-                  counter.incrCorrelation(ip);
+                  itsFlagCounters[thread].incrBaseline(ib);
+                  itsFlagCounters[thread].incrChannel(ic);
+                  itsFlagCounters[thread].incrCorrelation(ip);
                   break;
                 }
               }
@@ -338,6 +391,12 @@ namespace DP3 {
                 for (uint ip=0; ip<ncorr; ++ip) {
                   flagPtr[ip] = true;
                 }
+                // The flagged values must not be used for the next channels.
+                if (sliding) {
+                  for (WindowMedian& median : medians) {
+                    median.updateFlags (ic);
+                  }
+                }
               }
               dataPtr += ncorr;
               flagPtr += ncorr;
@@ -346,16 +405,13 @@ namespace DP3 {
             dataPtr += nchan*ncorr;
             flagPtr += nchan*ncorr;
           }
-        } // end of OMP for
-#pragma omp critical(medflagger_updatecounts)
-        {
-          // Add the counters to the overall object.
-          itsFlagCounter.add (counter);
-          // Add the timings.
-          itsMoveTime   += moveTimer.getElapsed();
-          itsMedianTime += medianTimer.getElapsed();
-        } // end of OMP critical
-      } // end of OMP parallel
+        });
+      }
+      for (size_t i=0; i<nthread; ++i) {
+        // Add the timings.
+        itsMoveTime   += moveTimers[i].getElapsed();
+        itsMedianTime += medianTimers[i].getElapsed();
+      }
 
       itsComputeTimer.stop();
       // Apply autocorrelations flags if needed.
@@ -418,20 +474,9 @@ namespace DP3 {
       uint np = 0;
       // At the beginning or end of the window the values are wrapped.
       // So we might need to move in two parts.
-      // This little piece of code is tested in tMirror.cc.
-      int hw = itsFreqWindowArr[bl]/2;
-      int s1 = chan - hw;
-      int e1 = chan + hw + 1;
-      int s2 = 1;
-      int e2 = 1;
-      if (s1 < 0) {
-        e2 = -s1 + 1;
-        s1 = 0;
-      } else if (e1 > nchan) {
-        s2 = nchan + nchan - e1 - 1; // e1-nchan+1 too far, go back that amount
-        e2 = nchan-1;
-        e1 = nchan;
-      }
+      int s1, e1, s2, e2;
+      WindowMedian::windowRanges (chan, itsFreqWindowArr[bl]/2, nchan,
+                                  s1, e1, s2, e2);
       // Iterate over all time entries.
       const uint* iter = &(timeEntries[0]);
       const uint* endIter = iter + itsTimeWindowArr[bl];
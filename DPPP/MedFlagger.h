@@ -30,6 +30,9 @@
 #include "DPInput.h"
 #include "DPBuffer.h"
 #include "FlagCounter.h"
+#include "WindowMedian.h"
+
+#include "../Common/ThreadPool.h"
 
 namespace DP3 {
   class ParameterSet;
@@ -54,6 +57,9 @@ namespace DP3 {
     // points is an O(N^2) operation. The test program tMedian.cc can be
     // used to test the performance of the algorithms to determine the median.
     // It shows that casacore's kthLargest outperforms STL's nth_element.
+    // For larger windows the windows of neighbouring channels share most
+    // data, so then the medians are updated incrementally by WindowMedian
+    // while the window slides along the channels.
     // <br>
     // Shuffling the data around to be able to determine the medians is also
     // an expensive operation, but takes less time than the medians themselves.
@@ -117,6 +123,18 @@ namespace DP3 {
       // Get the values of the expressions for each baseline.
       void getExprValues (int maxNChan, int maxNTime);
 
+      // The smallest window sizes (channels and times) for which the
+      // medians are updated incrementally by WindowMedian instead of being
+      // selected from scratch by computeFactors. From scratch, each channel
+      // costs a copy and two selections of the freqWindow*timeWindow values.
+      // Sliding costs adding and removing 2*timeWindow values and a MAD
+      // search, each O(log) in the number of values of the time rows, plus
+      // ranking all values once per baseline. The counts break even at a
+      // window of about 15 channels by 5 times; smaller windows do better
+      // from scratch.
+      static const uint theirMinSlidingFreqWindow = 15;
+      static const uint theirMinSlidingTimeWindow = 5;
+
     protected:
       //# Data members.
       DPInput*         itsInput;
@@ -141,11 +159,14 @@ namespace DP3 {
       vector<double>   itsBLength;       //# length of each baseline
       vector<DPBuffer> itsBuf;
       vector<casacore::Cube<float> > itsAmpl; //# amplitudes of the data
+      vector<vector<WindowMedian> > itsMedians; //# per thread and correlation
       FlagCounter      itsFlagCounter;
+      vector<FlagCounter> itsFlagCounters; //# per thread of the ThreadPool
       NSTimer          itsTimer;
       NSTimer          itsComputeTimer;  //# move/median timer
       double           itsMoveTime;      //# data move timer (sum all threads)
       double           itsMedianTime;    //# median timer (sum of all threads)
+      ThreadPool::CoreUsage itsCoreUsage;
     };
 
   } //# end namespace
@@ -42,6 +42,7 @@
 #include <casacore/casa/Quanta/MVTime.h>
 #include <casacore/casa/Utilities/GenSort.h>
 #include <casacore/casa/OS/Conversion.h>
+#include <algorithm>
 #include <iostream>
 
 using namespace casacore;
@@ -70,6 +71,9 @@ namespace DP3 {
       itsAutoWeight       = parset.getBool   (prefix+"autoweight", false);
       itsNeedSort         = parset.getBool   (prefix+"sort", false);
       itsOrderMS          = parset.getBool   (prefix+"orderms", true);
+      itsNReadThreads     = parset.getUint   (prefix+"nreadthreads",
+                                              std::min(msNames.size(),
+                                                       size_t(4)));
       // Open all MSs.
       DPStep::ShPtr nullStep (new NullStep());
       itsReaders.reserve (msNames.size());
@@ -96,6 +100,9 @@ namespace DP3 {
       if(itsFirst<0)
         throw Exception("All input MeasurementSets do not exist");
       itsBuffers.resize (itsReaders.size());
+      itsNReadThreads = std::max (1u, std::min (itsNReadThreads,
+                                                uint(itsReaders.size())));
+      itsReadPool.reset (new ThreadPool(itsNReadThreads));
     }
 
     MultiMSReader::~MultiMSReader()
@@ -206,14 +213,6 @@ namespace DP3 {
 
     bool MultiMSReader::process (const DPBuffer& buf)
     {
-      // Stop if at end.
-      if (! itsReaders[itsFirst]->process (buf)) {
-        return false;   // end of input
-      }
-      const DPBuffer& buf1 = itsReaders[itsFirst]->getBuffer();
-      itsBuffer.setTime     (buf1.getTime());
-      itsBuffer.setExposure (buf1.getExposure());
-      itsBuffer.setRowNrs   (buf1.getRowNrs());
       // Size the buffers.
       if (itsBuffer.getFlags().empty()) {
         if (itsReadVisData) {
@@ -223,34 +222,61 @@ namespace DP3 {
         itsBuffer.getFlags().resize (IPosition(3, itsNrCorr,
                                                itsNrChan, itsNrBl));
       }
-      // Loop through all readers and get data and flags.
-      IPosition s(3, 0, 0, 0);
-      IPosition e(3, itsNrCorr-1, 0, itsNrBl-1);
-      for (uint i=0; i<itsReaders.size(); ++i) {
+      // Make the channel slices of the combined buffer here, so the
+      // I/O threads only assign to their own slice.
+      uint nparts = itsReaders.size();
+      vector<Cube<Complex>> dataParts(nparts);
+      vector<Cube<bool>>    flagParts(nparts);
+      for (uint i=0; i<nparts; ++i) {
+        uint nchan = (itsReaders[i] ? itsReaders[i]->getInfo().nchan() :
+                      itsFillNChan);
+        IPosition s(3, 0, itsChanStart[i], 0);
+        IPosition e(3, itsNrCorr-1, itsChanStart[i] + nchan - 1, itsNrBl-1);
+        if (itsReadVisData) {
+          dataParts[i].reference (itsBuffer.getData()(s,e));
+        }
+        flagParts[i].reference (itsBuffer.getFlags()(s,e));
+      }
+      // Read all MSs in parallel and copy their data and flags.
+      vector<char> atEnd(nparts, false);
+      itsReadPool->For (0, nparts, 1, [&](size_t i, size_t) {
         if (itsReaders[i]) {
-          if (int(i) != itsFirst) {
-            itsReaders[i]->process (buf);
+          if (! itsReaders[i]->process (buf)) {
+            atEnd[i] = true;
+            return;
           }
           const DPBuffer& msBuf = itsReaders[i]->getBuffer();
           if (msBuf.getRowNrs().empty())
             throw Exception(
                      "When using multiple MSs, the times in all MSs have to be "
                      "consecutive; this is not the case for MS " + std::to_string(i));
-          // Copy data and flags.
-          e[1] = s[1] + itsReaders[i]->getInfo().nchan() - 1;
           if (itsReadVisData) {
-            itsBuffer.getData()(s,e) = msBuf.getData();
+            dataParts[i] = msBuf.getData();
           }
-          itsBuffer.getFlags()(s,e) = msBuf.getFlags();
+          flagParts[i] = msBuf.getFlags();
         } else {
-          e[1] = s[1] + itsFillNChan - 1;
           if (itsReadVisData) {
-            itsBuffer.getData()(s,e) = Complex();
+            dataParts[i] = Complex();
           }
-          itsBuffer.getFlags()(s,e) = true;
-        }          
-        s[1] = e[1] + 1;
+          flagParts[i] = true;
+        }
+      });
+      // Stop if at end.
+      if (atEnd[itsFirst]) {
+        return false;   // end of input
+      }
+      // Another MS ending earlier would leave its part of the buffer filled
+      // with the previous time slot.
+      for (uint i=0; i<nparts; ++i) {
+        if (atEnd[i])
+          throw Exception(
+                   "When using multiple MSs, the times in all MSs have to be "
+                   "consecutive; MS " + std::to_string(i) + " ends earlier");
       }
+      const DPBuffer& buf1 = itsReaders[itsFirst]->getBuffer();
+      itsBuffer.setTime     (buf1.getTime());
+      itsBuffer.setExposure (buf1.getExposure());
+      itsBuffer.setRowNrs   (buf1.getRowNrs());
       getNextStep()->process (itsBuffer);
       return true;
     }
@@ -315,6 +341,7 @@ namespace DP3 {
       // Handle the bands and take care of missing MSs.
       // Sort them if needed.
       handleBands();
+      setChanStart();
 
       // check that channels are regularly spaced, give warning otherwise
       if (itsNrChan>1) {
@@ -337,6 +364,17 @@ namespace DP3 {
       itsFlagCounter.init (getInfo());
     }
 
+    void MultiMSReader::setChanStart()
+    {
+      itsChanStart.resize (itsReaders.size());
+      uint chan = 0;
+      for (uint i=0; i<itsReaders.size(); ++i) {
+        itsChanStart[i] = chan;
+        chan += (itsReaders[i] ? itsReaders[i]->getInfo().nchan() :
+                 itsFillNChan);
+      }
+    }
+
     void MultiMSReader::show (std::ostream& os) const
     {
       os << "MultiMSReader" << std::endl;
@@ -373,6 +411,7 @@ namespace DP3 {
       }
       os << "  WEIGHT column:  " << itsWeightColName << std::endl;
       os << "  autoweight:     " << boolalpha << itsAutoWeight << std::endl;
+      os << "  nreadthreads:   " << itsNReadThreads << std::endl;
     }
 
     void MultiMSReader::showCounts (std::ostream& os) const
@@ -407,20 +446,23 @@ namespace DP3 {
       if (weights.empty()) {
         weights.resize (itsNrCorr, itsNrChan, itsNrBl);
       }
-      IPosition s(3, 0, 0, 0);
-      IPosition e(3, itsNrCorr-1, 0, itsNrBl-1);
-      for (uint i=0; i<itsReaders.size(); ++i) {
+      uint nparts = itsReaders.size();
+      vector<Cube<float>> parts(nparts);
+      for (uint i=0; i<nparts; ++i) {
+        uint nchan = (itsReaders[i] ? itsReaders[i]->getInfo().nchan() :
+                      itsFillNChan);
+        IPosition s(3, 0, itsChanStart[i], 0);
+        IPosition e(3, itsNrCorr-1, itsChanStart[i] + nchan - 1, itsNrBl-1);
+        parts[i].reference (weights(s,e));
+      }
+      itsReadPool->For (0, nparts, 1, [&](size_t i, size_t) {
         if (itsReaders[i]) {
-          uint nchan = itsReaders[i]->getInfo().nchan();
-          e[1] = s[1] + nchan-1;
           itsReaders[i]->getWeights (rowNrs, itsBuffers[i]);
-          weights(s,e) = itsBuffers[i].getWeights();
+          parts[i] = itsBuffers[i].getWeights();
         } else {
-          e[1] = s[1] + itsFillNChan-1;
-          weights(s,e) = float(0);
+          parts[i] = float(0);
         }
-        s[1] = e[1] + 1;
-      }
+      });
     }
 
     bool MultiMSReader::getFullResFlags (const RefRows& rowNrs,
@@ -443,19 +485,24 @@ namespace DP3 {
         return true;
       }
       // Get the flags from all MSs and combine them.
-      IPosition s(3, 0);
-      IPosition e(flags.shape() - 1);
-      for (uint i=0; i<itsReaders.size(); ++i) {
+      uint nparts = itsReaders.size();
+      vector<Cube<bool>> parts(nparts);
+      for (uint i=0; i<nparts; ++i) {
+        uint nchan = (itsReaders[i] ? itsReaders[i]->getInfo().nchan() :
+                      itsFillNChan);
+        IPosition s(3, itsChanStart[i] * itsFullResNChanAvg, 0, 0);
+        IPosition e(flags.shape() - 1);
+        e[0] = (itsChanStart[i] + nchan) * itsFullResNChanAvg - 1;
+        parts[i].reference (flags(s,e));
+      }
+      itsReadPool->For (0, nparts, 1, [&](size_t i, size_t) {
         if (itsReaders[i]) {
           itsReaders[i]->getFullResFlags (rowNrs, itsBuffers[i]);
-          e[0] = s[0] + itsBuffers[i].getFullResFlags().shape()[0] - 1;
-          flags(s,e) = itsBuffers[i].getFullResFlags();
+          parts[i] = itsBuffers[i].getFullResFlags();
         } else {
-          e[0] = s[0] + itsFillNChan - 1;
-          flags(s,e) = true;
+          parts[i] = true;
         }
-        s[0] = e[0] + 1;
-      }
+      });
       return true;
     }
 
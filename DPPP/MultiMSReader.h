@@ -32,10 +32,14 @@
 #include "UVWCalculator.h"
 #include "FlagCounter.h"
 
+#include "../Common/ThreadPool.h"
+
 #include <casacore/tables/Tables/TableIter.h>
 #include <casacore/tables/Tables/RefRows.h>
 #include <casacore/casa/Arrays/Slicer.h>
 
+#include <memory>
+
 namespace DP3 {
 
   class ParameterSet;
@@ -59,8 +63,16 @@ namespace DP3 {
     //  <li> msin.datacolumn: the data column to use [DATA]
     //  <li> msin.starttime: first time to use [first time in MS]
     //  <li> msin.endtime: last time to use [last time in MS]
+    //  <li> msin.nreadthreads: number of MSs read in parallel
+    //       [min(nMS,4)]
     // </ul>
     //
+    // The MSs (one per subband) are read in parallel by a separate pool of
+    // nreadthreads I/O threads, so the reads do not take threads from the
+    // compute pool. Each I/O thread copies the part it has read directly
+    // into its channel range of the combined buffer. The weights and
+    // full resolution flags are fetched in the same way.
+    //
     // If a time slot is missing, it is inserted with flagged data set to zero.
     // Missing time slots can also be detected at the beginning or end of the
     // MS by giving the correct starttime and endtime.
@@ -182,6 +194,9 @@ namespace DP3 {
       // Fill the band info where some MSs are missing.
       void fillBands();
 
+      // Set the first channel of each MS in the combined band.
+      void setChanStart();
+
       //# Data members.
       bool                  itsOrderMS;   //# sort multi MS in order of freq?
       int                   itsFirst;     //# first valid MSReader (<0 = none)
@@ -190,7 +205,10 @@ namespace DP3 {
       vector<MSReader*>     itsReaders;   //# same as itsSteps
       vector<DPStep::ShPtr> itsSteps;     //# used for automatic destruction
       vector<DPBuffer>      itsBuffers;
+      vector<uint>          itsChanStart; //# first channel of each MS
       uint                  itsFillNChan; //# nr of chans for missing MSs
+      uint                  itsNReadThreads;
+      std::unique_ptr<ThreadPool> itsReadPool; //# I/O threads reading MSs
       FlagCounter           itsFlagCounter;
       bool                  itsRegularChannels; // Are resulting channels regularly spaced
     };
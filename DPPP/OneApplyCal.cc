@@ -31,6 +31,7 @@
 
 #include "../Common/ParameterSet.h"
 #include "../Common/StringUtil.h"
+#include "../Common/ThreadPool.h"
 
 #include <casacore/casa/Arrays/ArrayMath.h>
 #include <casacore/casa/OS/File.h>
@@ -50,6 +51,8 @@ using namespace DP3::BBS;
 namespace DP3 {
   namespace DPPP {
 
+    std::mutex OneApplyCal::theirH5ParmMutex;
+
     OneApplyCal::OneApplyCal (DPInput* input,
                         const ParameterSet& parset,
                         const string& prefix,
@@ -307,6 +310,11 @@ namespace DP3 {
 
       initDataArrays();
       itsFlagCounter.init(getInfo());
+      // Count the flags per thread to avoid races on the flag counter.
+      itsFlagCounters.resize (ThreadPool::GetInstance().NThreads());
+      for (FlagCounter& counter : itsFlagCounters) {
+        counter.init (getInfo());
+      }
 
       // Check that channels are evenly spaced
       if (info().nchan()>1) {
@@ -357,14 +365,44 @@ namespace DP3 {
     {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " OneApplyCal " << itsName << '\n';
+      os << " OneApplyCal " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(itsTimer.getElapsed()));
+      os << '\n';
     }
 
     bool OneApplyCal::process (const DPBuffer& bufin)
     {
       itsTimer.start();
       itsBuffer.copy (bufin);
+      applyBuffer (bufin, itsBuffer);
+      itsTimer.stop();
+      getNextStep()->process(itsBuffer);
+
+      itsCount++;
+      return true;
+    }
+
+    bool OneApplyCal::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      itsTimer.start();
+      const IPosition& shape = bufs[0].getData().shape();
+      if (itsBatch.size() != bufs.size()  ||
+          !itsBatch[0].getData().shape().isEqual(shape)) {
+        itsBatch = DPBuffer::makeBatch (shape, bufs.size(), true, true, false);
+      }
+      for (size_t t=0; t<bufs.size(); ++t) {
+        itsBatch[t].copy (bufs[t]);
+        applyBuffer (bufs[t], itsBatch[t]);
+      }
+      itsTimer.stop();
+      getNextStep()->processBatch(itsBatch);
 
+      itsCount += bufs.size();
+      return true;
+    }
+
+    void OneApplyCal::applyBuffer (const DPBuffer& bufin, DPBuffer& buffer)
+    {
       if (bufin.getTime() > itsLastTime) {
         updateParms(bufin.getTime());
         itsTimeStep=0;
@@ -374,51 +412,52 @@ namespace DP3 {
       }
 
       // Loop through all baselines in the buffer.
-      size_t nbl = itsBuffer.getData().shape()[2];
-
-      Complex* data = itsBuffer.getData().data();
-
-      itsInput->fetchWeights (bufin, itsBuffer, itsTimer);
-      float* weight = itsBuffer.getWeights().data();
-
-      bool* flag = itsBuffer.getFlags().data();
-
-      size_t nchan = itsBuffer.getData().shape()[1];
-
-#pragma omp parallel for
-      for (size_t bl=0; bl<nbl; ++bl) {
-        for (size_t chan=0;chan<nchan;chan++) {
-          uint timeFreqOffset=(itsTimeStep*info().nchan())+chan;
-          uint antA = info().getAnt1()[bl];
-          uint antB = info().getAnt2()[bl];
-          if (itsParms.shape()[0]>2) {
-            ApplyCal::applyFull( &itsParms(0, antA, timeFreqOffset),
-                       &itsParms(0, antB, timeFreqOffset),
-                       &data[bl * itsNCorr * nchan + chan * itsNCorr ],
-                       &weight[bl * itsNCorr * nchan + chan * itsNCorr ],
-                       &flag[  bl * itsNCorr * nchan + chan * itsNCorr ],
-                       bl, chan, itsUpdateWeights, itsFlagCounter);
-          }
-          else {
-            ApplyCal::applyDiag( &itsParms(0, antA, timeFreqOffset),
-                       &itsParms(0, antB, timeFreqOffset),
-                       &data[bl * itsNCorr * nchan + chan * itsNCorr ],
-                       &weight[bl * itsNCorr * nchan + chan * itsNCorr ],
-                       &flag[  bl * itsNCorr * nchan + chan * itsNCorr ],
-                       bl, chan, itsUpdateWeights, itsFlagCounter);
+      size_t nbl = buffer.getData().shape()[2];
+
+      Complex* data = buffer.getData().data();
+
+      itsInput->fetchWeights (bufin, buffer, itsTimer);
+      float* weight = buffer.getWeights().data();
+
+      bool* flag = buffer.getFlags().data();
+
+      size_t nchan = buffer.getData().shape()[1];
+
+      ThreadPool& pool = ThreadPool::GetInstance();
+      {
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
+        pool.For(0, nbl, [&](size_t bl, size_t thread) {
+          for (size_t chan=0;chan<nchan;chan++) {
+            uint timeFreqOffset=(itsTimeStep*info().nchan())+chan;
+            uint antA = info().getAnt1()[bl];
+            uint antB = info().getAnt2()[bl];
+            if (itsParms.shape()[0]>2) {
+              ApplyCal::applyFull( &itsParms(0, antA, timeFreqOffset),
+                         &itsParms(0, antB, timeFreqOffset),
+                         &data[bl * itsNCorr * nchan + chan * itsNCorr ],
+                         &weight[bl * itsNCorr * nchan + chan * itsNCorr ],
+                         &flag[  bl * itsNCorr * nchan + chan * itsNCorr ],
+                         bl, chan, itsUpdateWeights, itsFlagCounters[thread]);
+            }
+            else {
+              ApplyCal::applyDiag( &itsParms(0, antA, timeFreqOffset),
+                         &itsParms(0, antB, timeFreqOffset),
+                         &data[bl * itsNCorr * nchan + chan * itsNCorr ],
+                         &weight[bl * itsNCorr * nchan + chan * itsNCorr ],
+                         &flag[  bl * itsNCorr * nchan + chan * itsNCorr ],
+                         bl, chan, itsUpdateWeights, itsFlagCounters[thread]);
+            }
           }
-        }
+        });
       }
-
-      itsTimer.stop();
-      getNextStep()->process(itsBuffer);
-
-      itsCount++;
-      return true;
     }
 
     void OneApplyCal::finish()
     {
+      // Add the counts of all threads.
+      for (const FlagCounter& counter : itsFlagCounters) {
+        itsFlagCounter.add (counter);
+      }
       // Let the next steps finish.
       getNextStep()->finish();
     }
@@ -474,19 +513,6 @@ namespace DP3 {
 
       // Fill parmvalues here, get raw data from H5Parm or ParmDB
       if (itsUseH5Parm) {
-#pragma omp critical(updateH5ParmValues)
-{
-        // TODO: understand polarization etc.
-        //  assert(itsParmExprs.size()==1 || itsParmExprs.size()==2);
-
-        // Figure out whether time or frequency is first axis
-        bool freqvariesfastest = true;
-        if (itsSolTab.hasAxis("freq") && itsSolTab.hasAxis("time") &&
-            itsSolTab.getAxisIndex("freq") < itsSolTab.getAxisIndex("time")) {
-          freqvariesfastest = false;
-        }
-        assert(freqvariesfastest);
-
         vector<double> times(info().ntime());
         for (uint t=0; t<times.size(); ++t) {
           // time centroids
@@ -497,41 +523,51 @@ namespace DP3 {
           freqs[ch] = info().chanFreqs()[ch];
         }
 
-        vector<double> weights;
-        for (uint ant = 0; ant < numAnts; ++ant) {
+        if (!itsSolTabCache) {
+          // HDF5 is not thread safe, while the ApplyCal steps in the predict
+          // steps of DDECal and H5ParmPredict can run in parallel.
+          // The SolTab is read once for all steps using it.
+          std::lock_guard<std::mutex> lock(theirH5ParmMutex);
+          itsSolTabCache = SolTabCache::get(itsParmDBName,
+                                            itsH5Parm.getSolSetName(),
+                                            itsSolTab, freqs);
+          if (itsCorrectType == FULLJONES) {
+            itsSolTabCache2 = SolTabCache::get(itsParmDBName,
+                                               itsH5Parm.getSolSetName(),
+                                               itsSolTab2, freqs);
+          }
+        }
+
+        // The values are interpolated from memory, so without locking.
+        ThreadPool::GetInstance().For(0, numAnts, [&](size_t ant, size_t) {
+          const string& antName = info().antennaNames()[ant];
+          vector<double> weights;
           if(itsCorrectType == FULLJONES)
           {
             for (uint pol=0; pol<4; ++pol) {
               // Place amplitude in even and phase in odd elements
-              parmvalues[pol*2][ant] = itsSolTab.getValuesOrWeights("val",
-                info().antennaNames()[ant],
-                times, freqs,
-                pol, itsDirection);
-              weights = itsSolTab.getValuesOrWeights("weight",
-                info().antennaNames()[ant], times, freqs, pol, itsDirection);
+              parmvalues[pol*2][ant] = itsSolTabCache->getValuesOrWeights("val",
+                antName, times, freqs, pol, itsDirection);
+              weights = itsSolTabCache->getValuesOrWeights("weight",
+                antName, times, freqs, pol, itsDirection);
               applyFlags(parmvalues[pol*2][ant], weights);
-              parmvalues[pol*2+1][ant] = itsSolTab2.getValuesOrWeights("val",
-                info().antennaNames()[ant],
-                times, freqs,
-                pol, itsDirection);
-              weights = itsSolTab2.getValuesOrWeights("weight",
-                info().antennaNames()[ant], times, freqs, pol, itsDirection);
+              parmvalues[pol*2+1][ant] = itsSolTabCache2->getValuesOrWeights("val",
+                antName, times, freqs, pol, itsDirection);
+              weights = itsSolTabCache2->getValuesOrWeights("weight",
+                antName, times, freqs, pol, itsDirection);
               applyFlags(parmvalues[pol*2+1][ant], weights);
             }
           }
           else {
             for (uint pol=0; pol<itsParmExprs.size(); ++pol) {
-              parmvalues[pol][ant] = itsSolTab.getValuesOrWeights("val",
-                info().antennaNames()[ant],
-                times, freqs,
-                pol, itsDirection);
-              weights = itsSolTab.getValuesOrWeights("weight",
-                info().antennaNames()[ant], times, freqs, pol, itsDirection);
+              parmvalues[pol][ant] = itsSolTabCache->getValuesOrWeights("val",
+                antName, times, freqs, pol, itsDirection);
+              weights = itsSolTabCache->getValuesOrWeights("weight",
+                antName, times, freqs, pol, itsDirection);
               applyFlags(parmvalues[pol][ant], weights);
             }
           }
-        }
-} // End pragma omp critical
+        });
       } else { // Use ParmDB
         for (uint parmExprNum = 0; parmExprNum<itsParmExprs.size();++parmExprNum) {
           // parmMap contains parameter values for all antennas
@@ -30,15 +30,20 @@
 #include "DPInput.h"
 #include "DPBuffer.h"
 #include "H5Parm.h"
+#include "SolTabCache.h"
 #include "FlagCounter.h"
 
 #include "../ParmDB/ParmFacade.h"
 #include "../ParmDB/ParmSet.h"
 #include "../ParmDB/Parm.h"
 
+#include "../Common/ThreadPool.h"
+
 #include <casacore/casa/Arrays/Cube.h>
 #include <casacore/casa/Arrays/ArrayMath.h>
 
+#include <mutex>
+
 namespace DP3 {
   namespace DPPP {
     // @ingroup NDPPP
@@ -68,6 +73,11 @@ namespace DP3 {
       // When processed, it invokes the process function of the next step.
       virtual bool process (const DPBuffer&);
 
+      // Process a batch of time slots.
+      // It keeps the data.
+      // When processed, it invokes the processBatch function of the next step.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish();
 
@@ -85,6 +95,9 @@ namespace DP3 {
       }
 
     private:
+      // Apply the solutions to the buffer, which is a copy of bufin.
+      void applyBuffer (const DPBuffer& bufin, DPBuffer& buffer);
+
       // Read parameters from the associated parmdb and store them in itsParms
       void updateParms (const double bufStartTime);
 
@@ -106,6 +119,7 @@ namespace DP3 {
       //# Data members.
       DPInput*         itsInput;
       DPBuffer         itsBuffer;
+      std::vector<DPBuffer> itsBatch;
       string           itsName;
       string           itsParmDBName;
       bool             itsUseH5Parm;
@@ -115,6 +129,8 @@ namespace DP3 {
       string           itsSolTabName;
       H5Parm::SolTab   itsSolTab;
       H5Parm::SolTab   itsSolTab2; // in the case of full Jones, amp and phase table need to be open
+      SolTabCache::ShPtr itsSolTabCache;  // values of itsSolTab in memory
+      SolTabCache::ShPtr itsSolTabCache2; // values of itsSolTab2 in memory
       CorrectType      itsCorrectType;
       bool             itsInvert;
       uint             itsTimeSlotsPerParmUpdate;
@@ -133,9 +149,14 @@ namespace DP3 {
       double          itsTimeInterval;
       double          itsLastTime; // last time of current chunk
       FlagCounter     itsFlagCounter;
+      vector<FlagCounter> itsFlagCounters; //# per thread of the ThreadPool
       bool            itsUseAP;      //# use ampl/phase or real/imag
       hsize_t         itsDirection;
       NSTimer         itsTimer;
+      ThreadPool::CoreUsage itsCoreUsage;
+
+      // Guards the H5Parm reads of all OneApplyCal steps.
+      static std::mutex theirH5ParmMutex;
     };
 
   } //# end namespace
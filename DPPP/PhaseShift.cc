@@ -51,7 +51,8 @@ namespace DP3 {
                             const string& prefix)
       : itsInput   (input),
         itsName    (prefix),
-        itsCenter  (parset.getStringVector(prefix+"phasecenter"))
+        itsCenter  (parset.getStringVector(prefix+"phasecenter")),
+        itsKeepPhasors (false)
     {}
 
     PhaseShift::PhaseShift (DPInput* input,
@@ -60,7 +61,8 @@ namespace DP3 {
                             const vector<string>& defVal)
       : itsInput   (input),
         itsName    (prefix),
-        itsCenter  (parset.getStringVector(prefix+"phasecenter", defVal))
+        itsCenter  (parset.getStringVector(prefix+"phasecenter", defVal)),
+        itsKeepPhasors (true)
     {}
 
     PhaseShift::~PhaseShift()
@@ -105,7 +107,10 @@ namespace DP3 {
       for (uint i=0; i<freq.size(); ++i) {
         itsFreqC.push_back (2. * C::pi * freq[i] / C::c);
       }
-      itsPhasors.resize (infoIn.nchan(), infoIn.nbaselines());
+      itsFreqAxis = PhasorAxis (itsFreqC);
+      if (itsKeepPhasors) {
+        itsPhasors.resize (infoIn.nchan(), infoIn.nbaselines());
+      }
     }
 
     void PhaseShift::show (std::ostream& os) const
@@ -118,7 +123,9 @@ namespace DP3 {
     {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " PhaseShift " << itsName << endl;
+      os << " PhaseShift " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(itsTimer.getElapsed()));
+      os << endl;
     }
 
     bool PhaseShift::process (const DPBuffer& buf)
@@ -130,44 +137,81 @@ namespace DP3 {
       int ncorr  = itsBuf.getData().shape()[0];
       int nchan  = itsBuf.getData().shape()[1];
       int nbl    = itsBuf.getData().shape()[2];
-      assert (itsPhasors.nrow() == uint(nchan)  &&
-                 itsPhasors.ncolumn() == uint(nbl));
-      const double* mat1 = itsMat1.data();
+      assert (!itsKeepPhasors  ||  (itsPhasors.nrow() == uint(nchan)  &&
+                                    itsPhasors.ncolumn() == uint(nbl)));
       //# If ever in the future a time dependent phase center is used,
       //# the machine must be reset for each new time, thus each new call
       //# to process.
-#pragma omp parallel for
-      for (int i=0; i<nbl; ++i) {
-        Complex*  __restrict__ data    = itsBuf.getData().data() + i*nchan*ncorr;
-        double*   __restrict__ uvw     = itsBuf.getUVW().data() + i*3;
-        DComplex* __restrict__ phasors = itsPhasors.data() + i*nchan;
-        double u = uvw[0]*mat1[0] + uvw[1]*mat1[3] + uvw[2]*mat1[6];
-        double v = uvw[0]*mat1[1] + uvw[1]*mat1[4] + uvw[2]*mat1[7];
-        double w = uvw[0]*mat1[2] + uvw[1]*mat1[5] + uvw[2]*mat1[8];
-        double phase = itsXYZ[0]*uvw[0] + itsXYZ[1]*uvw[1] + itsXYZ[2]*uvw[2];
-        for (int j=0; j<nchan; ++j) {
-          // Shift the phase of the data of this baseline.
-          // Converting the phase term to wavelengths (and applying 2*pi)
-          //      u_wvl = u_m / wvl = u_m * freq / c
-                // has been done once in the beginning (in updateInfo).
-          double phasewvl = phase * itsFreqC[j];
-          DComplex phasor(cos(phasewvl), sin(phasewvl));
-          *phasors++ = phasor;
-          for (int k=0; k<ncorr; ++k) {
-            *data = DComplex(*data) * phasor;
-            data++;
-          }
-        }
-        uvw[0] = u;
-        uvw[1] = v;
-        uvw[2] = w;
-        uvw += 3;
-      }  //# end omp parallel for
+      {
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
+        ThreadPool::GetInstance().For(0, nbl, [&](size_t i, size_t /*thread*/) {
+          shiftBaseline (nchan, ncorr,
+                         itsBuf.getData().data() + i*nchan*ncorr,
+                         itsBuf.getUVW().data() + i*3,
+                         itsKeepPhasors ? itsPhasors.data() + i*nchan : 0);
+        });
+      }
       itsTimer.stop();
       getNextStep()->process (itsBuf);
       return true;
     }
 
+    bool PhaseShift::processBatch (const std::vector<DPBuffer>& bufs)
+    {
+      itsTimer.start();
+      const IPosition& shape = bufs[0].getData().shape();
+      if (itsBatch.size() != bufs.size()  ||
+          !itsBatch[0].getData().shape().isEqual(shape)) {
+        itsBatch = DPBuffer::makeBatch (shape, bufs.size(), true, false, true);
+      }
+      for (size_t t=0; t<bufs.size(); ++t) {
+        itsBatch[t].copy (bufs[t]);
+        itsInput->fetchUVW (bufs[t], itsBatch[t], itsTimer);
+      }
+      int ncorr  = shape[0];
+      int nchan  = shape[1];
+      int nbl    = shape[2];
+      assert (!itsKeepPhasors  ||  (itsPhasors.nrow() == uint(nchan)  &&
+                                    itsPhasors.ncolumn() == uint(nbl)));
+      // Loop over all baselines of all time slots at once.
+      // Only the phasors of the last time slot are kept.
+      const size_t last = itsKeepPhasors ? bufs.size() - 1 : bufs.size();
+      {
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
+        ThreadPool::GetInstance().For(0, bufs.size()*nbl,
+                                      [&](size_t i, size_t /*thread*/) {
+          size_t t  = i / nbl;
+          size_t bl = i % nbl;
+          shiftBaseline (nchan, ncorr,
+                         itsBatch[t].getData().data() + bl*nchan*ncorr,
+                         itsBatch[t].getUVW().data() + bl*3,
+                         t == last ? itsPhasors.data() + bl*nchan : nullptr);
+        });
+      }
+      itsTimer.stop();
+      getNextStep()->processBatch (itsBatch);
+      return true;
+    }
+
+    void PhaseShift::shiftBaseline (int nchan, int ncorr, Complex* data,
+                                    double* uvw, DComplex* phasors) const
+    {
+      const double* mat1 = itsMat1.data();
+      double u = uvw[0]*mat1[0] + uvw[1]*mat1[3] + uvw[2]*mat1[6];
+      double v = uvw[0]*mat1[1] + uvw[1]*mat1[4] + uvw[2]*mat1[7];
+      double w = uvw[0]*mat1[2] + uvw[1]*mat1[5] + uvw[2]*mat1[8];
+      double phase = itsXYZ[0]*uvw[0] + itsXYZ[1]*uvw[1] + itsXYZ[2]*uvw[2];
+      // Shift the phase of the data of this baseline.
+      // Converting the phase term to wavelengths (and applying 2*pi)
+      //      u_wvl = u_m / wvl = u_m * freq / c
+      // has been done once in the beginning (in updateInfo).
+      assert (itsFreqAxis.size() == uint(nchan));
+      itsFreqAxis.apply (phase, ncorr, data, phasors);
+      uvw[0] = u;
+      uvw[1] = v;
+      uvw[2] = w;
+    }
+
     void PhaseShift::finish()
     {
       // Let the next steps finish.
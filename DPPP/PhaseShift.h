@@ -29,6 +29,9 @@
 
 #include "DPInput.h"
 #include "DPBuffer.h"
+#include "Phasors.h"
+
+#include "../Common/ThreadPool.h"
 
 #include <casacore/casa/Arrays/Matrix.h>
 
@@ -44,6 +47,10 @@ namespace DP3 {
     // done back to the original phase center.
     //
     // The code is based on the script phaseshift.py by Bas vd Tol.
+    //
+    // If the channels are regularly spaced, the phasors of a baseline are
+    // computed by recurrence (see PhasorAxis) instead of a sin and cos for
+    // each channel.
 
     class PhaseShift: public DPStep
     {
@@ -56,7 +63,8 @@ namespace DP3 {
       // Construct the object.
       // Parameters are obtained from the parset using the given prefix.
       // This is a constructor for Demixer where the phasecenter has the
-      // given default value.
+      // given default value. Only a step made this way keeps the phasors
+      // (see getPhasors).
       PhaseShift (DPInput*, const ParameterSet&, const string& prefix,
                   const vector<string>& defVal);
 
@@ -67,6 +75,11 @@ namespace DP3 {
       // When processed, it invokes the process function of the next step.
       virtual bool process (const DPBuffer&);
 
+      // Process a batch of time slots in a single parallel loop.
+      // It keeps the data.
+      // When processed, it invokes the processBatch function of the next step.
+      virtual bool processBatch (const std::vector<DPBuffer>&);
+
       // Finish the processing of this step and subsequent steps.
       virtual void finish();
 
@@ -96,17 +109,26 @@ namespace DP3 {
       // Interpret the phase center specification.
       // Currently only J2000 RA and DEC can be given.
       casacore::MDirection handleCenter();
+
+      // Shift the data and uvw of a baseline. If phasors is not null,
+      // the phasors per channel are stored in it.
+      void shiftBaseline (int nchan, int ncorr, casacore::Complex* data,
+                          double* uvw, casacore::DComplex* phasors) const;
       
       //# Data members.
       DPInput*             itsInput;
       string               itsName;
       DPBuffer             itsBuf;
+      std::vector<DPBuffer> itsBatch;
       vector<string>       itsCenter;
       vector<double>       itsFreqC;      //# freq/C
+      PhasorAxis           itsFreqAxis;   //# phasor computation for itsFreqC
+      bool                 itsKeepPhasors;
       casacore::Matrix<double> itsMat1;       //# TT in phasehift.py
       double               itsXYZ[3];     //# numpy.dot((w-w1).T, T)
       casacore::Matrix<casacore::DComplex> itsPhasors; //# phase factor per chan,bl
       NSTimer              itsTimer;
+      ThreadPool::CoreUsage itsCoreUsage;
     };
 
   } //# end namespace
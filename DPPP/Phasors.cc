@@ -0,0 +1,146 @@
+//# Phasors.cc: Compute and apply phase rotations along a frequency axis
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include "Phasors.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace casacore;
+
+namespace DP3 {
+  namespace DPPP {
+
+    const size_t PhasorAxis::chunkSize;
+
+    PhasorAxis::PhasorAxis()
+      : itsStart   (0),
+        itsStep    (0),
+        itsRegular (false)
+    {}
+
+    PhasorAxis::PhasorAxis (const std::vector<double>& values)
+      : itsValues  (values),
+        itsStart   (0),
+        itsStep    (0),
+        itsRegular (false)
+    {
+      const size_t n = values.size();
+      if (n > 2) {
+        itsStart = values[0];
+        itsStep  = (values[n-1] - values[0]) / (n-1);
+        // The recurrence deviates from the exact phasor by at most
+        // phase*|x[j] - (x0 + j*dx)|, so require a near exact match.
+        itsRegular = true;
+        for (size_t j=1; j<n-1; ++j) {
+          double diff = values[j] - (itsStart + j*itsStep);
+          if (std::abs(diff) > 1e-14 * std::abs(values[j])) {
+            itsRegular = false;
+            break;
+          }
+        }
+      }
+    }
+
+    void PhasorAxis::fillChunk (double phase, size_t start, size_t end,
+                                DComplex* phasors) const
+    {
+      if (! itsRegular) {
+        for (size_t j=start; j<end; ++j) {
+          double phasewvl = phase * itsValues[j];
+          phasors[j-start] = DComplex(cos(phasewvl), sin(phasewvl));
+        }
+        return;
+      }
+      // Start with an exact phasor and rotate it by exp(i*phase*dx).
+      double phasewvl = phase * itsValues[start];
+      double pr = cos(phasewvl);
+      double pi = sin(phasewvl);
+      const double rr = cos(phase * itsStep);
+      const double ri = sin(phase * itsStep);
+      phasors[0] = DComplex(pr, pi);
+      for (size_t j=1; j<end-start; ++j) {
+        double tr = pr*rr - pi*ri;
+        pi = pr*ri + pi*rr;
+        pr = tr;
+        phasors[j] = DComplex(pr, pi);
+      }
+    }
+
+    void PhasorAxis::fill (double phase, DComplex* phasors) const
+    {
+      for (size_t start=0; start<itsValues.size(); start+=chunkSize) {
+        size_t end = std::min (start+chunkSize, itsValues.size());
+        fillChunk (phase, start, end, phasors + start);
+      }
+    }
+
+    void PhasorAxis::apply (double phase, unsigned int ncorr, Complex* data,
+                            DComplex* phasors) const
+    {
+      DComplex chunk[chunkSize];
+      for (size_t start=0; start<itsValues.size(); start+=chunkSize) {
+        size_t end = std::min (start+chunkSize, itsValues.size());
+        fillChunk (phase, start, end, chunk);
+        if (phasors) {
+          std::copy (chunk, chunk + end-start, phasors + start);
+        }
+        applyPhasors (chunk, end-start, ncorr, data + start*ncorr);
+      }
+    }
+
+    void PhasorAxis::applyPhasors (const DComplex* phasors, size_t n,
+                                   unsigned int ncorr, Complex* data)
+    {
+      // Do the complex multiplications on the real and imaginary parts,
+      // so the compiler can vectorize the loops.
+      const double* p = reinterpret_cast<const double*>(phasors);
+      float* d = reinterpret_cast<float*>(data);
+      if (ncorr == 4) {
+#pragma omp simd
+        for (size_t j=0; j<n; ++j) {
+          const double pr = p[2*j];
+          const double pi = p[2*j+1];
+          float* dj = d + 8*j;
+          for (unsigned int k=0; k<8; k+=2) {
+            const double dr = dj[k];
+            const double di = dj[k+1];
+            dj[k]   = dr*pr - di*pi;
+            dj[k+1] = dr*pi + di*pr;
+          }
+        }
+      } else {
+        for (size_t j=0; j<n; ++j) {
+          const double pr = p[2*j];
+          const double pi = p[2*j+1];
+          float* dj = d + 2*ncorr*j;
+          for (unsigned int k=0; k<2*ncorr; k+=2) {
+            const double dr = dj[k];
+            const double di = dj[k+1];
+            dj[k]   = dr*pr - di*pi;
+            dj[k+1] = dr*pi + di*pr;
+          }
+        }
+      }
+    }
+
+  } //# end namespace
+}
@@ -0,0 +1,103 @@
+//# Phasors.h: Compute and apply phase rotations along a frequency axis
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_PHASORS_H
+#define DPPP_PHASORS_H
+
+// @file
+// @brief Compute and apply phase rotations along a frequency axis
+
+#include <casacore/casa/BasicSL/Complex.h>
+
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    // @ingroup NDPPP
+
+    // This class computes the phasors exp(i*phase*x[j]) for an axis x
+    // (usually 2*pi*freq/c or freq/c) and a phase that varies per baseline
+    // or station. It is used by PhaseShift and Simulator, and can be used by
+    // others needing phase rotations of (e.g. UVWCalculator) uvw coordinates.
+    //
+    // If the axis is regularly spaced (within a relative tolerance), the
+    // phasors are computed with the recurrence p[j+1] = p[j] * exp(i*phase*dx)
+    // instead of a sin and cos per value. To avoid that rounding errors
+    // accumulate, the recurrence is restarted with an exactly computed
+    // phasor every chunkSize values. Irregular axes always use the exact
+    // computation.
+
+    class PhasorAxis
+    {
+    public:
+      // Number of values computed by recurrence after an exact phasor.
+      static const size_t chunkSize = 64;
+
+      PhasorAxis();
+
+      // Set the axis values. It tests if they are regularly spaced.
+      explicit PhasorAxis (const std::vector<double>& values);
+
+      // Get the number of axis values.
+      size_t size() const
+        { return itsValues.size(); }
+
+      // Tell if the axis is regularly spaced, thus if the recurrence is used.
+      bool isRegular() const
+        { return itsRegular; }
+
+      // Get the axis values and the step between them (0 if irregular).
+      const std::vector<double>& values() const
+        { return itsValues; }
+      double step() const
+        { return itsRegular ? itsStep : 0.; }
+
+      // Fill phasors[j] = exp(i*phase*x[j]) for all values of the axis.
+      void fill (double phase, casacore::DComplex* phasors) const;
+
+      // Multiply the ncorr data values per axis value by its phasor
+      // exp(i*phase*x[j]). The multiplication is done in double precision.
+      // The phasors are computed and applied per chunk, so they stay in
+      // the cache. If phasors is not null, the phasors are stored in it.
+      void apply (double phase, unsigned int ncorr, casacore::Complex* data,
+                  casacore::DComplex* phasors=0) const;
+
+      // Multiply the ncorr data values per phasor by the phasor.
+      static void applyPhasors (const casacore::DComplex* phasors, size_t n,
+                                unsigned int ncorr, casacore::Complex* data);
+
+    private:
+      // Fill the phasors for axis values [start,end) which must be part of
+      // a single chunk.
+      void fillChunk (double phase, size_t start, size_t end,
+                      casacore::DComplex* phasors) const;
+
+      std::vector<double> itsValues;
+      double              itsStart;
+      double              itsStep;
+      bool                itsRegular;
+    };
+
+  } //# end namespace
+}
+
+#endif
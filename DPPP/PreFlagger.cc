@@ -538,35 +538,32 @@ namespace DP3 {
         return &itsFlags;
       }
       // Convert each baseline flag to a flag per correlation/channel.
+      // If channels are given, only those are flagged.
       bool* flagPtr = itsFlags.data();
       for (uint i=0; i<itsMatchBL.size(); ++i) {
         if (itsMatchBL[i]) {
-          std::fill (flagPtr, flagPtr+nr, itsMatchBL[i]);
+          if (itsChannels.empty()) {
+            std::fill (flagPtr, flagPtr+nr, true);
+          } else {
+            std::copy (itsChanFlags.cbegin(), itsChanFlags.cend(), flagPtr);
+          }
         }
         flagPtr += nr;
       }
-      // Flag on channel if necessary.
-      if (! itsChannels.empty()) {
-        flagChannels();
-      }
       // Flag on amplitude, phase or real/imaginary if necessary.
-      if (itsFlagOnAmpl) {
-        flagAmpl (amplitude(out.getData()));
-      }
-      if (itsFlagOnReal) {
-        flagReal (out.getData());
-      }
-      if (itsFlagOnImag) {
-        flagImag (out.getData());
-      }
-      if (itsFlagOnPhase) {
-        flagPhase (out.getData());
+      // It clears itsMatchBL for baselines without flags left, so the
+      // children can skip them. Stop if no flags are left at all.
+      if ((itsFlagOnAmpl || itsFlagOnPhase || itsFlagOnReal || itsFlagOnImag)
+          &&  !flagValues (out.getData())) {
+        return &itsFlags;
       }
       // Evaluate the PSet expression.
       // The expression is in RPN notation. A stack of array pointers is used
       // to keep track of intermediate results. The arrays (in the PSet objects)
       // are reused to AND or OR subexpressions. This can be done harmlessly
       // and saves the creation of too many arrays.
+      // The flags of this PSet are false for baselines not in itsMatchBL,
+      // so the children's flags only need to be combined for the others.
       if (! itsPSets.empty()) {
         std::stack<Cube<bool>*> results;
         for (vector<int>::const_iterator oper = itsRpn.begin();
@@ -575,30 +572,17 @@ namespace DP3 {
             results.push (itsPSets[*oper]->process (in, out, timeSlot,
                                                     itsMatchBL, timer));
           } else if (*oper == OpNot) {
-            Cube<bool>* left = results.top();
-            // No ||= operator exists, so use the transform function.
-            transformInPlace (left->cbegin(), left->cend(),
-                              std::logical_not<bool>());
+            combine (*results.top(), 0, OpNot);
           } else {
             assert (*oper==OpOr ||  *oper==OpAnd);
             Cube<bool>* right = results.top();
             results.pop();
-            Cube<bool>* left = results.top();
-            // No ||= operator exists, so use the transform function.
-            if (*oper == OpOr) {
-              transformInPlace (left->cbegin(), left->cend(),
-                                right->cbegin(), std::logical_or<bool>());
-            } else {
-              transformInPlace (left->cbegin(), left->cend(),
-                                right->cbegin(), std::logical_and<bool>());
-            }
+            combine (*results.top(), right, *oper);
           }
         }
         // Finally AND the children's flags with the flags of this pset.
         assert (results.size() == 1);
-        Cube<bool>* mflags = results.top();
-        transformInPlace (itsFlags.cbegin(), itsFlags.cend(),
-                          mflags->cbegin(), std::logical_and<bool>());
+        combine (itsFlags, results.top(), OpAnd);
       }
       return &itsFlags;
     }
@@ -761,91 +745,64 @@ namespace DP3 {
       }
     }
 
-    void PreFlagger::PSet::flagAmpl (const Cube<float>& values)
+    bool PreFlagger::PSet::flagValues (const Cube<Complex>& values)
     {
       const IPosition& shape = values.shape();
       uint nrcorr = shape[0];
-      uint nr = shape[1] * shape[2];
-      const float* valPtr = values.data();
-      bool* flagPtr = itsFlags.data();
-      for (uint i=0; i<nr; ++i) {
-        bool flag = false;
-        for (uint j=0; j<nrcorr; ++j) {
-          if (valPtr[j] < itsAmplMin[j]  ||  valPtr[j] > itsAmplMax[j]) {
-            flag = true;
-            break;
-          }
-        }
-        if (!flag) {
-          for (uint j=0; j<nrcorr; ++j) {
-            flagPtr[j] = false;
+      uint nrchan = shape[1];
+      bool match = false;
+      for (uint i=0; i<itsMatchBL.size(); ++i) {
+        if (itsMatchBL[i]) {
+          const Complex* valPtr = values.data() + i*nrchan*nrcorr;
+          bool* flagPtr = itsFlags.data() + i*nrchan*nrcorr;
+          bool matchBL = false;
+          for (uint j=0; j<nrchan; ++j) {
+            // Only data points still flagged need to be tested.
+            if (std::find (flagPtr, flagPtr+nrcorr, true) != flagPtr+nrcorr) {
+              if (testValues (valPtr, nrcorr)) {
+                matchBL = true;
+              } else {
+                std::fill (flagPtr, flagPtr+nrcorr, false);
+              }
+            }
+            valPtr  += nrcorr;
+            flagPtr += nrcorr;
           }
+          itsMatchBL[i] = matchBL;
+          match = match || matchBL;
         }
-        valPtr  += nrcorr;
-        flagPtr += nrcorr;
       }
+      return match;
     }
 
-    void PreFlagger::PSet::flagPhase (const Cube<Complex>& values)
+    bool PreFlagger::PSet::testValues (const Complex* valPtr,
+                                       uint nrcorr) const
     {
-      const IPosition& shape = values.shape();
-      uint nrcorr = shape[0];
-      uint nr = shape[1] * shape[2];
-      const Complex* valPtr = values.data();
-      bool* flagPtr = itsFlags.data();
-      for (uint i=0; i<nr; ++i) {
+      // For each criterion one of the correlations has to be outside the
+      // range. Stop as soon as a criterion fails.
+      if (itsFlagOnAmpl) {
         bool flag = false;
         for (uint j=0; j<nrcorr; ++j) {
-          float phase = arg(valPtr[j]);
-          if (phase < itsPhaseMin[j]  ||  phase > itsPhaseMax[j]) {
+          float ampl = abs(valPtr[j]);
+          if (ampl < itsAmplMin[j]  ||  ampl > itsAmplMax[j]) {
             flag = true;
             break;
           }
         }
-        if (!flag) {
-          for (uint j=0; j<nrcorr; ++j) {
-            flagPtr[j] = false;
-          }
-        }
-        valPtr  += nrcorr;
-        flagPtr += nrcorr;
+        if (!flag) return false;
       }
-    }
-
-    void PreFlagger::PSet::flagReal (const Cube<Complex>& values)
-    {
-      const IPosition& shape = values.shape();
-      uint nrcorr = shape[0];
-      uint nr = shape[1] * shape[2];
-      const Complex* valPtr = values.data();
-      bool* flagPtr = itsFlags.data();
-      for (uint i=0; i<nr; ++i) {
+      if (itsFlagOnReal) {
         bool flag = false;
         for (uint j=0; j<nrcorr; ++j) {
           if (valPtr[j].real() < itsRealMin[j]  ||
-               valPtr[j].real() > itsRealMax[j]) {
+              valPtr[j].real() > itsRealMax[j]) {
             flag = true;
             break;
           }
         }
-        if (!flag) {
-          for (uint j=0; j<nrcorr; ++j) {
-            flagPtr[j] = false;
-          }
-        }
-        valPtr  += nrcorr;
-        flagPtr += nrcorr;
+        if (!flag) return false;
       }
-    }
-
-    void PreFlagger::PSet::flagImag (const Cube<Complex>& values)
-    {
-      const IPosition& shape = values.shape();
-      uint nrcorr = shape[0];
-      uint nr = shape[1] * shape[2];
-      const Complex* valPtr = values.data();
-      bool* flagPtr = itsFlags.data();
-      for (uint i=0; i<nr; ++i) {
+      if (itsFlagOnImag) {
         bool flag = false;
         for (uint j=0; j<nrcorr; ++j) {
           if (valPtr[j].imag() < itsImagMin[j]  ||
@@ -854,26 +811,46 @@ namespace DP3 {
             break;
           }
         }
-        if (!flag) {
-          for (uint j=0; j<nrcorr; ++j) {
-            flagPtr[j] = false;
+        if (!flag) return false;
+      }
+      if (itsFlagOnPhase) {
+        bool flag = false;
+        for (uint j=0; j<nrcorr; ++j) {
+          float phase = arg(valPtr[j]);
+          if (phase < itsPhaseMin[j]  ||  phase > itsPhaseMax[j]) {
+            flag = true;
+            break;
           }
         }
-        valPtr  += nrcorr;
-        flagPtr += nrcorr;
+        if (!flag) return false;
       }
+      return true;
     }
 
-    void PreFlagger::PSet::flagChannels()
+    void PreFlagger::PSet::combine (Cube<bool>& left, const Cube<bool>* right,
+                                    int oper) const
     {
-      const IPosition& shape = itsFlags.shape();
-      uint nr   = shape[0] * shape[1];
-      uint nrbl = shape[2];
-      bool* flagPtr = itsFlags.data();
-      for (uint i=0; i<nrbl; ++i) {
-        transformInPlace (flagPtr, flagPtr+nr,
-                          itsChanFlags.cbegin(), std::logical_and<bool>());
-        flagPtr += nr;
+      uint nr = left.shape()[0] * left.shape()[1];
+      for (uint i=0; i<itsMatchBL.size(); ++i) {
+        if (itsMatchBL[i]) {
+          bool* leftPtr = left.data() + i*nr;
+          if (oper == OpNot) {
+            for (uint j=0; j<nr; ++j) {
+              leftPtr[j] = !leftPtr[j];
+            }
+          } else {
+            const bool* rightPtr = right->data() + i*nr;
+            if (oper == OpOr) {
+              for (uint j=0; j<nr; ++j) {
+                leftPtr[j] = leftPtr[j] || rightPtr[j];
+              }
+            } else {
+              for (uint j=0; j<nr; ++j) {
+                leftPtr[j] = leftPtr[j] && rightPtr[j];
+              }
+            }
+          }
+        }
       }
     }
 
@@ -163,18 +163,21 @@ namespace DP3 {
                        uint blnr, int ant,
                        const int* ant1, const int* ant2);
 
-        // Set the flags based on amplitude threshold per correlation.
-        void flagAmpl (const casacore::Cube<float>& amplitudes);
-
-        // Set the flags based on phase threshold per correlation.
-        void flagPhase (const casacore::Cube<casacore::Complex>& data);
-
-        // Set the flags based on real/imaginary threshold per correlation.
-        void flagReal (const casacore::Cube<casacore::Complex>& data);
-        void flagImag (const casacore::Cube<casacore::Complex>& data);
-
-        // Flag the channels given in itsChannels.
-        void flagChannels();
+        // Clear the flags of data points not matching the amplitude, phase,
+        // real and imaginary thresholds per correlation. All criteria are
+        // tested in a single pass over the data of the matching baselines.
+        // itsMatchBL is cleared for baselines without flags left.
+        // It returns false if no flags are left.
+        bool flagValues (const casacore::Cube<casacore::Complex>& data);
+
+        // Test if a data point matches all value criteria, thus if for each
+        // criterion a correlation is outside the range.
+        bool testValues (const casacore::Complex* values, uint nrcorr) const;
+
+        // Apply the RPN operator to the flags of the baselines in itsMatchBL.
+        // right is not used for OpNot.
+        void combine (casacore::Cube<bool>& left,
+                      const casacore::Cube<bool>* right, int oper) const;
 
         // Convert a string of (date)time ranges to double. Each range
         // must be given with .. or +-.
@@ -28,7 +28,6 @@
 #include "../Common/ParameterSet.h"
 #include "../Common/ThreadPool.h"
 #include "../Common/Timer.h"
-#include "../Common/OpenMP.h"
 #include "../Common/StreamUtil.h"
 
 #include "../ParmDB/ParmDBMeta.h"
@@ -55,6 +54,7 @@
 #include <casacore/measures/Measures/MeasConvert.h>
 #include <casacore/tables/Tables/RefRows.h>
 
+#include <algorithm>
 #include <stddef.h>
 #include <string>
 #include <sstream>
@@ -71,8 +71,7 @@ namespace DP3 {
 
     Predict::Predict (DPInput* input,
                       const ParameterSet& parset,
-                      const string& prefix) :
-      itsThreadPool(nullptr)
+                      const string& prefix)
     {
       init(input, parset, prefix, parset.getStringVector(prefix + "sources",
                                                          vector<string>()));
@@ -81,8 +80,7 @@ namespace DP3 {
     Predict::Predict (DPInput* input,
                       const ParameterSet& parset,
                       const string& prefix,
-                      const vector<string>& sourcePatterns) :
-      itsThreadPool(nullptr)
+                      const vector<string>& sourcePatterns)
     {
       init(input, parset, prefix, sourcePatterns);
     }
@@ -98,6 +96,7 @@ namespace DP3 {
       itsApplyBeam = parset.getBool (prefix + "usebeammodel", false);
 #endif
       itsDebugLevel = parset.getInt (prefix + "debuglevel", 0);
+      itsSinglePrecision = parset.getBool (prefix + "singleprecision", false);
       itsPatchList = vector<Patch::ConstPtr> ();
 
       assert(File(itsSourceDBName).exists());
@@ -114,6 +113,8 @@ namespace DP3 {
 #ifdef HAVE_LOFAR_BEAM
       if (itsApplyBeam) {
         itsUseChannelFreq=parset.getBool (prefix + "usechannelfreq", true);
+        itsBeamUpdateTime=parset.getDouble (prefix + "beamupdatetime", 0.);
+        itsBeamUpdateFreq=parset.getDouble (prefix + "beamupdatefreq", 0.);
         itsOneBeamPerPatch=parset.getBool (prefix + "onebeamperpatch", false);
 
         string mode=boost::to_lower_copy(parset.getString(prefix + "beammode","default"));
@@ -144,7 +145,10 @@ namespace DP3 {
         itsDoApplyCal=false;
       }
 
-      itsSourceList = makeSourceList(itsPatchList);
+      for (const Patch::ConstPtr& patch : itsPatchList) {
+        itsComponents.insert (itsComponents.end(),
+                              patch->begin(), patch->end());
+      }
 
       // Determine whether any sources are polarized. If not, enable Stokes-I-
       // only mode (note that this mode cannot be used with itsApplyBeam)
@@ -204,36 +208,25 @@ namespace DP3 {
       itsUVWSplitIndex = nsetupSplitUVW (info().nantenna(), info().getAnt1(),
                                          info().getAnt2());
 
-      itsModelVis.resize(OpenMP::maxThreads());
-      itsModelVisPatch.resize(OpenMP::maxThreads());
-#ifdef HAVE_LOFAR_BEAM
-      itsBeamValues.resize(OpenMP::maxThreads());
-      itsAntBeamInfo.resize(OpenMP::maxThreads());
-#endif
-      // Create the Measure ITRF conversion info given the array position.
-      // The time and direction are filled in later.
-      itsMeasConverters.resize(OpenMP::maxThreads());
-      itsMeasFrames.resize(OpenMP::maxThreads());
-
-      for (uint thread=0;thread<OpenMP::maxThreads();++thread) {
-        if (itsStokesIOnly) {
-          itsModelVis[thread].resize(1,nCh,nBl);
-        } else {
-          itsModelVis[thread].resize(nCr,nCh,nBl);
-        }
+      // All threads predict into the same buffer (see process).
+      if (itsStokesIOnly) {
+        itsModelVis.resize(1,nCh,nBl);
+      } else {
+        itsModelVis.resize(nCr,nCh,nBl);
+      }
 #ifdef HAVE_LOFAR_BEAM
-        if (itsApplyBeam) {
-          itsModelVisPatch[thread].resize(nCr,nCh,nBl);
-          itsBeamValues[thread].resize(nSt*nCh);
-          itsMeasFrames[thread].set (info().arrayPosCopy());
-          itsMeasFrames[thread].set (MEpoch(MVEpoch(info().startTime()/86400),
-                                            MEpoch::UTC));
-          itsMeasConverters[thread].set (MDirection::J2000,
-                                         MDirection::Ref(MDirection::ITRF, itsMeasFrames[thread]));
+      if (itsApplyBeam) {
+        itsModelVisPatch.resize(nCr,nCh,nBl);
+        itsBeamValues.resize(nSt*nCh);
+        const size_t nThreads = ThreadPool::GetInstance().NThreads();
+        itsAntBeamInfo.resize(nThreads);
+        for (uint thread=0;thread<nThreads;++thread) {
           itsInput->fillBeamInfo (itsAntBeamInfo[thread], info().antennaNames());
         }
-#endif
+        itsBeamCache = BeamCache::get (info(), info().antennaNames(),
+                                       itsBeamUpdateTime, itsBeamUpdateFreq);
       }
+#endif
 
       if (itsDoApplyCal) {
         info()=itsApplyCalStep.setInfo(info());
@@ -259,8 +252,9 @@ namespace DP3 {
       os << "Predict " << itsName << endl;
       os << "  sourcedb:           " << itsSourceDBName << endl;
       os << "   number of patches: " << itsPatchList.size() << endl;
-      os << "   number of sources: " << itsSourceList.size() << endl;
+      os << "   number of sources: " << itsComponents.size() << endl;
       os << "   all unpolarized:   " << boolalpha << itsStokesIOnly << endl;
+      os << "  single precision:   " << boolalpha << itsSinglePrecision << endl;
 #ifdef HAVE_LOFAR_BEAM
       os << "  apply beam:         " << boolalpha << itsApplyBeam << endl;
       if (itsApplyBeam) {
@@ -273,10 +267,12 @@ namespace DP3 {
         os << endl;
         os << "   use channelfreq:   " << boolalpha << itsUseChannelFreq << endl;
         os << "   one beam per patch:" << boolalpha << itsOneBeamPerPatch << endl;
+        os << "   beam update time:  " << itsBeamUpdateTime << " s" << endl;
+        os << "   beam update freq:  " << itsBeamUpdateFreq << " Hz" << endl;
       }
 #endif
       os << "  operation:          "<<itsOperation << endl;
-      os << "  threads:            "<<OpenMP::maxThreads()<<endl;
+      os << "  threads:            "<<ThreadPool::GetInstance().NThreads()<<endl;
       if (itsDoApplyCal) {
         itsApplyCalStep.show(os);
       }
@@ -286,19 +282,27 @@ namespace DP3 {
     {
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " Predict " << itsName << endl;
+      os << " Predict " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(itsTimer.getElapsed()));
+      os << endl;
     }
 
     bool Predict::process (const DPBuffer& bufin)
     {
       itsTimer.start();
-      itsTempBuffer.copy (bufin);
+      // The data are overwritten by the prediction, so do not copy them.
+      // The temp buffer keeps its own data array.
+      DPBuffer input;
+      input.referenceFilled (bufin);
+      input.setData (Cube<Complex>());
+      itsTempBuffer.copy (input);
+      itsTempBuffer.getData().resize (info().ncorr(), info().nchan(),
+                                      info().nbaselines());
       itsInput->fetchUVW(bufin, itsTempBuffer, itsTimer);
       itsInput->fetchWeights(bufin, itsTempBuffer, itsTimer);
 
       // Determine the various sizes.
       //const size_t nDr = itsPatchList.size();
-      const size_t nSt = info().nantenna();
       const size_t nBl = info().nbaselines();
       const size_t nCh = info().nchan();
       const size_t nCr = info().ncorr();
@@ -308,92 +312,59 @@ namespace DP3 {
 
       nsplitUVW(itsUVWSplitIndex, itsBaselines, itsTempBuffer.getUVW(), itsUVW);
 
-#ifdef HAVE_LOFAR_BEAM
-      double time = itsTempBuffer.getTime();
-      //Set up directions for beam evaluation
-      LOFAR::StationResponse::vector3r_t refdir, tiledir;
-
-      if (itsApplyBeam) {
-        for (uint thread=0;thread<OpenMP::maxThreads();++thread) {
-#pragma omp critical(initialmeasuresconversion)
-          {
-          itsMeasFrames[thread].resetEpoch (MEpoch(MVEpoch(time/86400),
-                                                   MEpoch::UTC));
-          //Do a conversion on all threads, because converters are not
-          //thread safe and apparently need to be used at least once
-          refdir  = dir2Itrf(info().delayCenter(),itsMeasConverters[thread]);
-          tiledir = dir2Itrf(info().tileBeamDir(),itsMeasConverters[thread]);
-          }
-        }
-      }
-#endif
-
-      std::unique_ptr<ThreadPool> localThreadPool;
-      ThreadPool* pool = itsThreadPool;
-      if(pool == nullptr)
-      {
-        // If no ThreadPool was specified, we create a temporary one just
-        // for executation of this part.
-        localThreadPool.reset(new ThreadPool(OpenMP::maxThreads()));
-        pool = localThreadPool.get();
-      }
-      std::vector<Simulator> simulators;
-      simulators.reserve(pool->NThreads());
-      for(size_t thread=0; thread!=pool->NThreads(); ++thread)
+      // The baselines are divided in blocks, one per thread. The station
+      // phasors are computed once per block of sources and shared by the
+      // threads, which add to disjoint parts of the model visibilities.
+      ThreadPool* pool = &ThreadPool::GetInstance();
+      const size_t nBlBlocks = std::min<size_t>(nBl, pool->NThreads());
       {
-        itsModelVis[thread]=dcomplex();
-        itsModelVisPatch[thread]=dcomplex();
-
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
 #ifdef HAVE_LOFAR_BEAM
-        //When applying beam, simulate into patch vector
-        Cube<dcomplex>& simulatedest=(itsApplyBeam ? itsModelVisPatch[thread]
-          : itsModelVis[thread]);
-#else
-        Cube<dcomplex>& simulatedest=itsModelVis[thread];
-#endif
-        simulators.emplace_back(itsPhaseRef, nSt, nBl, nCh, itsBaselines,
-          info().chanFreqs(), itsUVW, simulatedest,
-          itsStokesIOnly);
-      }
-      std::vector<Patch::ConstPtr> curPatches(pool->NThreads());
-      
-      pool->For(0, itsSourceList.size(), [&](size_t iter, size_t thread) {
-        // Keep on predicting, only apply beam when an entire patch is done
-        Patch::ConstPtr& curPatch = curPatches[thread];
-#ifdef HAVE_LOFAR_BEAM
-        if (itsApplyBeam && curPatch!=itsSourceList[iter].second && curPatch!=nullptr) {
-          addBeamToData (curPatch, time, refdir, tiledir, thread, nSamples,
-            itsModelVisPatch[thread].data());
-        }
+        if (itsApplyBeam) {
+          double time = itsTempBuffer.getTime();
+          // The beam is applied per patch. First the beam of all stations is
+          // obtained and the patch is predicted, thereafter the beam is
+          // applied per baseline block.
+          itsModelVis = dcomplex();
+          for (const Patch::ConstPtr& patch : itsPatchList) {
+            MDirection dir (MVDirection(patch->position()[0],
+                                        patch->position()[1]),
+                            MDirection::J2000);
+            itsBeamCache->getBeam (time, dir, info().chanFreqs(),
+                                   itsUseChannelFreq ? 0. : info().refFreq(),
+                                   itsBeamMode, false, itsAntBeamInfo,
+                                   itsBeamValues.data());
+            itsModelVisPatch = dcomplex();
+            simulate (patch->begin(), patch->end(), nBlBlocks,
+                      itsModelVisPatch);
+            pool->For(0, nBlBlocks, [&](size_t blBlock, size_t) {
+              const size_t blStart = blBlock * nBl / nBlBlocks;
+              const size_t blEnd = (blBlock+1) * nBl / nBlBlocks;
+              float* dummyweight = 0;
+              ApplyBeam::applyBeamValues (info(), itsModelVisPatch.data(),
+                                          dummyweight, itsBeamValues,
+                                          blStart, blEnd);
+              const dcomplex* patchData = itsModelVisPatch.data() + blStart*nCh*nCr;
+              const dcomplex* patchEnd = itsModelVisPatch.data() + blEnd*nCh*nCr;
+              dcomplex* data = itsModelVis.data() + blStart*nCh*nCr;
+              std::transform (patchData, patchEnd, data, data,
+                              std::plus<dcomplex>());
+            });
+          }
+        } else
 #endif
-        simulators[thread].simulate(itsSourceList[iter].first);
-        curPatch=itsSourceList[iter].second;
-      });
-#ifdef HAVE_LOFAR_BEAM
-      // Apply beam to the last patch
-      for(size_t thread=0; thread!=pool->NThreads(); ++thread)
-      {
-        if (itsApplyBeam && curPatches[thread]!=nullptr) {
-          addBeamToData (curPatches[thread], time, refdir, tiledir, thread, nSamples,
-            itsModelVisPatch[thread].data());
+        {
+          itsModelVis = dcomplex();
+          simulate (itsComponents.cbegin(), itsComponents.cend(), nBlBlocks,
+                    itsModelVis);
         }
+        pool->For(0, nBlBlocks, [&](size_t blBlock, size_t) {
+          copyModelVis (blBlock * nBl / nBlBlocks,
+                        (blBlock+1) * nBl / nBlBlocks);
+        });
       }
-#endif
 
-      // Add all thread model data to one buffer
-      itsTempBuffer.getData()=Complex();
       Complex* tdata=itsTempBuffer.getData().data();
-      for (uint thread=0;thread<OpenMP::maxThreads();++thread) {
-        if (itsStokesIOnly) {
-          for (uint i=0,j=0;i<nSamples;i+=nCr,j++) {
-            tdata[i] += itsModelVis[thread].data()[j];
-            tdata[i+nCr-1] += itsModelVis[thread].data()[j];
-          }
-        } else {
-          std::transform(tdata, tdata+nSamples, itsModelVis[thread].data(),
-                         tdata, std::plus<dcomplex>());
-        }
-      }
 
       // Call ApplyCal step
       if (itsDoApplyCal) {
@@ -424,44 +395,38 @@ namespace DP3 {
       return false;
     }
 
-#ifdef HAVE_LOFAR_BEAM
-    LOFAR::StationResponse::vector3r_t Predict::dir2Itrf (const MDirection& dir,
-                                      MDirection::Convert& measConverter) {
-      const MDirection& itrfDir = measConverter(dir);
-      const Vector<Double>& itrf = itrfDir.getValue().getValue();
-      LOFAR::StationResponse::vector3r_t vec;
-      vec[0] = itrf[0];
-      vec[1] = itrf[1];
-      vec[2] = itrf[2];
-      return vec;
+    void Predict::simulate (Patch::const_iterator first,
+                            Patch::const_iterator last,
+                            size_t nBlBlocks, Cube<dcomplex>& dest)
+    {
+      Simulator simulator (itsPhaseRef, info().nantenna(),
+                           info().nbaselines(), info().nchan(),
+                           Vector<Baseline>(itsBaselines), info().chanFreqs(),
+                           itsUVW, dest, itsStokesIOnly, itsSinglePrecision);
+      simulator.setNBaselineBlocks (nBlBlocks);
+      simulator.simulate (first, last);
     }
 
-    void Predict::addBeamToData (Patch::ConstPtr patch, double time,
-                                 const LOFAR::StationResponse::vector3r_t& refdir,
-                                 const LOFAR::StationResponse::vector3r_t& tiledir,
-                                 uint thread, uint nSamples, dcomplex* data0) {
-      //Apply beam for a patch, add result to itsModelVis
-      MDirection dir (MVDirection(patch->position()[0],
-                                  patch->position()[1]),
-                      MDirection::J2000);
-      LOFAR::StationResponse::vector3r_t srcdir = dir2Itrf(dir,itsMeasConverters[thread]);
-
-      float* dummyweight = 0;
-
-      ApplyBeam::applyBeam(info(), time, data0, dummyweight, srcdir, refdir,
-                           tiledir, itsAntBeamInfo[thread],
-                           itsBeamValues[thread], itsUseChannelFreq, false,
-                           itsBeamMode, false);
-
-      //Add temporary buffer to itsModelVis
-      std::transform(itsModelVis[thread].data(),
-                     itsModelVis[thread].data()+nSamples,
-                     data0,
-                     itsModelVis[thread].data(), std::plus<dcomplex>());
-      //threadoutput<<"thread "<<thread<<" has "<<itsModelVis[thread]<<endl;
-      itsModelVisPatch[thread]=dcomplex();
+    void Predict::copyModelVis (size_t blStart, size_t blEnd)
+    {
+      const size_t nCr = info().ncorr();
+      const size_t nCh = info().nchan();
+      Complex* tdata = itsTempBuffer.getData().data() + blStart*nCh*nCr;
+      const dcomplex* mdata = itsModelVis.data();
+      if (itsStokesIOnly) {
+        // Only XX and YY are filled.
+        for (size_t i=blStart*nCh; i<blEnd*nCh; ++i) {
+          tdata[0] = mdata[i];
+          for (size_t cr=1; cr<nCr-1; ++cr) {
+            tdata[cr] = Complex();
+          }
+          tdata[nCr-1] = mdata[i];
+          tdata += nCr;
+        }
+      } else {
+        std::copy (mdata + blStart*nCh*nCr, mdata + blEnd*nCh*nCr, tdata);
+      }
     }
-#endif
 
     void Predict::finish()
     {
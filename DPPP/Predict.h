@@ -40,6 +40,8 @@
 #include <StationResponse/Types.h>
 #endif
 
+#include "../Common/ThreadPool.h"
+
 #include <casacore/casa/Arrays/Cube.h>
 #include <casacore/casa/Quanta/MVEpoch.h>
 #include <casacore/measures/Measures/MEpoch.h>
@@ -49,7 +51,6 @@
 namespace DP3 {
 
   class ParameterSet;
-  class ThreadPool;
 
   namespace DPPP {
     // @ingroup NDPPP
@@ -83,8 +84,6 @@ namespace DP3 {
       // Set the operation type
       void setOperation(const std::string& type);
 
-      void setThreadPool(ThreadPool& pool) { itsThreadPool = &pool; }
-
       Predict();
 
       virtual ~Predict();
@@ -113,14 +112,15 @@ namespace DP3 {
       std::pair<double, double> getFirstDirection() const;
 
     private:
-#ifdef HAVE_LOFAR_BEAM
-      LOFAR::StationResponse::vector3r_t dir2Itrf (const casacore::MDirection& dir,
-                                     casacore::MDirection::Convert& measConverter);
-      void addBeamToData (Patch::ConstPtr patch, double time,
-                                   const LOFAR::StationResponse::vector3r_t& refdir,
-                                   const LOFAR::StationResponse::vector3r_t& tiledir,
-                                   uint thread, uint nSamples, dcomplex* data0);
-#endif
+      // Simulate the components in [first,last) and add the result to dest.
+      // The baselines are summed in nBlBlocks parallel blocks.
+      void simulate (Patch::const_iterator first, Patch::const_iterator last,
+                     size_t nBlBlocks, casacore::Cube<dcomplex>& dest);
+
+      // Copy the model visibilities of the baselines [blStart,blEnd) to
+      // the output buffer.
+      void copyModelVis (size_t blStart, size_t blEnd);
+
       //# Data members.
       DPInput*         itsInput;
       string           itsName;
@@ -133,6 +133,7 @@ namespace DP3 {
       bool             itsOneBeamPerPatch;
 #endif
       bool             itsStokesIOnly;
+      bool             itsSinglePrecision;
       Position         itsPhaseRef;
 
       bool             itsDoApplyCal;
@@ -152,24 +153,28 @@ namespace DP3 {
 
 #ifdef HAVE_LOFAR_BEAM
       // The info needed to calculate the station beams.
+      // The station objects are not thread safe, so each thread has its own.
       vector<vector<LOFAR::StationResponse::Station::Ptr> > itsAntBeamInfo;
-      vector<vector<LOFAR::StationResponse::matrix22c_t> >  itsBeamValues;
+      vector<LOFAR::StationResponse::matrix22c_t>    itsBeamValues; //# [nst,nchan]
       ApplyBeam::BeamMode                            itsBeamMode;
+      double                                         itsBeamUpdateTime;
+      double                                         itsBeamUpdateFreq;
+      BeamCache::ShPtr                               itsBeamCache;
 #endif
-      vector<casacore::MeasFrame>                    itsMeasFrames;
-      vector<casacore::MDirection::Convert>          itsMeasConverters;
 
       std::string itsDirectionsStr; // Definition of patches, to pass to applycal
       vector<Patch::ConstPtr> itsPatchList;
-      vector<Source> itsSourceList;
+      // All components of all patches.
+      vector<ModelComponent::ConstPtr> itsComponents;
 
-      vector<casacore::Cube<dcomplex> > itsModelVis; // one for every thread
-      vector<casacore::Cube<dcomplex> > itsModelVisPatch;
+      // The threads predict disjoint blocks of baselines, so they share
+      // the model visibilities.
+      casacore::Cube<dcomplex> itsModelVis;
+      casacore::Cube<dcomplex> itsModelVisPatch; //# patch before beam
 
       NSTimer          itsTimer;
       NSTimer          itsTimerPredict;
-
-      ThreadPool* itsThreadPool;
+      ThreadPool::CoreUsage itsCoreUsage;
     };
 
   } //# end namespace
@@ -0,0 +1,167 @@
+//# QueueStep.cc: DPPP step decoupling two steps by a bounded queue and thread
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include "QueueStep.h"
+#include "FlagCounter.h"
+#include "Exceptions.h"
+
+#include "../Common/OpenMP.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace DP3 {
+  namespace DPPP {
+
+    QueueStep::QueueStep (uint queueSize, const string& name, uint maxBatch)
+      : itsName        (name),
+        itsBuffers     (queueSize),
+        itsMaxBatch    (std::max (maxBatch, 1u)),
+        itsFreeBuffers (queueSize),
+        itsFullBuffers (queueSize),
+        itsNThreads    (OpenMP::maxThreads())
+    {
+      if (queueSize == 0) {
+        throw Exception("Queue size of pipeline queue " + name +
+                        " must be positive");
+      }
+      for (size_t i=0; i<queueSize; ++i) {
+        itsFreeBuffers.write (i);
+      }
+    }
+
+    QueueStep::~QueueStep()
+    {
+      // Only happens if the pipeline was aborted before finish.
+      stop();
+    }
+
+    void QueueStep::updateInfo (const DPInfo& infoIn)
+    {
+      info() = infoIn;
+      if (! itsThread.joinable()) {
+        itsThread = std::thread (&QueueStep::run, this);
+      }
+    }
+
+    void QueueStep::show (std::ostream& os) const
+    {
+      os << "QueueStep " << itsName << std::endl;
+      os << "  queue size:     " << itsBuffers.size() << std::endl;
+      if (itsMaxBatch > 1) {
+        os << "  max batch:      " << itsMaxBatch << std::endl;
+      }
+    }
+
+    void QueueStep::showTimings (std::ostream& os, double duration) const
+    {
+      os << "  ";
+      FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
+      os << " QueueStep " << itsName << " (waiting for next steps)"
+         << std::endl;
+    }
+
+    bool QueueStep::process (const DPBuffer& buf)
+    {
+      checkException();
+      size_t index;
+      {
+        NSTimer::StartStop sstime(itsTimer);
+        if (! itsFreeBuffers.read (index)) {
+          checkException();
+          throw Exception("Pipeline queue " + itsName + " has been closed");
+        }
+      }
+      // The previous step may reuse its buffer, so make a deep copy.
+      itsBuffers[index].copy (buf);
+      itsFullBuffers.write (index);
+      return true;
+    }
+
+    void QueueStep::finish()
+    {
+      stop();
+      checkException();
+      getNextStep()->finish();
+    }
+
+    void QueueStep::stop()
+    {
+      if (itsThread.joinable()) {
+        itsFullBuffers.write_end();
+        itsThread.join();
+      }
+    }
+
+    void QueueStep::checkException()
+    {
+      std::lock_guard<std::mutex> lock(itsMutex);
+      if (itsException) {
+        std::exception_ptr exc = itsException;
+        itsException = std::exception_ptr();
+        std::rethrow_exception (exc);
+      }
+    }
+
+    void QueueStep::run()
+    {
+      // The number of OpenMP threads is a per-thread setting, so copy it
+      // from the thread that constructed the pipeline.
+      OpenMP::setNumThreads (itsNThreads);
+      std::vector<size_t> indices;
+      std::vector<DPBuffer> batch;
+      size_t index;
+      bool failed = false;
+      while (itsFullBuffers.read (index)) {
+        indices.assign (1, index);
+        // Take the buffers already queued as well. Only this thread reads
+        // from the lane, so the read does not block.
+        while (indices.size() < itsMaxBatch  &&  !itsFullBuffers.empty()  &&
+               itsFullBuffers.read (index)) {
+          indices.push_back (index);
+        }
+        // After a failure the queue is still drained to avoid that
+        // the previous step blocks forever.
+        if (! failed) {
+          try {
+            if (indices.size() == 1) {
+              getNextStep()->process (itsBuffers[indices[0]]);
+            } else {
+              batch.clear();
+              for (size_t i : indices) {
+                batch.push_back (itsBuffers[i]);
+              }
+              getNextStep()->processBatch (batch);
+            }
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(itsMutex);
+            itsException = std::current_exception();
+            failed = true;
+          }
+        }
+        for (size_t i : indices) {
+          itsFreeBuffers.write (i);
+        }
+      }
+    }
+
+  } //# end namespace
+}
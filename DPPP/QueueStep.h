@@ -0,0 +1,129 @@
+//# QueueStep.h: DPPP step decoupling two steps by a bounded queue and thread
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_QUEUESTEP_H
+#define DPPP_QUEUESTEP_H
+
+// @file
+// @brief DPPP step decoupling two steps by a bounded queue and thread
+
+#include "DPStep.h"
+#include "DPBuffer.h"
+
+#include "../Common/Lane.h"
+
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    // @ingroup NDPPP
+
+    // This class is a DPStep that runs the rest of the pipeline (its next
+    // steps) in a separate thread. It is inserted by DPRun between two steps
+    // when pipelined execution is enabled (parset key <src>pipelined</src>).
+    //
+    // The buffers given to process are deep copied into a fixed set of
+    // preallocated buffers which are handed to the worker thread through an
+    // ao::lane. When all buffers are in use, process blocks until the next
+    // step has finished one of them (backpressure), so memory use is bounded
+    // by the queue size.
+    //
+    // The next steps can still use the DPInput fetch functions, because
+    // MSReader guards all access to the MS with a mutex.
+    //
+    // finish waits until the worker thread has processed all queued buffers
+    // and then calls finish of the next step in the calling thread.
+    // Thus finish and addToMS are still executed in pipeline order.
+    // An exception thrown in the worker thread is rethrown in the calling
+    // thread at the next call to process or finish.
+    //
+    // If maxBatch > 1, the worker thread gives all queued buffers (up to
+    // maxBatch) at once to processBatch of the next step. It is used for
+    // the write-behind of an output step, so the writer can combine the
+    // writes of consecutive time slots.
+    //
+    // The worker thread uses the OpenMP thread count set by setNThreads
+    // (default that of the constructing thread). DPRun divides the OpenMP
+    // threads over the threads of the pipeline. The worker thread itself
+    // and the ThreadPool are not part of that division, so numthreads is
+    // not a hard limit on the number of threads used.
+
+    class QueueStep: public DPStep
+    {
+    public:
+      // Create the step with the given number of buffers in the queue.
+      // The name is only used in show and showTimings.
+      QueueStep (uint queueSize, const string& name, uint maxBatch=1);
+
+      virtual ~QueueStep();
+
+      // Set the number of OpenMP threads of the worker thread.
+      // It must be called before updateInfo starts the thread.
+      void setNThreads (uint nThreads)
+        { itsNThreads = nThreads; }
+
+      // Put a copy of the buffer in the queue.
+      // It blocks while the queue is full.
+      virtual bool process (const DPBuffer&);
+
+      // Wait until all queued buffers are processed and finish the next step.
+      virtual void finish();
+
+      // Update the general info and start the worker thread.
+      virtual void updateInfo (const DPInfo&);
+
+      // Show the step parameters.
+      virtual void show (std::ostream&) const;
+
+      // Show the time spent waiting for a free buffer.
+      virtual void showTimings (std::ostream&, double duration) const;
+
+    private:
+      // The function executed by the worker thread.
+      void run();
+
+      // Stop the worker thread after all queued buffers are processed.
+      void stop();
+
+      // Rethrow an exception caught in the worker thread.
+      void checkException();
+
+      //# Data members.
+      string                 itsName;
+      std::vector<DPBuffer>  itsBuffers;
+      uint                   itsMaxBatch;
+      ao::lane<size_t>       itsFreeBuffers;  //# indices of free buffers
+      ao::lane<size_t>       itsFullBuffers;  //# indices of queued buffers
+      std::thread            itsThread;
+      uint                   itsNThreads;     //# OpenMP threads for worker
+      std::exception_ptr     itsException;
+      std::mutex             itsMutex;        //# guards itsException
+      NSTimer                itsTimer;        //# time waiting for free buffer
+    };
+
+  } //# end namespace
+}
+
+#endif
@@ -25,8 +25,13 @@
 #include "GaussianSource.h"
 #include "PointSource.h"
 
+#include "../Common/ThreadPool.h"
+
 #include <casacore/casa/BasicSL/Constants.h>
 
+#include <algorithm>
+#include <cassert>
+
 #include "../Common/StreamUtil.h" ///
 
 namespace DP3
@@ -48,121 +53,97 @@ namespace
 void radec2lmn(const Position &reference, const Position &position,
                double* lmn);
 
-void phases(size_t nStation, size_t nChannel, const double* lmn,
-            const casacore::Matrix<double>& uvw, const casacore::Vector<double>& freq,
-            Simulator::Matrix<dcomplex>& shift);
-
-void spectrum(const PointSource &component, size_t nChannel,
-              const casacore::Vector<double>& freq,
-              Simulator::Matrix<dcomplex>& spectrum, bool stokesIOnly);
+// Add the visibilities of the components in a block to the nCorr
+// correlations of a channel, i.e. sum over k of (wr[k], wi[k]) times the
+// spectrum (I+Q, U+iV, U-iV, I-Q) or I.
+template <typename T>
+void addVisibilities(size_t nK, const T* wr, const T* wi, const T* spectrum,
+                     size_t blockSize, bool stokesIOnly, dcomplex* buffer);
 } // Unnamed namespace.
 
+const size_t Simulator::blockSize;
+const size_t Simulator::irregularChunkSize;
+
 Simulator::Simulator(const Position &reference, size_t nStation,
     size_t nBaseline, size_t nChannel, const casacore::Vector<Baseline>& baselines,
     const casacore::Vector<double>& freq, const casacore::Matrix<double>& uvw,
-    casacore::Cube<dcomplex>& buffer, bool stokesIOnly)
+    casacore::Cube<dcomplex>& buffer, bool stokesIOnly, bool singlePrecision)
     :   itsReference(reference),
         itsNStation(nStation),
         itsNBaseline(nBaseline),
         itsNChannel(nChannel),
+        itsNBlBlocks(1),
         itsStokesIOnly(stokesIOnly),
+        itsSinglePrecision(singlePrecision),
         itsBaselines(baselines),
         itsFreq(freq),
         itsUVW(uvw),
-        itsBuffer(buffer),
-        itsShiftBuffer(),
-        itsSpectrumBuffer()
+        itsBuffer(buffer)
+{
+  // The phase shifts are computed for freq/c.
+  std::vector<double> freqC(nChannel);
+  for(size_t ch = 0; ch < nChannel; ++ch) {
+    freqC[ch] = freq[ch] / casacore::C::c;
+  }
+  itsFreqAxis = PhasorAxis(freqC);
+  itsPointBlock.init(false, nChannel, stokesIOnly);
+  itsGaussianBlock.init(true, nChannel, stokesIOnly);
+  itsStationPhase.resize(nStation*blockSize);
+  // The exact station phasors are kept for all chunks (regular channels)
+  // or all channels, so they can be shared by all baseline blocks.
+  const size_t nExact = itsFreqAxis.isRegular() ?
+    (nChannel + PhasorAxis::chunkSize - 1) / PhasorAxis::chunkSize : nChannel;
+  itsStationPhasorR.resize(nExact*nStation*blockSize);
+  itsStationPhasorI.resize(nExact*nStation*blockSize);
+  if (itsFreqAxis.isRegular()) {
+    itsStationRotR.resize(nStation*blockSize);
+    itsStationRotI.resize(nStation*blockSize);
+  }
+}
+
+void Simulator::ComponentBlock::init(bool isGaussian, size_t nChannel,
+                                     bool stokesIOnly)
 {
-  itsShiftBuffer.resize(nChannel,nStation);
-  if (stokesIOnly) {
-    itsSpectrumBuffer.resize(1,nChannel);
-  } else {
-    itsSpectrumBuffer.resize(4,nChannel);
+  n = 0;
+  gaussian = isGaussian;
+  lmn.resize(3*blockSize);
+  if (gaussian) {
+    gauss.resize(4*blockSize);
   }
+  spectrum.resize(nChannel*(stokesIOnly ? 1:4)*blockSize);
 }
 
 void Simulator::simulate(const ModelComponent::ConstPtr &component)
 {
     component->accept(*this);
+    flushBlock(itsPointBlock);
+    flushBlock(itsGaussianBlock);
 }
 
+void Simulator::simulate
+  (std::vector<ModelComponent::ConstPtr>::const_iterator first,
+   std::vector<ModelComponent::ConstPtr>::const_iterator last)
+{
+    for(; first != last; ++first) {
+        (*first)->accept(*this);
+    }
+    flushBlock(itsPointBlock);
+    flushBlock(itsGaussianBlock);
+}
 
-void Simulator::visit(const PointSource &component) {
-  // Compute LMN coordinates.
-  double lmn[3];
-  radec2lmn(itsReference, component.position(), lmn);
-
-  // Compute station phase shifts.
-  phases(itsNStation, itsNChannel, lmn, itsUVW, itsFreq, itsShiftBuffer);
-
-  // Compute component spectrum.
-  spectrum(component, itsNChannel, itsFreq, itsSpectrumBuffer, itsStokesIOnly);
-
-  // Set number of correlations
-  int nCorr = 4;
-  if (itsStokesIOnly) {
-    nCorr = 1;
-  }
-
-  // Compute visibilities.
-  // The following loop can be parallelized, but because there is already
-  // a parallelization over sources, this is not necessary.
-  // It used to be parallelized with a #pragma omp parallel for, but since
-  // the outer loop was also parallelized with omp, this had no effect
-  // (since omp by default doesn't parallelize nested loops). After the change
-  // to a ThreadPool, this would parallize each separate source, which started
-  // hundreds of threads on many-core machines.
-  for(size_t bl = 0; bl < itsNBaseline; ++bl) {
-    dcomplex* buffer=&itsBuffer(0,0,bl);
-    const size_t p = itsBaselines[bl].first;
-    const size_t q = itsBaselines[bl].second;
-
-    if(p == q) {
-      buffer+=itsNChannel*nCorr;
-    } else {
-      const dcomplex *shiftP = &(itsShiftBuffer(0,p));
-      const dcomplex *shiftQ = &(itsShiftBuffer(0,q));
-      const dcomplex *spectrum = itsSpectrumBuffer.data();
-
-      if (itsStokesIOnly) {
-        for (size_t ch = 0; ch < itsNChannel; ++ch)
-        {
-          // Compute baseline phase shift.
-          // Compute visibilities.
-          *buffer++ += (*shiftQ) * conj(*shiftP) * (*spectrum++);
-          ++shiftP;
-          ++shiftQ;
-        } // Channels.
-      } else {
-        for(size_t ch = 0; ch < itsNChannel; ++ch)
-        {
-          // Compute baseline phase shift.
-          const dcomplex blShift = (*shiftQ) * conj(*shiftP);
-          ++shiftP;
-          ++shiftQ;
-
-          // Compute visibilities.
-          *buffer++ += blShift * (*spectrum++);
-          *buffer++ += blShift * (*spectrum++);
-          *buffer++ += blShift * (*spectrum++);
-          *buffer++ += blShift * (*spectrum++);
-        } // Channels.
-      }
+void Simulator::visit(const PointSource &component)
+{
+    addToBlock(itsPointBlock, component);
+    if(itsPointBlock.n == blockSize) {
+        flushBlock(itsPointBlock);
     }
-  } // Baselines.
 }
 
 void Simulator::visit(const GaussianSource &component)
 {
-    // Compute LMN coordinates.
-    double lmn[3];
-    radec2lmn(itsReference, component.position(), lmn);
-
-    // Compute station phase shifts.
-    phases(itsNStation, itsNChannel, lmn, itsUVW, itsFreq, itsShiftBuffer);
-
-    // Compute component spectrum.
-    spectrum(component, itsNChannel, itsFreq, itsSpectrumBuffer, itsStokesIOnly);
+    ComponentBlock& block = itsGaussianBlock;
+    const size_t k = block.n;
+    addToBlock(block, component);
 
     // Convert position angle from North over East to the angle used to
     // rotate the right-handed UV-plane.
@@ -179,79 +160,262 @@ void Simulator::visit(const GaussianSource &component)
     const double uScale = component.majorAxis() * fwhm2sigma;
     const double vScale = component.minorAxis() * fwhm2sigma;
 
-    // Set number of correlations
-    int nCorr = 4;
-    if (itsStokesIOnly) {
-      nCorr = 1;
+    // Rotate (u, v) by the position angle and scale with the major
+    // and minor axis lengths (FWHM in rad):
+    //   uPrime = uScale * (u * cosPhi - v * sinPhi)
+    //   vPrime = vScale * (u * sinPhi + v * cosPhi)
+    block.gauss[k] = uScale * cosPhi;
+    block.gauss[blockSize + k] = uScale * sinPhi;
+    block.gauss[2*blockSize + k] = vScale * sinPhi;
+    block.gauss[3*blockSize + k] = vScale * cosPhi;
+
+    if(block.n == blockSize) {
+        flushBlock(block);
     }
+}
+
+void Simulator::addToBlock(ComponentBlock &block,
+                           const PointSource &component)
+{
+    const size_t k = block.n++;
 
-    for(size_t bl = 0; bl < itsNBaseline; ++bl)
+    // Compute LMN coordinates; n is stored as n-1.
+    double lmn[3];
+    radec2lmn(itsReference, component.position(), lmn);
+    block.lmn[k] = lmn[0];
+    block.lmn[blockSize + k] = lmn[1];
+    block.lmn[2*blockSize + k] = lmn[2] - 1.0;
+
+    // Compute component spectrum.
+    const size_t nStokes = itsStokesIOnly ? 1 : 4;
+    double* spectrum = &block.spectrum[k];
+    for(size_t ch = 0; ch < itsNChannel; ++ch)
     {
-        dcomplex* buffer=&itsBuffer(0,0,bl);
-        const size_t p = itsBaselines[bl].first;
-        const size_t q = itsBaselines[bl].second;
+        Stokes stokes = component.stokes(itsFreq[ch]);
 
-        if(p == q) {
-          buffer+=itsNChannel*nCorr;
+        if (itsStokesIOnly) {
+          spectrum[0] = stokes.I;
         } else {
-            double u = itsUVW(0,q);
-            double v = itsUVW(1,q);
-
-            u -= itsUVW(0,p);
-            v -= itsUVW(1,p);
-
-            // Rotate (u, v) by the position angle and scale with the major
-            // and minor axis lengths (FWHM in rad).
-            const double uPrime = uScale * (u * cosPhi - v * sinPhi);
-            const double vPrime = vScale * (u * sinPhi + v * cosPhi);
-
-            // Compute uPrime^2 + vPrime^2 and pre-multiply with -2.0 * PI^2
-            // / C^2.
-            const double uvPrime = (-2.0 * casacore::C::pi * casacore::C::pi)
-                * (uPrime * uPrime + vPrime * vPrime);
-
-            const dcomplex *shiftP = &(itsShiftBuffer(0,p));
-            const dcomplex *shiftQ = &(itsShiftBuffer(0,q));
-            const dcomplex *spectrum = itsSpectrumBuffer.data();
-
-            if (itsStokesIOnly) {
-                for (size_t ch = 0; ch < itsNChannel; ++ch)
-                {
-                    // Compute baseline phase shift.
-                    dcomplex blShift = (*shiftQ) * conj(*shiftP);
-                    ++shiftP;
-                    ++shiftQ;
-
-                    const double ampl = exp((itsFreq[ch] * itsFreq[ch])
-                        / (casacore::C::c * casacore::C::c) * uvPrime);
-
-                    blShift *= ampl;
-
-                    // Compute visibilities.
-                    *buffer++ += blShift * (*spectrum++);
-                } // Channels.
-            } else {
-                for(size_t ch = 0; ch < itsNChannel; ++ch)
-                {
-                    // Compute baseline phase shift.
-                    dcomplex blShift = (*shiftQ) * conj(*shiftP);
-                    ++shiftP;
-                    ++shiftQ;
-
-                    const double ampl = exp((itsFreq[ch] * itsFreq[ch])
-                        / (casacore::C::c * casacore::C::c) * uvPrime);
-
-                    blShift *= ampl;
-
-                    // Compute visibilities.
-                    *buffer++ += blShift * (*spectrum++);
-                    *buffer++ += blShift * (*spectrum++);
-                    *buffer++ += blShift * (*spectrum++);
-                    *buffer++ += blShift * (*spectrum++);
-                } // Channels.
-            }
+          spectrum[0] = stokes.I + stokes.Q;
+          spectrum[blockSize] = stokes.U;
+          spectrum[2*blockSize] = stokes.V;
+          spectrum[3*blockSize] = stokes.I - stokes.Q;
+        }
+        spectrum += nStokes*blockSize;
+    }
+}
+
+void Simulator::flushBlock(ComponentBlock &block)
+{
+    if(block.n == 0) {
+        return;
+    }
+    // Compute station phase shifts per component.
+    const double* l = &block.lmn[0];
+    const double* m = &block.lmn[blockSize];
+    const double* n = &block.lmn[2*blockSize];
+    for(size_t st = 0; st < itsNStation; ++st)
+    {
+        const double u = itsUVW(0,st);
+        const double v = itsUVW(1,st);
+        const double w = itsUVW(2,st);
+        double* phase = &itsStationPhase[st*blockSize];
+        for(size_t k = 0; k < block.n; ++k) {
+            phase[k] = casacore::C::_2pi * (u * l[k] + v * m[k] + w * n[k]);
         }
-    } // Baselines.
+    }
+
+    if(itsSinglePrecision) {
+        simulateBlock<float>(block);
+    } else {
+        simulateBlock<double>(block);
+    }
+    block.n = 0;
+}
+
+template <>
+const double* Simulator::blockSpectrum<double>(const ComponentBlock &block)
+{
+    return block.spectrum.data();
+}
+
+template <>
+const float* Simulator::blockSpectrum<float>(const ComponentBlock &block)
+{
+    itsSpectrumF.assign(block.spectrum.begin(), block.spectrum.end());
+    return itsSpectrumF.data();
+}
+
+template <typename T>
+void Simulator::simulateBlock(const ComponentBlock &block)
+{
+    const T* spectrumData = blockSpectrum<T>(block);
+    const std::vector<double>& freqC = itsFreqAxis.values();
+    const bool regular = itsFreqAxis.isRegular();
+    const double df = itsFreqAxis.step();
+
+    // For regular channels the station phasors are only computed exactly
+    // at the start of each chunk and the phasor rotation per channel is
+    // needed. Otherwise the station phasors are computed for each channel.
+    const size_t chunkSize = regular ? PhasorAxis::chunkSize : 1;
+    const size_t stride = itsNStation*blockSize;
+    if(regular) {
+        for(size_t i = 0; i < stride; ++i) {
+            const double rotPhase = itsStationPhase[i] * df;
+            itsStationRotR[i] = cos(rotPhase);
+            itsStationRotI[i] = sin(rotPhase);
+        }
+    }
+    const size_t nExact = (itsNChannel + chunkSize - 1) / chunkSize;
+    for(size_t i = 0; i < nExact; ++i) {
+        const double freq = freqC[i * chunkSize];
+        double* phasorR = &itsStationPhasorR[i*stride];
+        double* phasorI = &itsStationPhasorI[i*stride];
+        for(size_t j = 0; j < stride; ++j) {
+            const double chPhase = itsStationPhase[j] * freq;
+            phasorR[j] = cos(chPhase);
+            phasorI[j] = sin(chPhase);
+        }
+    }
+
+    if(itsNBlBlocks == 1) {
+        addBaselines(block, spectrumData, 0, itsNBaseline);
+    } else {
+        ThreadPool::GetInstance().For(0, itsNBlBlocks,
+            [&](size_t blBlock, size_t) {
+                addBaselines(block, spectrumData,
+                             blBlock * itsNBaseline / itsNBlBlocks,
+                             (blBlock+1) * itsNBaseline / itsNBlBlocks);
+            });
+    }
+}
+
+template <typename T>
+void Simulator::addBaselines(const ComponentBlock &block,
+                             const T* spectrumData,
+                             size_t blStart, size_t blEnd)
+{
+    const size_t nK = block.n;
+    const size_t nCorr = itsStokesIOnly ? 1 : 4;
+    const std::vector<double>& freqC = itsFreqAxis.values();
+    const bool regular = itsFreqAxis.isRegular();
+    const double df = itsFreqAxis.step();
+    const double* gauss = block.gauss.data();
+    const T minAmplitude = 1e-30;
+    const size_t chunkSize = regular ? PhasorAxis::chunkSize : irregularChunkSize;
+    const size_t stride = itsNStation*blockSize;
+
+    // Per component: the baseline phasor and its rotation per channel,
+    // the Gaussian exponent and amplitude (a), the amplitude factor to the
+    // next channel (g) and the factor of g to the next channel (h).
+    double uvPrime[blockSize];
+    T pr[blockSize], pi[blockSize], rr[blockSize], ri[blockSize];
+    T a[blockSize], g[blockSize], h[blockSize];
+    T wr[blockSize], wi[blockSize];
+
+    for(size_t chStart = 0; chStart < itsNChannel; chStart += chunkSize) {
+        const size_t chEnd = std::min(chStart + chunkSize, itsNChannel);
+        for(size_t bl = blStart; bl < blEnd; ++bl) {
+            const size_t p = itsBaselines[bl].first;
+            const size_t q = itsBaselines[bl].second;
+            if(p == q) {
+                continue;
+            }
+            dcomplex* buffer = &itsBuffer(0,chStart,bl);
+
+            // The baseline phasor is shiftQ * conj(shiftP); the same holds
+            // for its rotation.
+            if(regular) {
+                const double* rotPR = &itsStationRotR[p*blockSize];
+                const double* rotPI = &itsStationRotI[p*blockSize];
+                const double* rotQR = &itsStationRotR[q*blockSize];
+                const double* rotQI = &itsStationRotI[q*blockSize];
+                for(size_t k = 0; k < nK; ++k) {
+                    rr[k] = rotQR[k] * rotPR[k] + rotQI[k] * rotPI[k];
+                    ri[k] = rotQI[k] * rotPR[k] - rotQR[k] * rotPI[k];
+                }
+            }
+            if(block.gaussian) {
+                const double u = itsUVW(0,q) - itsUVW(0,p);
+                const double v = itsUVW(1,q) - itsUVW(1,p);
+                for(size_t k = 0; k < nK; ++k) {
+                    const double uPrime = gauss[k]*u - gauss[blockSize+k]*v;
+                    const double vPrime = gauss[2*blockSize+k]*u + gauss[3*blockSize+k]*v;
+                    // Compute uPrime^2 + vPrime^2 and pre-multiply with
+                    // -2.0 * PI^2 / C^2.
+                    uvPrime[k] = (-2.0 * casacore::C::pi * casacore::C::pi)
+                        * (uPrime * uPrime + vPrime * vPrime);
+                    // The amplitude is exp(freqC^2 * uvPrime); for regular
+                    // channels the ratio between channels is g, which
+                    // changes by the constant factor h.
+                    h[k] = exp(2.0 * df * df * uvPrime[k]);
+                }
+            }
+
+            for(size_t ch = chStart; ch < chEnd; ++ch) {
+                const bool exact = !regular || ch == chStart;
+                if(exact) {
+                    const size_t offset = (regular ? ch / chunkSize : ch) * stride;
+                    const double* phasorPR = &itsStationPhasorR[offset + p*blockSize];
+                    const double* phasorPI = &itsStationPhasorI[offset + p*blockSize];
+                    const double* phasorQR = &itsStationPhasorR[offset + q*blockSize];
+                    const double* phasorQI = &itsStationPhasorI[offset + q*blockSize];
+#pragma omp simd
+                    for(size_t k = 0; k < nK; ++k) {
+                        pr[k] = phasorQR[k] * phasorPR[k] + phasorQI[k] * phasorPI[k];
+                        pi[k] = phasorQI[k] * phasorPR[k] - phasorQR[k] * phasorPI[k];
+                    }
+                }
+                const T* sumR = pr;
+                const T* sumI = pi;
+                if(block.gaussian) {
+                    if(exact) {
+                        for(size_t k = 0; k < nK; ++k) {
+                            a[k] = exp(freqC[ch] * freqC[ch] * uvPrime[k]);
+                            g[k] = exp((2.0 * freqC[ch] + df) * df * uvPrime[k]);
+                            // Negligible amplitudes are set to zero (and stay
+                            // zero) to avoid slow arithmetic on denormals.
+                            if(a[k] < minAmplitude) {
+                                a[k] = 0;
+                                g[k] = 0;
+                            }
+                        }
+                    }
+#pragma omp simd
+                    for(size_t k = 0; k < nK; ++k) {
+                        wr[k] = pr[k] * a[k];
+                        wi[k] = pi[k] * a[k];
+                    }
+                    sumR = wr;
+                    sumI = wi;
+                }
+
+                addVisibilities(nK, sumR, sumI, spectrumData + ch*nCorr*blockSize,
+                                blockSize, itsStokesIOnly, buffer);
+                buffer += nCorr;
+
+                if(regular) {
+#pragma omp simd
+                    for(size_t k = 0; k < nK; ++k) {
+                        const T tr = pr[k] * rr[k] - pi[k] * ri[k];
+                        pi[k] = pr[k] * ri[k] + pi[k] * rr[k];
+                        pr[k] = tr;
+                    }
+                    if(block.gaussian) {
+#pragma omp simd
+                        for(size_t k = 0; k < nK; ++k) {
+                            a[k] *= g[k];
+                            g[k] *= h[k];
+                            if(a[k] < minAmplitude) {
+                                a[k] = 0;
+                                g[k] = 0;
+                            }
+                        }
+                    }
+                }
+            } // Channels.
+        } // Baselines.
+    } // Chunks.
 }
 
 namespace
@@ -272,45 +436,42 @@ inline void radec2lmn(const Position &reference, const Position &position,
   lmn[2] = sqrt(1.0 - l * l - m * m);
 }
 
-// Compute station phase shifts.
-inline void phases(size_t nStation, size_t nChannel, const double* lmn,
-                   const casacore::Matrix<double>& uvw,
-                   const casacore::Vector<double>& freq,
-                   Simulator::Matrix<dcomplex>& shift)
+template <typename T>
+inline void addVisibilities(size_t nK, const T* wr, const T* wi,
+                            const T* spectrum, size_t blockSize,
+                            bool stokesIOnly, dcomplex* buffer)
 {
-    dcomplex* shiftdata=shift.data();
-    for(size_t st = 0; st < nStation; ++st)
-    {
-        const double phase = casacore::C::_2pi * (uvw(0,st) * lmn[0]
-            + uvw(1,st) * lmn[1] + uvw(2,st) * (lmn[2] - 1.0));
-
-        for(size_t ch = 0; ch < nChannel; ++ch)
-        {
-            const double chPhase = phase * freq[ch] / casacore::C::c;
-            *shiftdata = dcomplex(cos(chPhase), sin(chPhase));
-            ++shiftdata;
-        } // Channels.
-    } // Stations.
-}
-
-
-// Compute component spectrum.
-inline void spectrum(const PointSource &component, size_t nChannel,
-                     const casacore::Vector<double>& freq,
-                     Simulator::Matrix<dcomplex>& spectrum, bool stokesIOnly=false)
-{
-    for(size_t ch = 0; ch < nChannel; ++ch)
-    {
-        Stokes stokes = component.stokes(freq[ch]);
-
-        if (stokesIOnly) {
-          spectrum(0,ch) = dcomplex(stokes.I, 0.0);
-        } else {
-          spectrum(0,ch) = dcomplex(stokes.I + stokes.Q, 0.0);
-          spectrum(1,ch) = dcomplex(stokes.U, stokes.V);
-          spectrum(2,ch) = dcomplex(stokes.U, -stokes.V);
-          spectrum(3,ch) = dcomplex(stokes.I - stokes.Q, 0.0);
+    if (stokesIOnly) {
+        T sr = 0, si = 0;
+#pragma omp simd reduction(+:sr,si)
+        for(size_t k = 0; k < nK; ++k) {
+            sr += wr[k] * spectrum[k];
+            si += wi[k] * spectrum[k];
+        }
+        buffer[0] += dcomplex(sr, si);
+    } else {
+        const T* iqp = spectrum;
+        const T* u = spectrum + blockSize;
+        const T* v = spectrum + 2*blockSize;
+        const T* iqm = spectrum + 3*blockSize;
+        T xxr = 0, xxi = 0, xyr = 0, xyi = 0;
+        T yxr = 0, yxi = 0, yyr = 0, yyi = 0;
+#pragma omp simd reduction(+:xxr,xxi,xyr,xyi,yxr,yxi,yyr,yyi)
+        for(size_t k = 0; k < nK; ++k) {
+            // blShift * (I+Q, U+iV, U-iV, I-Q)
+            xxr += wr[k] * iqp[k];
+            xxi += wi[k] * iqp[k];
+            xyr += wr[k] * u[k] - wi[k] * v[k];
+            xyi += wr[k] * v[k] + wi[k] * u[k];
+            yxr += wr[k] * u[k] + wi[k] * v[k];
+            yxi += wi[k] * u[k] - wr[k] * v[k];
+            yyr += wr[k] * iqm[k];
+            yyi += wi[k] * iqm[k];
         }
+        buffer[0] += dcomplex(xxr, xxi);
+        buffer[1] += dcomplex(xyr, xyi);
+        buffer[2] += dcomplex(yxr, yxi);
+        buffer[3] += dcomplex(yyr, yyi);
     }
 }
 } // Unnamed namespace.
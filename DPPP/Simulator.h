@@ -31,12 +31,16 @@
 #include "Baseline.h"
 #include "ModelComponent.h"
 #include "ModelComponentVisitor.h"
+#include "Phasors.h"
 #include "Position.h"
 
 #include <casacore/casa/Arrays/Vector.h>
 #include <casacore/casa/Arrays/Matrix.h>
 #include <casacore/casa/Arrays/Cube.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace DP3
 {
 namespace DPPP
@@ -47,60 +51,105 @@ namespace DPPP
 
 typedef std::complex<double> dcomplex;
 
+// The visibilities are computed for blocks of up to blockSize components at
+// a time. The parameters of the components in a block are stored as
+// structure of arrays, so the sum over the components per baseline and
+// channel can be vectorized. The baseline phasors are the product of the
+// station phasors. For regularly spaced channels they (and the amplitudes
+// of Gaussian sources) are computed by recurrence over the channels,
+// restarting exactly every PhasorAxis::chunkSize channels.
+// The sum over a block can be done in single precision, which is faster
+// but less accurate; the result is always added in double precision.
+// The baselines can be summed in parallel blocks; the station phasors of a
+// component block are computed once and shared read-only by those blocks.
+
 class Simulator: public ModelComponentVisitor
 {
 public:
+    // Maximum number of components simulated at once.
+    static const size_t blockSize = 32;
+
+    // Number of channels summed at once per baseline if the channels are
+    // not regularly spaced.
+    static const size_t irregularChunkSize = 8;
+
     Simulator(const Position &reference, size_t nStation, size_t nBaseline,
         size_t nChannel, const casacore::Vector<Baseline>& baselines,
         const casacore::Vector<double>& freq, const casacore::Matrix<double>& uvw,
-        casacore::Cube<dcomplex>& buffer, bool stokesIOnly=false);
-
-    template <typename T>
-    class Matrix {
-      public:
-        Matrix():
-          itsNRows(0) {
-        } ;
-
-        Matrix(size_t nrows, size_t ncols)
-        {
-          resize(nrows, ncols);
-        }
-
-        void resize(size_t nrows, size_t ncols) {
-          itsNRows = nrows;
-          itsData.resize(nrows*ncols);
-        }
-
-        T& operator()(size_t row, size_t col) {
-          return itsData[col*itsNRows+row];
-        }
-
-        T* data() {
-          return &itsData[0];
-        }
-
-      private:
-        std::vector<T> itsData;
-        size_t itsNRows;
-    };
+        casacore::Cube<dcomplex>& buffer, bool stokesIOnly=false,
+        bool singlePrecision=false);
 
     void simulate(const ModelComponent::ConstPtr &component);
 
+    // Simulate the components in [first,last) in blocks of blockSize
+    // components, which is much faster than simulating them one by one.
+    void simulate(std::vector<ModelComponent::ConstPtr>::const_iterator first,
+                  std::vector<ModelComponent::ConstPtr>::const_iterator last);
+
+    // Sum the baselines in nBlocks blocks in parallel using the ThreadPool.
+    // The default is 1 (no parallelization).
+    void setNBaselineBlocks(size_t nBlocks)
+      { itsNBlBlocks = std::max<size_t>(1, std::min(nBlocks, itsNBaseline)); }
+
 private:
+    // Add the component to its block.
     virtual void visit(const PointSource &component);
     virtual void visit(const GaussianSource &component);
 
+    // The parameters of a block of components (structure of arrays).
+    struct ComponentBlock
+    {
+        void init(bool isGaussian, size_t nChannel, bool stokesIOnly);
+
+        size_t              n;        //# number of components in the block
+        bool                gaussian; //# block of Gaussian sources?
+        std::vector<double> lmn;      //# [3,blockSize] l, m, n-1
+        std::vector<double> gauss;    //# [4,blockSize] uv scaling
+        std::vector<double> spectrum; //# [nChannel,nStokes,blockSize]
+    };
+
+    // Add the position and spectrum of the component to the block.
+    void addToBlock(ComponentBlock &block, const PointSource &component);
+
+    // Add the visibilities of the components in the block to the buffer
+    // and clear the block.
+    void flushBlock(ComponentBlock &block);
+
+    // Sum the visibilities of the block in precision T.
+    template <typename T>
+    void simulateBlock(const ComponentBlock &block);
+
+    // Add the visibilities of the block to the baselines [blStart,blEnd)
+    // using the precomputed station phasors.
+    template <typename T>
+    void addBaselines(const ComponentBlock &block, const T* spectrumData,
+                      size_t blStart, size_t blEnd);
+
+    // Get the spectrum of the block in precision T.
+    template <typename T>
+    const T* blockSpectrum(const ComponentBlock &block);
+
 private:
     Position                     itsReference;
     size_t                       itsNStation, itsNBaseline, itsNChannel;
+    size_t                       itsNBlBlocks;
     bool                         itsStokesIOnly;
+    bool                         itsSinglePrecision;
     const casacore::Vector<Baseline> itsBaselines;
     const casacore::Vector<double>   itsFreq;
     const casacore::Matrix<double>   itsUVW;
     casacore::Cube<dcomplex>     itsBuffer;
-    Matrix<dcomplex>           itsShiftBuffer;
-    Matrix<dcomplex>           itsSpectrumBuffer;
+    PhasorAxis                   itsFreqAxis;
+    // Point sources and Gaussian sources are collected in separate blocks.
+    ComponentBlock               itsPointBlock;
+    ComponentBlock               itsGaussianBlock;
+    std::vector<float>           itsSpectrumF;     //# single precision spectrum
+    std::vector<double>          itsStationPhase;  //# [nStation,blockSize]
+    std::vector<double>          itsStationPhasorR; //# [nExact,nStation,blockSize]
+                                                    //# nExact: per chunk or channel
+    std::vector<double>          itsStationPhasorI;
+    std::vector<double>          itsStationRotR;   //# [nStation,blockSize]
+    std::vector<double>          itsStationRotI;
 };
 
 // @}
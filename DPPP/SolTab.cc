@@ -311,6 +311,40 @@ namespace DP3 {
     return res;
   }
 
+  vector<double> H5Parm::SolTab::getValuesOrWeights(
+              const string& valOrWeight,
+              uint startfreq, uint nfreq) {
+    H5::DataSet val = openDataSet(valOrWeight);
+
+    // Select all elements, except for the frequencies
+    hsize_t offset[_axes.size()];
+    hsize_t count[_axes.size()];
+    size_t size = 1;
+    for (uint i=0; i<_axes.size(); ++i) {
+      offset[i] = 0;
+      count[i] = _axes[i].size;
+      if (_axes[i].name=="freq") {
+        offset[i] = startfreq;
+        count[i] = nfreq;
+      }
+      size *= count[i];
+    }
+    vector<double> res(size);
+
+    H5::DataSpace dataspace = val.getSpace();
+    dataspace.selectHyperslab(H5S_SELECT_SET, count, offset);
+
+    // Setup memory dataspace
+    H5::DataSpace memspace(_axes.size(), count);
+    try {
+      val.read(&(res[0]), H5::PredType::NATIVE_DOUBLE, memspace, dataspace);
+    } catch (H5::DataSetIException& e) {
+      e.printError();
+      throw Exception("Could not read data");
+    }
+    return res;
+  }
+
   void H5Parm::SolTab::setAntennas(const vector<string>& solAntennas) {
     // TODO: assert that antenna is present in antenna table in solset
     hsize_t dims[1];
@@ -0,0 +1,169 @@
+//# SolTabCache.cc: In-memory copy of an H5Parm solution table
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include "SolTabCache.h"
+#include "Exceptions.h"
+#include "GridInterpolate.h"
+
+#include <cassert>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+
+namespace DP3 {
+
+  SolTabCache::SolTabCache (H5Parm::SolTab& solTab,
+                            const vector<double>& freqs)
+    : itsTimeAxis   (1, 0.),
+      itsFreqAxis   (1, 0.),
+      itsTimeStride (0),
+      itsFreqStride (0),
+      itsAntStride  (0),
+      itsPolStride  (0),
+      itsDirStride  (0),
+      itsNPol       (1),
+      itsNDir       (1)
+  {
+    assert(!freqs.empty());
+    uint startFreq = 0;
+    uint nfreq = 1;
+    if (solTab.hasAxis("time")) {
+      itsTimeAxis = solTab.getRealAxis("time");
+    }
+    if (solTab.hasAxis("freq")) {
+      vector<double> fullFreqAxis = solTab.getRealAxis("freq");
+      startFreq = solTab.getFreqIndex(freqs[0]);
+      nfreq = solTab.getFreqIndex(freqs[freqs.size()-1]) - startFreq + 1;
+      itsFreqAxis = vector<double>(fullFreqAxis.begin()+startFreq,
+                                   fullFreqAxis.begin()+startFreq+nfreq);
+    }
+    if (solTab.hasAxis("ant")) {
+      vector<string> antNames = solTab.getStringAxis("ant");
+      for (size_t i=0; i<antNames.size(); ++i) {
+        itsAntIndex[antNames[i]] = i;
+      }
+    }
+
+    // Determine the strides of the axes as read (fastest varying last).
+    const vector<H5Parm::AxisInfo>& axes = solTab.getAxes();
+    size_t stride = 1;
+    for (size_t i=axes.size(); i>0; --i) {
+      const H5Parm::AxisInfo& axis = axes[i-1];
+      if (axis.name=="time") {
+        itsTimeStride = stride;
+      } else if (axis.name=="freq") {
+        itsFreqStride = stride;
+      } else if (axis.name=="ant") {
+        itsAntStride = stride;
+      } else if (axis.name=="pol") {
+        itsPolStride = stride;
+        itsNPol = axis.size;
+      } else if (axis.name=="dir") {
+        itsDirStride = stride;
+        itsNDir = axis.size;
+      } else {
+        assert(axis.size == 1);
+      }
+      stride *= (axis.name=="freq" ? nfreq : axis.size);
+    }
+
+    itsValues  = solTab.getValuesOrWeights("val", startFreq, nfreq);
+    itsWeights = solTab.getValuesOrWeights("weight", startFreq, nfreq);
+  }
+
+  SolTabCache::ShPtr SolTabCache::get (const string& fileName,
+                                       const string& solSetName,
+                                       H5Parm::SolTab& solTab,
+                                       const vector<double>& freqs)
+  {
+    static std::mutex registryMutex;
+    static map<string, std::weak_ptr<const SolTabCache> > registry;
+    ostringstream key;
+    key << setprecision(17) << fileName << ' ' << solSetName << ' '
+        << solTab.getName() << ' '
+        << freqs.size() << ' ' << freqs.front() << ' ' << freqs.back();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::weak_ptr<const SolTabCache>& entry = registry[key.str()];
+    ShPtr cache = entry.lock();
+    if (!cache) {
+      cache = std::make_shared<const SolTabCache>(solTab, freqs);
+      entry = cache;
+    }
+    return cache;
+  }
+
+  vector<double> SolTabCache::getValuesOrWeights (const string& valOrWeight,
+                                                  const string& antName,
+                                                  const vector<double>& times,
+                                                  const vector<double>& freqs,
+                                                  uint pol, uint dir) const
+  {
+    const vector<double>* data;
+    if (valOrWeight=="val") {
+      data = &itsValues;
+    } else if (valOrWeight=="weight") {
+      data = &itsWeights;
+    } else {
+      throw Exception("SolTab has no table " + valOrWeight);
+    }
+    size_t offset = 0;
+    if (itsAntStride > 0) {
+      map<string, size_t>::const_iterator iter = itsAntIndex.find(antName);
+      if (iter == itsAntIndex.end()) {
+        throw Exception("SolTab has no element " + antName + " in ant");
+      }
+      offset += iter->second * itsAntStride;
+    }
+    if (itsPolStride > 0) {
+      if (pol >= itsNPol) {
+        throw Exception("SolTab has no polarization " + std::to_string(pol));
+      }
+      offset += pol * itsPolStride;
+    }
+    if (itsDirStride > 0) {
+      if (dir >= itsNDir) {
+        throw Exception("SolTab has no direction " + std::to_string(dir));
+      }
+      offset += dir * itsDirStride;
+    }
+
+    // Gather the values of the antenna, freq varying fastest.
+    const size_t ntime = itsTimeAxis.size();
+    const size_t nfreq = itsFreqAxis.size();
+    vector<double> h5values(ntime*nfreq);
+    for (size_t t=0; t<ntime; ++t) {
+      const double* in = data->data() + offset + t*itsTimeStride;
+      for (size_t f=0; f<nfreq; ++f) {
+        h5values[t*nfreq + f] = in[f*itsFreqStride];
+      }
+    }
+
+    vector<double> interpolated(times.size()*freqs.size());
+    gridNearestNeighbor(itsTimeAxis, itsFreqAxis,
+                        times, freqs,
+                        &(h5values[0]),
+                        &(interpolated[0]));
+    return interpolated;
+  }
+
+}
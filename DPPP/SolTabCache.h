@@ -0,0 +1,92 @@
+//# SolTabCache.h: In-memory copy of an H5Parm solution table
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_SOLTABCACHE_H
+#define DPPP_SOLTABCACHE_H
+
+// @file
+// @brief In-memory copy of an H5Parm solution table
+
+#include "H5Parm.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DP3 {
+
+  // This class holds the values and weights of an H5Parm SolTab for the
+  // frequencies of an MS. They are read with one read call per dataset,
+  // instead of one call per antenna, polarization and direction.
+  // Thereafter the values can be interpolated by any number of threads
+  // without accessing the HDF5 file.
+  //
+  // The caches are shared (see get), so the ApplyCal steps of the
+  // directions in DDECal and H5ParmPredict read a SolTab only once.
+
+  class SolTabCache
+  {
+  public:
+    typedef std::shared_ptr<const SolTabCache> ShPtr;
+
+    // Read the values and weights for all frequencies in the range
+    // of the given frequencies.
+    SolTabCache (H5Parm::SolTab& solTab, const std::vector<double>& freqs);
+
+    // Get the cache of a SolTab in a SolSet of a file for the given
+    // frequencies. SolTabs in different SolSets can have the same name.
+    // It is only read if no other step holds the same cache.
+    // HDF5 is not thread-safe, so the caller must make sure that no other
+    // thread uses HDF5 meanwhile.
+    static ShPtr get (const std::string& fileName,
+                      const std::string& solSetName, H5Parm::SolTab& solTab,
+                      const std::vector<double>& freqs);
+
+    // Get the values or weights for a given antenna, interpolated (nearest
+    // neighbour) to the given times and frequencies. The frequency varies
+    // fastest in the result.
+    // It has the same meaning as SolTab::getValuesOrWeights.
+    std::vector<double> getValuesOrWeights (const std::string& valOrWeight,
+                                            const std::string& antName,
+                                            const std::vector<double>& times,
+                                            const std::vector<double>& freqs,
+                                            uint pol, uint dir) const;
+
+  private:
+    std::vector<double>           itsTimeAxis;
+    std::vector<double>           itsFreqAxis;   //# only the frequencies read
+    std::map<std::string, size_t> itsAntIndex;
+    //# The strides of the axes in the data; 0 if the axis does not exist.
+    size_t                        itsTimeStride;
+    size_t                        itsFreqStride;
+    size_t                        itsAntStride;
+    size_t                        itsPolStride;
+    size_t                        itsDirStride;
+    size_t                        itsNPol;
+    size_t                        itsNDir;
+    std::vector<double>           itsValues;
+    std::vector<double>           itsWeights;
+  };
+
+}
+
+#endif
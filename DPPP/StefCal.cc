@@ -24,6 +24,8 @@
 #include "StefCal.h"
 #include "DPInput.h"
 
+#include <casacore/casa/Containers/Allocator.h>
+
 #include <cassert>
 #include <vector>
 #include <algorithm>
@@ -51,8 +53,6 @@ namespace DP3 {
       _detectStalling (detectStalling),
       _debugLevel (debugLevel)
     {
-      resetVis();
-
       _nSt = maxAntennas;
       if (_mode==FULLJONES) {
         assert(!_scalar);
@@ -69,8 +69,15 @@ namespace DP3 {
         _savedNCr=2;
       }
 
-      _vis.resize(IPosition(6,_nSt,2,_solInt,_nChan,2,_nSt));
-      _mvis.resize(IPosition(6,_nSt,2,_solInt,_nChan,2,_nSt));
+      _timeStride    = 2*_nSt;
+      _chanStride    = _timeStride*_solInt;
+      _polStride     = _chanStride*_nChan;
+      _stationStride = 2*_polStride;
+      IPosition visShape(1, _stationStride*_nSt);
+      _vis.reference (Vector<DComplex>(visShape, ArrayInitPolicies::NO_INIT,
+                                       AlignedAllocator<DComplex,64>::value));
+      _mvis.reference(Vector<DComplex>(visShape, ArrayInitPolicies::NO_INIT,
+                                       AlignedAllocator<DComplex,64>::value));
 
       if (_scalar || _mode==FULLJONES) {
         _nUn = _nSt;
@@ -83,10 +90,10 @@ namespace DP3 {
       _gx.resize(_nUn,_nCr);
       _gxx.resize(_nUn,_nCr);
       _h.resize(_nUn,_nCr);
-      _z.resize(_nUn*_nChan*_solInt*_nSp,_nCr);
 
       _stationFlagged.resize(_nSt, false);
 
+      resetVis();
       init(true);
     }
 
@@ -230,69 +237,98 @@ namespace DP3 {
         _h(st,3)=conj(_g(st,3));
       }
 
+      // The columns of _h as arrays of (real,imag) pairs.
+      const double* h0 = reinterpret_cast<const double*>(_h.data());
+      const double* h1 = h0 + 2*_nUn;
+      const double* h2 = h1 + 2*_nUn;
+      const double* h3 = h2 + 2*_nUn;
+
       for (uint st1=0;st1<_nSt;++st1) {
         if (_stationFlagged[st1]) {
           continue;
         }
 
-        DComplex* vis_p;
-        DComplex* mvis_p;
-        Vector<DComplex> w(_nCr);
-        Vector<DComplex> t(_nCr);
-
-        for (uint time=0;time<_solInt;++time) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            uint zoff=_nSt*ch+_nSt*_nChan*time;
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,0)  = _h(st2,0) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,0) += _h(st2,2) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,1,st1))
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,1)  = _h(st2,0) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,1) += _h(st2,2) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,1,st1))
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,2)  = _h(st2,1) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,2) += _h(st2,3) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,0,time,ch,1,st1))
-            mvis_p=&_mvis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,3)  = _h(st2,1) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,0,st1))
-            mvis_p=&_mvis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { _z(st2+zoff,3) += _h(st2,3) * mvis_p[st2]; } // itsMVis(IPosition(6,st2,1,time,ch,1,st1))
-          }
-        }
-
-        w=0;
+        // Accumulate w = Z^H Z (of which w2 = conj(w1)) and t = Z^H V
+        // where Z = H M, using the baselines of st1 with all other stations.
+        // The real and imaginary parts are kept separately, so the loops
+        // over the second station can be vectorized.
+        double w0=0, w1r=0, w1i=0, w3=0;
+        double t0r=0, t0i=0, t1r=0, t1i=0, t2r=0, t2i=0, t3r=0, t3i=0;
 
         for (uint time=0;time<_solInt;++time) {
           for (uint ch=0;ch<_nChan;++ch) {
+            // The visibilities per (pol2,pol1) as (real,imag) pairs.
+            const double* m00 = reinterpret_cast<const double*>
+              (_mvis.data() + visIndex(st1,0,time,ch,0));
+            const double* m10 = m00 + 2*_nSt;
+            const double* m01 = reinterpret_cast<const double*>
+              (_mvis.data() + visIndex(st1,1,time,ch,0));
+            const double* m11 = m01 + 2*_nSt;
+            const double* v00 = reinterpret_cast<const double*>
+              (_vis.data() + visIndex(st1,0,time,ch,0));
+            const double* v10 = v00 + 2*_nSt;
+            const double* v01 = reinterpret_cast<const double*>
+              (_vis.data() + visIndex(st1,1,time,ch,0));
+            const double* v11 = v01 + 2*_nSt;
+#pragma omp simd reduction(+:w0,w1r,w1i,w3,t0r,t0i,t1r,t1i,t2r,t2i,t3r,t3i)
             for (uint st2=0;st2<_nSt;++st2) {
-              uint zoff=st2+_nSt*ch+_nSt*_nChan*time;
-              w(0) += conj(_z(zoff,0))*_z(zoff,0) + conj(_z(zoff,2))*_z(zoff,2);
-              w(1) += conj(_z(zoff,0))*_z(zoff,1) + conj(_z(zoff,2))*_z(zoff,3);
-              w(3) += conj(_z(zoff,1))*_z(zoff,1) + conj(_z(zoff,3))*_z(zoff,3);
+              const uint re = 2*st2;
+              const uint im = re+1;
+              // z0 = h0*m00 + h2*m10    z1 = h0*m01 + h2*m11
+              // z2 = h1*m00 + h3*m10    z3 = h1*m01 + h3*m11
+              double z0r = h0[re]*m00[re] - h0[im]*m00[im] +
+                           h2[re]*m10[re] - h2[im]*m10[im];
+              double z0i = h0[re]*m00[im] + h0[im]*m00[re] +
+                           h2[re]*m10[im] + h2[im]*m10[re];
+              double z1r = h0[re]*m01[re] - h0[im]*m01[im] +
+                           h2[re]*m11[re] - h2[im]*m11[im];
+              double z1i = h0[re]*m01[im] + h0[im]*m01[re] +
+                           h2[re]*m11[im] + h2[im]*m11[re];
+              double z2r = h1[re]*m00[re] - h1[im]*m00[im] +
+                           h3[re]*m10[re] - h3[im]*m10[im];
+              double z2i = h1[re]*m00[im] + h1[im]*m00[re] +
+                           h3[re]*m10[im] + h3[im]*m10[re];
+              double z3r = h1[re]*m01[re] - h1[im]*m01[im] +
+                           h3[re]*m11[re] - h3[im]*m11[im];
+              double z3i = h1[re]*m01[im] + h1[im]*m01[re] +
+                           h3[re]*m11[im] + h3[im]*m11[re];
+              // w0 += |z0|^2 + |z2|^2    w3 += |z1|^2 + |z3|^2
+              // w1 += conj(z0)*z1 + conj(z2)*z3
+              w0  += z0r*z0r + z0i*z0i + z2r*z2r + z2i*z2i;
+              w3  += z1r*z1r + z1i*z1i + z3r*z3r + z3i*z3i;
+              w1r += z0r*z1r + z0i*z1i + z2r*z3r + z2i*z3i;
+              w1i += z0r*z1i - z0i*z1r + z2r*z3i - z2i*z3r;
+              // t0 += conj(z0)*v00 + conj(z2)*v10
+              // t1 += conj(z0)*v01 + conj(z2)*v11
+              // t2 += conj(z1)*v00 + conj(z3)*v10
+              // t3 += conj(z1)*v01 + conj(z3)*v11
+              t0r += z0r*v00[re] + z0i*v00[im] + z2r*v10[re] + z2i*v10[im];
+              t0i += z0r*v00[im] - z0i*v00[re] + z2r*v10[im] - z2i*v10[re];
+              t1r += z0r*v01[re] + z0i*v01[im] + z2r*v11[re] + z2i*v11[im];
+              t1i += z0r*v01[im] - z0i*v01[re] + z2r*v11[im] - z2i*v11[re];
+              t2r += z1r*v00[re] + z1i*v00[im] + z3r*v10[re] + z3i*v10[im];
+              t2i += z1r*v00[im] - z1i*v00[re] + z3r*v10[im] - z3i*v10[re];
+              t3r += z1r*v01[re] + z1i*v01[im] + z3r*v11[re] + z3i*v11[im];
+              t3i += z1r*v01[im] - z1i*v01[re] + z3r*v11[im] - z3i*v11[re];
             }
           }
         }
-        w(2)=conj(w(1));
-
-        t=0;
+        DComplex w1(w1r, w1i);
+        DComplex w2 = conj(w1);
+        DComplex t0(t0r, t0i), t1(t1r, t1i), t2(t2r, t2i), t3(t3r, t3i);
 
-        for (uint time=0;time<_solInt;++time) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            vis_p=&_vis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(0) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,0)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(0) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,2)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,1,st1))
-            vis_p=&_vis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(1) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,0)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(1) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,2)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,1,st1))
-            vis_p=&_vis(IPosition(6,0,0,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(2) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,1)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,0,st1)); for (uint st2=0;st2<_nSt;++st2) { t(2) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,3)) * vis_p[st2]; }// itsVis(IPosition(6,st2,0,time,ch,1,st1))
-            vis_p=&_vis(IPosition(6,0,0,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(3) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,1)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,0,st1))
-            vis_p=&_vis(IPosition(6,0,1,time,ch,1,st1)); for (uint st2=0;st2<_nSt;++st2) { t(3) += conj(_z(st2+_nSt*ch+_nSt*_nChan*time,3)) * vis_p[st2]; }// itsVis(IPosition(6,st2,1,time,ch,1,st1))
-          }
-        }
-        DComplex invdet= w(0) * w (3) - w(1)*w(2);
-        if (abs(invdet)==0) {
+        // w0 and w3 are real and w1*w2 = |w1|^2, so the determinant is real.
+        double det = w0*w3 - norm(w1);
+        if (det==0) {
           _stationFlagged[st1] = true;
           _g(st1,0) = 0;
           continue;
         }
-        invdet= 1./invdet;
-        _g(st1,0) = invdet * ( w(3) * t(0) - w(1) * t(2) );
-        _g(st1,1) = invdet * ( w(3) * t(1) - w(1) * t(3) );
-        _g(st1,2) = invdet * ( w(0) * t(2) - w(2) * t(0) );
-        _g(st1,3) = invdet * ( w(0) * t(3) - w(2) * t(1) );
+        double invdet = 1./det;
+        _g(st1,0) = invdet * ( w3 * t0 - w1 * t2 );
+        _g(st1,1) = invdet * ( w3 * t1 - w1 * t3 );
+        _g(st1,2) = invdet * ( w0 * t2 - w2 * t0 );
+        _g(st1,3) = invdet * ( w0 * t3 - w2 * t1 );
       }
     }
 
@@ -302,35 +338,43 @@ namespace DP3 {
       for (uint ant=0;ant<_nUn;++ant) {
         _h(ant,0)=conj(_g(ant,0));
       }
+      const double* h = reinterpret_cast<const double*>(_h.data());
+
+      // The visibilities of an unknown are stored contiguously as
+      // nBlocks blocks of _nUn baselines which match the unknowns in _h.
+      // For scalar solutions there are _nSp*_nSp polarization blocks per
+      // time and channel, otherwise both polarizations of the second
+      // station are part of the _nUn baselines.
+      const uint nBlocks = _nSp*_nChan*_solInt*_nSp;
 
       for (uint st1=0;st1<_nUn;++st1) {
         if (_stationFlagged[st1%_nSt]) {
           continue;
         }
-        DComplex* vis_p;
-        DComplex* mvis_p;
+        size_t offset = visIndex(st1%_nSt, st1/_nSt, 0, 0, 0);
+        const double* mvis_p = reinterpret_cast<const double*>
+          (_mvis.data() + offset);
+        const double* vis_p  = reinterpret_cast<const double*>
+          (_vis.data() + offset);
         double ww=0; // Same as w, but specifically for pol==false
-        DComplex tt=0; // Same as t, but specifically for pol==false
-
-        mvis_p=&_mvis(IPosition(6,0,0,0,0,st1/_nSt,st1%_nSt));
-        vis_p = &_vis(IPosition(6,0,0,0,0,st1/_nSt,st1%_nSt));
-        for (uint st1pol=0;st1pol<_nSp;++st1pol) {
-          for (uint ch=0;ch<_nChan;++ch) {
-            for (uint time=0;time<_solInt;++time) {
-              for (uint st2pol=0;st2pol<_nSp;++st2pol) {
-                DComplex* h_p=_h.data();
-                for (uint st2=0;st2<_nUn;++st2) {
-                  DComplex z(h_p[st2] * *mvis_p); //itsMVis(IPosition(6,st2%nSt,st2/nSt,time,ch,st1/nSt,st1%nSt));
-                  assert(isFinite(z));
-                  ww+=norm(z);
-                  tt+=conj(z) * *vis_p; //itsVis(IPosition(6,st2%nSt,st2/nSt,time,ch,st1/nSt,st1%nSt));
-                  mvis_p++;
-                  vis_p++;
-                }
-              }
-            }
+        double ttr=0, tti=0; // Same as t, but specifically for pol==false
+
+        for (uint block=0;block<nBlocks;++block) {
+#pragma omp simd reduction(+:ww,ttr,tti)
+          for (uint st2=0;st2<_nUn;++st2) {
+            const uint re = 2*st2;
+            const uint im = re+1;
+            // z = h*mvis;  ww += |z|^2;  tt += conj(z)*vis
+            double zr = h[re]*mvis_p[re] - h[im]*mvis_p[im];
+            double zi = h[re]*mvis_p[im] + h[im]*mvis_p[re];
+            ww  += zr*zr + zi*zi;
+            ttr += zr*vis_p[re] + zi*vis_p[im];
+            tti += zr*vis_p[im] - zi*vis_p[re];
           }
+          mvis_p += 2*_nUn;
+          vis_p  += 2*_nUn;
         }
+        DComplex tt(ttr, tti);
 
         // Flag a station if all baselines are flagged or all data is zero
         if (ww==0 || abs(tt)==0) {
@@ -352,6 +396,29 @@ namespace DP3 {
       }
     }
 
+    void StefCal::setVisibilities(uint ant1, uint ant2, uint time, uint ch,
+                                  const Complex* data, const Complex* model,
+                                  const float* weight, uint nCr) {
+      // For nCr==4 correlation cr is (pol cr/2, pol cr%2); for nCr==2 the
+      // visibilities end up at (0,0) for cr==0 and (1,1) for cr==1.
+      const uint nCrDiv = (nCr==4 ? 2 : 1);
+      for (uint cr=0;cr<nCr;++cr) {
+        const uint pol1 = cr/nCrDiv;
+        const uint pol2 = cr%2;
+        const double sqrtWeight = sqrt(weight[cr]);
+        const DComplex vis  = DComplex(data[cr]) * sqrtWeight;
+        const DComplex mvis = DComplex(model[cr]) * sqrtWeight;
+        // Baseline (ant1,ant2) is stored with ant1 as second station.
+        const size_t index12 = visIndex(ant2, pol2, time, ch, pol1) + ant1;
+        _vis(index12)  = vis;
+        _mvis(index12) = mvis;
+        // The conjugate transpose.
+        const size_t index21 = visIndex(ant1, pol1, time, ch, pol2) + ant2;
+        _vis(index21)  = conj(vis);
+        _mvis(index21) = conj(mvis);
+      }
+    }
+
     void StefCal::incrementWeight(float weight) {
       _totalWeight += weight;
     }
@@ -71,15 +71,15 @@ namespace DP3 {
       // Increments the weight (only relevant for TEC-fitting)
       void incrementWeight(float weight);
 
-      // Returns a reference to the visibility matrix
-      casacore::Array<casacore::DComplex>& getVis() {
-        return _vis;
-      }
-
-      // Returns a reference to the model visibility matrix
-      casacore::Array<casacore::DComplex>& getMVis() {
-        return _mvis;
-      }
+      // Sets the data and model visibilities of baseline (ant1,ant2) for
+      // the given time slot in the solution interval and channel.
+      // The nCr correlations are weighted with the square root of their
+      // weight. The conjugates are stored for baseline (ant2,ant1), so the
+      // solver can iterate over all baselines of a station contiguously.
+      void setVisibilities(uint ant1, uint ant2, uint time, uint ch,
+                           const casacore::Complex* data,
+                           const casacore::Complex* model,
+                           const float* weight, uint nCr);
 
       casacore::Vector<bool>& getStationFlagged() {
         return _stationFlagged;
@@ -107,16 +107,28 @@ namespace DP3 {
 
       double getAverageUnflaggedSolution();
 
+      // Index in _vis and _mvis of the first baseline of station st1
+      // (with polarization pol1) for the given time, channel and
+      // polarization pol2 of the second station.
+      size_t visIndex(uint st1, uint pol1, uint time, uint ch,
+                      uint pol2) const {
+        return st1*_stationStride + pol1*_polStride + ch*_chanStride +
+               time*_timeStride + pol2*_nSt;
+      }
+
       uint _savedNCr;
       casacore::Vector<bool> _stationFlagged ; // Contains true for totally flagged stations
-      casacore::Array<casacore::DComplex> _vis; // Visibility matrix
-      casacore::Array<casacore::DComplex> _mvis; // Model visibility matrix
+      // The visibility and model visibility matrices are stored contiguously
+      // and 64-byte aligned with shape [nSt,2,solInt,nChan,2,nSt], i.e. all
+      // baselines of the first station (axis 5) are stored together and the
+      // second station (axis 0) varies fastest.
+      casacore::Vector<casacore::DComplex> _vis; // Visibility matrix
+      casacore::Vector<casacore::DComplex> _mvis; // Model visibility matrix
       casacore::Matrix<casacore::DComplex> _g; // Solution, indexed by station, correlation
       casacore::Matrix<casacore::DComplex> _gx; // Previous solution
       casacore::Matrix<casacore::DComplex> _gxx; // Solution before previous solution
       casacore::Matrix<casacore::DComplex> _gold; // Previous solution
       casacore::Matrix<casacore::DComplex> _h; // Hermitian transpose of previous solution
-      casacore::Matrix<casacore::DComplex> _z; // Internal stefcal vector
 
       uint _nSt; // number of stations in the current solution
       uint _nUn; // number of unknowns
@@ -126,6 +138,10 @@ namespace DP3 {
       uint _veryBadIters; // number of iterations where solution got worse
       uint _solInt; // solution interval
       uint _nChan;  // number of channels
+      size_t _timeStride;    // strides in _vis and _mvis
+      size_t _chanStride;
+      size_t _polStride;
+      size_t _stationStride;
       StefCalMode _mode; // diagonal, scalarphase, fulljones or phaseonly
       bool _scalar; // false if each polarization has a separate solution
       double _tolerance;
@@ -34,6 +34,8 @@ namespace DP3 {
   namespace DPPP {
 
     UVWCalculator::UVWCalculator()
+      : itsMovingPhaseDir (false),
+        itsLastTime       (0)
     {}
 
     UVWCalculator::UVWCalculator (const MDirection& phaseDir,
@@ -43,6 +45,7 @@ namespace DP3 {
       // Convert the station positions to a baseline in ITRF.
       int nrant = stationPositions.size();
       Vector<Double> pos0;
+      itsAntPos.reserve (3*nrant);
       for (int i=0; i<nrant; ++i) {
         // Get antenna positions and convert to ITRF.
         MPosition mpos = MPosition::Convert (stationPositions[i],
@@ -51,10 +54,9 @@ namespace DP3 {
           pos0 = mpos.getValue().getVector();
         }
         Vector<Double> pos = mpos.getValue().getVector();
-        MVPosition mvpos((pos[0] - pos0[0]),
-                         (pos[1] - pos0[1]),
-                         (pos[2] - pos0[2]));
-        itsAntMB.push_back (MBaseline (MVBaseline(mvpos), MBaseline::ITRF));
+        for (int j=0; j<3; ++j) {
+          itsAntPos.push_back (pos[j] - pos0[j]);
+        }
       }
       // Initialize the converters.
       // Set up the frame for epoch and antenna position.
@@ -73,47 +75,85 @@ namespace DP3 {
       }
       itsFrame.set (MEpoch());
       // Create converter for MBaseline ITRF to J2000.
-      itsBLToJ2000.set (MBaseline(), MBaseline::Ref(MBaseline::J2000,itsFrame));
+      itsBLToJ2000.set (MBaseline(MVBaseline(), MBaseline::ITRF),
+                        MBaseline::Ref(MBaseline::J2000,itsFrame));
       // Initialize the rest which is used to cache the UVW per antenna.
       // The cache is only useful if the MS is accessed in time order, but that
       // is normally the case.
       itsLastTime = 0;
-      itsAntUvw.resize (nrant);
-      itsUvwFilled.resize (nrant);
-      itsUvwFilled = false;
+      itsAntUvw.resize (3*nrant);
     }
 
     Vector<double> UVWCalculator::getUVW (uint ant1, uint ant2, double time)
     {
-      // If a different time, we have to calculate the UVWs.
-      if (time != itsLastTime) {
-        itsLastTime = time;
-        Quantum<Double> tm(time, "s");
-        itsFrame.resetEpoch
-          (MEpoch(MVEpoch(tm.get("d").getValue()), MEpoch::UTC));
-        itsUvwFilled = false;
-        // If phase dir is moving, calculate it for this time.
-        if (itsMovingPhaseDir) {
-          itsPhaseDir = itsDirToJ2000();
-          itsFrame.resetDirection (itsPhaseDir);
+      setTime (time);
+      // The UVW of the baseline is the difference of the antennae.
+      const double* uvw1 = &(itsAntUvw[3*ant1]);
+      const double* uvw2 = &(itsAntUvw[3*ant2]);
+      Vector<double> uvw(3);
+      for (int j=0; j<3; ++j) {
+        uvw[j] = uvw2[j] - uvw1[j];
+      }
+      return uvw;
+    }
+
+    void UVWCalculator::getUVWs (const Vector<int>& ant1,
+                                 const Vector<int>& ant2,
+                                 double time, double* uvws)
+    {
+      setTime (time);
+      const double* antUvw = itsAntUvw.data();
+      for (uint i=0; i<ant1.size(); ++i) {
+        const double* uvw1 = antUvw + 3*ant1[i];
+        const double* uvw2 = antUvw + 3*ant2[i];
+        uvws[0] = uvw2[0] - uvw1[0];
+        uvws[1] = uvw2[1] - uvw1[1];
+        uvws[2] = uvw2[2] - uvw1[2];
+        uvws += 3;
+      }
+    }
+
+    const std::vector<double>& UVWCalculator::getAntUVW (double time)
+    {
+      setTime (time);
+      return itsAntUvw;
+    }
+
+    void UVWCalculator::setTime (double time)
+    {
+      // Nothing to do if the same time.
+      if (time == itsLastTime) {
+        return;
+      }
+      itsLastTime = time;
+      Quantum<Double> tm(time, "s");
+      itsFrame.resetEpoch
+        (MEpoch(MVEpoch(tm.get("d").getValue()), MEpoch::UTC));
+      // If phase dir is moving, calculate it for this time.
+      if (itsMovingPhaseDir) {
+        itsPhaseDir = itsDirToJ2000();
+        itsFrame.resetDirection (itsPhaseDir);
+      }
+      // Get the rotation from ITRF to UVW by converting the unit vectors.
+      // Column k of the matrix is the UVW of unit vector k.
+      double mat[9];
+      for (int k=0; k<3; ++k) {
+        MVBaseline unit (k==0 ? 1. : 0., k==1 ? 1. : 0., k==2 ? 1. : 0.);
+        MVBaseline bas = itsBLToJ2000(unit).getValue();
+        MVuvw jvguvw(bas, itsPhaseDir.getValue());
+        Vector<double> uvw = Muvw(jvguvw, Muvw::J2000).getValue().getVector();
+        for (int j=0; j<3; ++j) {
+          mat[3*k + j] = uvw[j];
         }
       }
-      // Calculate the UVWs for this timestamp if not done yet.
-      int ant = ant1;
-      for (int i=0; i<2; ++i) {
-        if (!itsUvwFilled[ant]) {
-          MBaseline& mbl = itsAntMB[ant];
-          mbl.getRefPtr()->set(itsFrame);       // attach frame
-          MBaseline::Convert mcvt(mbl, MBaseline::J2000);
-          MVBaseline bas = mcvt().getValue();
-          MVuvw jvguvw(bas, itsPhaseDir.getValue());
-          itsAntUvw[ant] = Muvw(jvguvw, Muvw::J2000).getValue().getVector();
-          itsUvwFilled[ant] = true;
+      // Apply it to all antenna positions.
+      const double* pos = itsAntPos.data();
+      double* uvw = itsAntUvw.data();
+      for (size_t i=0; i<itsAntPos.size(); i+=3) {
+        for (int j=0; j<3; ++j) {
+          uvw[i+j] = mat[j]*pos[i] + mat[3+j]*pos[i+1] + mat[6+j]*pos[i+2];
         }
-        ant = ant2;
       }
-      // The UVW of the baseline is the difference of the antennae.
-      return itsAntUvw[ant2] - itsAntUvw[ant1];
     }
 
   } //# end namespace
@@ -39,6 +39,8 @@
 #include <casacore/measures/Measures/MCBaseline.h>
 #include <casacore/casa/Arrays/Vector.h>
 
+#include <vector>
+
 namespace DP3 {
   namespace DPPP {
 
@@ -50,6 +52,12 @@ namespace DP3 {
     // It calculates and caches the UVW coordinates per antenna and combines
     // them to get the baseline UVW coordinates. This is much faster than
     // calculating baseline UVW coordinates directly.
+    //
+    // The conversion of a baseline from ITRF to J2000 and its projection
+    // on the UVW frame are rotations. So for a new time only the three unit
+    // vectors are converted using casacore Measures, giving the rotation
+    // matrix for that time. The UVW coordinates of all antennas are
+    // calculated at once by applying it to their ITRF positions.
 
     class UVWCalculator
     {
@@ -66,15 +74,27 @@ namespace DP3 {
       // get the UVW coordinates for the given baseline and time.
       casacore::Vector<double> getUVW (uint ant1, uint ant2, double time);
 
+      // Get the UVW coordinates for the given baselines and time.
+      // They are stored in uvws as [3,nbl].
+      void getUVWs (const casacore::Vector<int>& ant1,
+                    const casacore::Vector<int>& ant2,
+                    double time, double* uvws);
+
+      // Get the UVW coordinates of all antennas as [3,nant] for the given time.
+      const std::vector<double>& getAntUVW (double time);
+
     private:
+      // Calculate the UVW coordinates of all antennas if the time differs
+      // from the last time.
+      void setTime (double time);
+
       casacore::MDirection              itsPhaseDir;
       bool                          itsMovingPhaseDir;  
       casacore::MDirection::Convert     itsDirToJ2000;   //# direction to J2000
       casacore::MBaseline::Convert      itsBLToJ2000;    //# convert ITRF to J2000
       casacore::MeasFrame               itsFrame;
-      vector<casacore::MBaseline>       itsAntMB;
-      vector<casacore::Vector<double> > itsAntUvw;
-      casacore::Block<bool>             itsUvwFilled;
+      std::vector<double>           itsAntPos;       //# ITRF pos wrt ant 0
+      std::vector<double>           itsAntUvw;       //# 3,nant
       double                        itsLastTime;
     };
 
@@ -155,23 +155,20 @@ namespace DP3 {
       uint nr = nrcorr*nrchan;
       assert (nrchan == itsRecWavel.size());
       // Input uvw coordinates are only needed if no new phase center is used.
+      // Otherwise calculate the UVWs of all baselines for the new center.
       Matrix<double> uvws;
       if (itsCenter.empty()) {
         uvws.reference (itsInput->fetchUVW (buf, itsBuffer, itsTimer));
+      } else {
+        NSTimer::StartStop ssuvwtimer(itsUVWTimer);
+        uvws.resize (3, nrbl);
+        itsUVWCalc.getUVWs (getInfo().getAnt1(), getInfo().getAnt2(),
+                            buf.getTime(), uvws.data());
       }
       const double* uvwPtr = uvws.data();
       bool* flagPtr = flags.data();
       const bool* origPtr = buf.getFlags().data();
       for (uint i=0; i<nrbl; ++i) {
-        if (! itsCenter.empty()) {
-          // A different phase center is given, so calculate UVW for it.
-          NSTimer::StartStop ssuvwtimer(itsUVWTimer);
-          Vector<double> uvw = itsUVWCalc.getUVW (getInfo().getAnt1()[i],
-                                                  getInfo().getAnt2()[i],
-                                                  buf.getTime());
-          uvwPtr = uvw.data();
-          ///cout << "uvw = " << uvw << endl;
-        }
         double uvdist = uvwPtr[0] * uvwPtr[0] + uvwPtr[1] * uvwPtr[1];
         bool flagBL = false;
         if (! itsRangeUVm.empty()) {
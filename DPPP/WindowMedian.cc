@@ -0,0 +1,240 @@
+//# WindowMedian.cc: Medians in a window sliding along the channels
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include "WindowMedian.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace DP3 {
+  namespace DPPP {
+
+    WindowMedian::WindowMedian()
+      : itsNChan      (0),
+        itsStride     (1),
+        itsHalfWindow (0),
+        itsChan       (-1),
+        itsCount      (0),
+        itsTopBit     (0)
+    {}
+
+    void WindowMedian::init (const std::vector<const float*>& data,
+                             const std::vector<const bool*>& flags,
+                             int nchan, int stride, int freqWindow)
+    {
+      assert (data.size() == flags.size());
+      itsData       = data;
+      itsFlags      = flags;
+      itsNChan      = nchan;
+      itsStride     = stride;
+      itsHalfWindow = freqWindow/2;
+      itsChan       = -1;
+      itsCount      = 0;
+      // Rank the values of all rows and channels.
+      // A NaN is ordered after all other values to have a valid ordering.
+      const unsigned int nval = data.size() * nchan;
+      itsOrder.resize (nval);
+      for (unsigned int r=0; r<data.size(); ++r) {
+        for (int ch=0; ch<nchan; ++ch) {
+          const float value = data[r][ch*stride];
+          itsOrder[r*nchan + ch] = std::make_pair
+            (std::isnan(value) ? std::numeric_limits<float>::infinity() : value,
+             r*nchan + ch);
+        }
+      }
+      std::sort (itsOrder.begin(), itsOrder.end(),
+                 [](const std::pair<float,unsigned int>& x,
+                    const std::pair<float,unsigned int>& y)
+                 { return x.first < y.first; });
+      itsSorted.resize (nval);
+      itsRank.resize (nval);
+      for (unsigned int i=0; i<nval; ++i) {
+        const unsigned int inx = itsOrder[i].second;
+        itsSorted[i] = itsData[inx / nchan][(inx % nchan) * stride];
+        itsRank[inx] = i;
+      }
+      itsTree.assign (nval+1, 0);
+      itsTopBit = 1;
+      while (2*itsTopBit <= nval) {
+        itsTopBit *= 2;
+      }
+      itsPresent.assign (nval, 0);
+      itsMult.assign (nchan, 0);
+      itsDelta.assign (nchan, 0);
+      itsChanged.clear();
+    }
+
+    void WindowMedian::windowRanges (int chan, int halfWindow, int nchan,
+                                     int& s1, int& e1, int& s2, int& e2)
+    {
+      // At the beginning or end of the window the values are wrapped.
+      // So we might need to move in two parts.
+      // This little piece of code is tested in tMirror.cc.
+      s1 = chan - halfWindow;
+      e1 = chan + halfWindow + 1;
+      s2 = 1;
+      e2 = 1;
+      if (s1 < 0) {
+        e2 = -s1 + 1;
+        s1 = 0;
+      } else if (e1 > nchan) {
+        s2 = nchan + nchan - e1 - 1; // e1-nchan+1 too far, go back that amount
+        e2 = nchan-1;
+        e1 = nchan;
+      }
+    }
+
+    void WindowMedian::move (int chan)
+    {
+      int s1, e1, s2, e2;
+      // Determine how often each channel leaves or enters the window.
+      if (itsChan >= 0) {
+        windowRanges (itsChan, itsHalfWindow, itsNChan, s1, e1, s2, e2);
+        for (int ch=s1; ch<e1; ++ch) {
+          itsDelta[ch]--;
+          itsChanged.push_back (ch);
+        }
+        for (int ch=s2; ch<e2; ++ch) {
+          itsDelta[ch]--;
+          itsChanged.push_back (ch);
+        }
+      }
+      windowRanges (chan, itsHalfWindow, itsNChan, s1, e1, s2, e2);
+      for (int ch=s1; ch<e1; ++ch) {
+        itsDelta[ch]++;
+        itsChanged.push_back (ch);
+      }
+      for (int ch=s2; ch<e2; ++ch) {
+        itsDelta[ch]++;
+        itsChanged.push_back (ch);
+      }
+      for (int ch : itsChanged) {
+        if (itsDelta[ch] != 0) {
+          addChannel (ch, itsDelta[ch]);
+          itsDelta[ch] = 0;
+        }
+      }
+      itsChanged.clear();
+      itsChan = chan;
+    }
+
+    void WindowMedian::addChannel (int chan, int delta)
+    {
+      const int mult = itsMult[chan];
+      for (unsigned int r=0; r<itsData.size(); ++r) {
+        const unsigned int inx = r*itsNChan + chan;
+        // The flag is only taken into account when entering the window.
+        if (mult == 0) {
+          itsPresent[inx] = !itsFlags[r][chan*itsStride];
+        }
+        if (itsPresent[inx]) {
+          add (itsRank[inx], delta);
+          if (mult + delta == 0) {
+            itsPresent[inx] = 0;
+          }
+        }
+      }
+      itsMult[chan] = mult + delta;
+    }
+
+    void WindowMedian::updateFlags (int chan)
+    {
+      const int mult = itsMult[chan];
+      for (unsigned int r=0; r<itsData.size(); ++r) {
+        const unsigned int inx = r*itsNChan + chan;
+        if (itsPresent[inx]  &&  itsFlags[r][chan*itsStride]) {
+          add (itsRank[inx], -mult);
+          itsPresent[inx] = 0;
+        }
+      }
+    }
+
+    void WindowMedian::add (unsigned int rank, int count)
+    {
+      itsCount += count;
+      for (unsigned int i=rank+1; i<itsTree.size(); i+=(i & -i)) {
+        itsTree[i] += count;
+      }
+    }
+
+    float WindowMedian::kth (unsigned int k) const
+    {
+      // Find the highest position with at most k values before it.
+      unsigned int pos = 0;
+      for (unsigned int bit=itsTopBit; bit>0; bit/=2) {
+        const unsigned int next = pos + bit;
+        if (next < itsTree.size()  &&  itsTree[next] <= int(k)) {
+          pos = next;
+          k -= itsTree[next];
+        }
+      }
+      return itsSorted[pos];
+    }
+
+    void WindowMedian::getMedians (float& Z1, float& Z2) const
+    {
+      // If only flagged data, don't do anything.
+      if (itsCount == 0) {
+        Z1 = -1.0;
+        Z2 = 0.0;
+        return;
+      }
+      // The median is the element in the middle (as kthLargest with np/2).
+      const unsigned int k = itsCount/2;
+      Z1 = kth(k);
+      // The distances of the values below the median (in increasing order)
+      // and above the median form two sorted sequences. The MAD is the k-th
+      // smallest of their union and the 0 of the median itself.
+      const unsigned int nlow  = k;
+      const unsigned int nhigh = itsCount - k - 1;
+      auto low  = [&](unsigned int i) { return Z1 - kth(k-1-i); };
+      auto high = [&](unsigned int i) { return kth(k+1+i) - Z1; };
+      if (k == 0) {
+        Z2 = 0.0;
+        return;
+      }
+      // Find how many (i) of the k smallest distances are below the median.
+      unsigned int lo = (k > nhigh ? k - nhigh : 0);
+      unsigned int hi = std::min (k, nlow);
+      while (true) {
+        const unsigned int i = (lo + hi) / 2;
+        const unsigned int j = k - i;
+        if (i < nlow  &&  j > 0  &&  high(j-1) > low(i)) {
+          lo = i + 1;
+        } else if (i > 0  &&  j < nhigh  &&  low(i-1) > high(j)) {
+          hi = i - 1;
+        } else {
+          if (i == 0) {
+            Z2 = high(j-1);
+          } else if (j == 0) {
+            Z2 = low(i-1);
+          } else {
+            Z2 = std::max (low(i-1), high(j-1));
+          }
+          return;
+        }
+      }
+    }
+
+  } //# end namespace
+}
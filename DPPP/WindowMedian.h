@@ -0,0 +1,118 @@
+//# WindowMedian.h: Medians in a window sliding along the channels
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#ifndef DPPP_WINDOWMEDIAN_H
+#define DPPP_WINDOWMEDIAN_H
+
+// @file
+// @brief Medians in a window sliding along the channels
+
+#include <utility>
+#include <vector>
+
+namespace DP3 {
+  namespace DPPP {
+
+    // @ingroup NDPPP
+
+    // This class calculates the median and the median of the absolute
+    // difference with the median (MAD) of the unflagged values in a
+    // time/frequency window, like MedFlagger::computeFactors does. It is
+    // used when the window slides along the channels of a baseline and
+    // correlation. Neighbouring windows share all but a few channels, so
+    // the values are added to and removed from the window incrementally
+    // instead of selecting the medians of the full window again.
+    //
+    // The values of all time rows are ranked once in init. The window is
+    // kept as a Fenwick tree of counts per rank, so adding or removing a
+    // value and finding the k-th smallest value are O(log N) operations.
+    // The MAD is the k-th smallest of the distances below and above the
+    // median, which are two sorted sequences, so it is found by a binary
+    // search in O(log^2 N).
+    //
+    // The channels at the edges are mirrored in the same way as done in
+    // MedFlagger (see windowRanges), so a channel can be in the window twice.
+    // The flags are only read when a value enters the window and by
+    // updateFlags, which has to be called for the channel last moved to
+    // when its flags have been set.
+
+    class WindowMedian
+    {
+    public:
+      WindowMedian();
+
+      // Set the time rows to use. data[i] and flags[i] point to channel 0
+      // of row i; the channels are stride elements apart.
+      // The window is empty after init.
+      void init (const std::vector<const float*>& data,
+                 const std::vector<const bool*>& flags,
+                 int nchan, int stride, int freqWindow);
+
+      // Move the window to be centered around the given channel.
+      void move (int chan);
+
+      // Remove the values of the given channel that have been flagged
+      // after they entered the window.
+      void updateFlags (int chan);
+
+      // Get the median (Z1) and MAD (Z2) of the values in the window.
+      // Z1=-1 and Z2=0 are returned if the window contains no values.
+      void getMedians (float& Z1, float& Z2) const;
+
+      // Get the channel ranges [s1,e1> and [s2,e2> in the window for the
+      // given channel. The second range is the mirrored part at the edges
+      // (which is empty if s2==e2).
+      static void windowRanges (int chan, int halfWindow, int nchan,
+                                int& s1, int& e1, int& s2, int& e2);
+
+    private:
+      // Add count times the value with the given rank.
+      void add (unsigned int rank, int count);
+
+      // Get the k-th smallest (0-based) value in the window.
+      float kth (unsigned int k) const;
+
+      // Change the number of times a channel is in the window.
+      void addChannel (int chan, int delta);
+
+      //# Data members.
+      std::vector<const float*> itsData;
+      std::vector<const bool*>  itsFlags;
+      int                       itsNChan;
+      int                       itsStride;
+      int                       itsHalfWindow;
+      int                       itsChan;      //# current center channel
+      unsigned int              itsCount;     //# nr of values in window
+      unsigned int              itsTopBit;    //# highest power of 2 <= N
+      std::vector<std::pair<float,unsigned int> > itsOrder; //# for ranking
+      std::vector<unsigned int> itsRank;      //# rank of each row,channel
+      std::vector<float>        itsSorted;    //# value of each rank
+      std::vector<int>          itsTree;      //# Fenwick tree of counts
+      std::vector<char>         itsPresent;   //# is row,channel in window?
+      std::vector<int>          itsMult;      //# times channel in window
+      std::vector<int>          itsDelta;     //# change of itsMult in move
+      std::vector<int>          itsChanged;   //# channels changed in move
+    };
+
+  } //# end namespace
+}
+
+#endif
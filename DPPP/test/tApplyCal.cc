@@ -32,6 +32,7 @@
 #include <casa/Arrays/ArrayMath.h>
 #include <casa/Arrays/ArrayLogical.h>
 #include <casa/Arrays/ArrayIO.h>
+#include <algorithm>
 #include <iostream>
 
 using namespace LOFAR;
@@ -254,6 +255,28 @@ private:
   int itsNTime, itsNBl, itsNChan, itsNCorr, itsTimeInterval, itsDoTest;
 };
 
+// Class to keep a copy of the buffers it gets.
+class Collector: public DPStep
+{
+public:
+  explicit Collector(vector<DPBuffer>& bufs)
+    : itsBufs(bufs)
+  {}
+private:
+  virtual bool process (const DPBuffer& buf)
+  {
+    DPBuffer copy;
+    copy.copy (buf);
+    itsBufs.push_back (copy);
+    return true;
+  }
+
+  virtual void finish() {}
+  virtual void show (std::ostream&) const {}
+
+  vector<DPBuffer>& itsBufs;
+};
+
 
 // Execute steps.
 void execute (const DPStep::ShPtr& step1)
@@ -335,6 +358,56 @@ void testgain(int ntime, int nchan)
   execute (step1);
 }
 
+// Test that processBatch gives the same result as process per time slot.
+// The batches do not align with the parameter updates.
+void testbatch(int ntime, int nchan, int batchSize)
+{
+  cout << "testbatch: ntime=" << ntime << " nchan=" << nchan
+       << " batchsize=" << batchSize << endl;
+  // Collect the input buffers.
+  TestInput* in = new TestInput(ntime, nchan);
+  DPStep::ShPtr step1(in);
+  vector<DPBuffer> inBufs;
+  step1->setNextStep (DPStep::ShPtr(new Collector(inBufs)));
+  step1->setInfo (DPInfo());
+  DPBuffer buf;
+  while (step1->process(buf));
+  step1->finish();
+
+  ParameterSet parset1;
+  parset1.add ("correction", "gain");
+  parset1.add ("parmdb", "tApplyCal_tmp.parmdb");
+  parset1.add ("timeslotsperparmupdate", "5");
+  parset1.add ("updateweights", "true");
+  vector<DPBuffer> outBufs[2];
+  for (int batch=0; batch<2; ++batch) {
+    DPStep::ShPtr step2(new ApplyCal(in, parset1, ""));
+    step2->setNextStep (DPStep::ShPtr(new Collector(outBufs[batch])));
+    step2->setInfo (in->getInfo());
+    if (batch) {
+      for (int i=0; i<ntime; i+=batchSize) {
+        vector<DPBuffer> bufs (inBufs.begin() + i,
+                               inBufs.begin() + std::min(i+batchSize, ntime));
+        step2->processBatch (bufs);
+      }
+    } else {
+      for (const DPBuffer& inBuf : inBufs) {
+        step2->process (inBuf);
+      }
+    }
+    step2->finish();
+  }
+  ASSERT (int(outBufs[0].size()) == ntime);
+  ASSERT (outBufs[1].size() == outBufs[0].size());
+  for (int i=0; i<ntime; ++i) {
+    ASSERT (allNear (outBufs[1][i].getData(), outBufs[0][i].getData(),
+                     1.e-7));
+    ASSERT (allNear (outBufs[1][i].getWeights(), outBufs[0][i].getWeights(),
+                     1.e-7));
+    ASSERT (allEQ (outBufs[1][i].getFlags(), outBufs[0][i].getFlags()));
+  }
+}
+
 
 int main()
 {
@@ -342,6 +415,7 @@ int main()
   try {
     testclocktec (10,  32);
     testgain (10, 32);
+    testbatch (10, 32, 3);
   } catch (std::exception& x) {
     cout << "Unexpected exception: " << x.what() << endl;
    return 1;
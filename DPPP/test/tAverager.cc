@@ -441,6 +441,39 @@ private:
 };
 
 
+// Class to give the time slots in batches to the next step.
+class TestBatcher: public DPStep
+{
+public:
+  TestBatcher(uint batchSize)
+    : itsBatchSize(batchSize)
+  {}
+private:
+  virtual bool process (const DPBuffer& buf)
+  {
+    itsBatch.emplace_back();
+    itsBatch.back().copy (buf);
+    if (itsBatch.size() == itsBatchSize) {
+      getNextStep()->processBatch (itsBatch);
+      itsBatch.clear();
+    }
+    return true;
+  }
+
+  virtual void finish()
+  {
+    if (! itsBatch.empty()) {
+      getNextStep()->processBatch (itsBatch);
+    }
+    getNextStep()->finish();
+  }
+  virtual void show (std::ostream&) const {}
+
+  uint itsBatchSize;
+  vector<DPBuffer> itsBatch;
+};
+
+
 // Execute steps.
 void execute (const DPStep::ShPtr& step1)
 {
@@ -473,6 +506,30 @@ void test1(int ntime, int nbl, int nchan, int ncorr,
   execute (step1);
 }
 
+// Like test 1, but give the time slots in batches to the Averager.
+void test1batch(int ntime, int nbl, int nchan, int ncorr,
+                int navgtime, int navgchan, uint batchSize)
+{
+  cout << "test1batch: ntime=" << ntime << " nrbl=" << nbl
+       << " nchan=" << nchan << " ncorr=" << ncorr
+       << " navgtime=" << navgtime << " navgchan=" << navgchan
+       << " batchsize=" << batchSize << endl;
+  // Create the steps.
+  TestInput* in = new TestInput(ntime, nbl, nchan, ncorr, false);
+  DPStep::ShPtr step1(in);
+  DPStep::ShPtr step2(new TestBatcher(batchSize));
+  ParameterSet parset;
+  parset.add ("freqstep", toString(navgchan));
+  parset.add ("timestep", toString(navgtime));
+  DPStep::ShPtr step3(new Averager(in, parset, ""));
+  DPStep::ShPtr step4(new TestOutput(ntime, nbl, nchan, ncorr,
+                                     navgtime, navgchan, false));
+  step1->setNextStep (step2);
+  step2->setNextStep (step3);
+  step3->setNextStep (step4);
+  execute (step1);
+}
+
 // Like test 1, but specify target resolution
 void test1resolution(int ntime, int nbl, int nchan, int ncorr,
                      double timeresolution, double freqresolution,
@@ -605,6 +662,9 @@ int main()
     test1(11, 3, 30, 2, 3, 3, false);
     test1(10, 3, 32, 4, 1, 32, false);
     test1(10, 3, 32, 1, 1, 1, false);
+    test1batch(10, 3, 32, 4, 2, 4, 3);
+    test1batch(11, 3, 30, 2, 3, 3, 4);
+    test1batch(10, 3, 32, 1, 1, 1, 4);
 
     test1resolution(10, 3, 32, 4, 10., 100000, "Hz", false);
     test1resolution(11, 3, 32, 4, 1., 800, "kHz", false);
@@ -0,0 +1,168 @@
+//# tDPBufferPool.cc: Test program for class DPBufferPool
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#include <lofar_config.h>
+#include <DPPP/DPBufferPool.h>
+
+#include <casacore/casa/Arrays/ArrayLogical.h>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace DP3::DPPP;
+using namespace casacore;
+using namespace std;
+
+bool isAligned (const void* ptr)
+{
+  return reinterpret_cast<uintptr_t>(ptr) % 64 == 0;
+}
+
+// Test that the arrays have the right shape and alignment.
+void testGet()
+{
+  DPBufferPool& pool = DPBufferPool::instance();
+  pool.clear();
+  IPosition shape(3, 4, 7, 5);
+  {
+    DPBuffer buf = pool.get (shape, true, true);
+    assert (buf.getData().shape() == shape);
+    assert (buf.getFlags().shape() == shape);
+    assert (buf.getWeights().shape() == shape);
+    assert (buf.getUVW().shape() == IPosition(2, 3, 5));
+    assert (isAligned (buf.getData().data()));
+    assert (isAligned (buf.getFlags().data()));
+    assert (isAligned (buf.getWeights().data()));
+    assert (isAligned (buf.getUVW().data()));
+    assert (pool.size() == 1  &&  pool.nused() == 1);
+  }
+  assert (pool.size() == 1  &&  pool.nused() == 0);
+  {
+    // Without weights and uvw another buffer is needed.
+    DPBuffer buf = pool.get (shape);
+    assert (buf.getWeights().empty()  &&  buf.getUVW().empty());
+    assert (isAligned (buf.getData().data()));
+    assert (pool.nused() == 1);
+  }
+}
+
+// Test that the arrays are recycled only if the pool holds the only
+// reference.
+void testRecycle()
+{
+  DPBufferPool& pool = DPBufferPool::instance();
+  pool.clear();
+  IPosition shape(3, 4, 3, 6);
+  const Complex* data;
+  {
+    DPBuffer buf = pool.get (shape);
+    data = buf.getData().data();
+  }
+  // The released arrays are handed out again.
+  DPBuffer buf1 = pool.get (shape);
+  assert (buf1.getData().data() == data);
+  assert (pool.size() == 1  &&  pool.nused() == 1);
+  // A buffer in use is not handed out, also not if only an array
+  // is still referenced.
+  Cube<Complex> dataRef (buf1.getData());
+  buf1 = DPBuffer();
+  assert (pool.nused() == 1);
+  DPBuffer buf2 = pool.get (shape);
+  assert (buf2.getData().data() != data);
+  assert (pool.size() == 2  &&  pool.nused() == 2);
+  // A moved buffer keeps the arrays in use; the source does not.
+  DPBuffer buf3 (std::move(buf2));
+  assert (buf2.getData().empty());
+  assert (pool.nused() == 2);
+  dataRef.reference (Cube<Complex>());
+  assert (pool.nused() == 1);
+  DPBuffer buf4 = pool.get (shape);
+  assert (buf4.getData().data() == data);
+  // Getting another shape releases the free buffers of other shapes.
+  buf3 = DPBuffer();
+  buf4 = DPBuffer();
+  DPBuffer buf5 = pool.get (IPosition(3, 2, 3, 6));
+  assert (pool.size() == 1  &&  pool.nused() == 1);
+}
+
+// Test that copy makes a deep copy in pooled arrays.
+void testCopy()
+{
+  DPBufferPool& pool = DPBufferPool::instance();
+  pool.clear();
+  IPosition shape(3, 4, 2, 3);
+  DPBuffer in;
+  in.setData (Cube<Complex> (shape, Complex(1,2)));
+  in.setFlags (Cube<bool> (shape, true));
+  in.setTime (3.5);
+  DPBuffer out = pool.copy (in);
+  assert (out.getTime() == 3.5);
+  assert (allEQ (out.getData(), Complex(1,2)));
+  assert (allEQ (out.getFlags(), true));
+  assert (out.getWeights().empty()  &&  out.getUVW().empty());
+  assert (isAligned (out.getData().data()));
+  in.getData() = Complex(3,4);
+  assert (allEQ (out.getData(), Complex(1,2)));
+  assert (pool.size() == 1  &&  pool.nused() == 1);
+}
+
+// Test getting and releasing buffers in several threads at the same time.
+// Each thread fills its buffers with its own value and checks they are
+// not changed, so a buffer handed out twice is detected.
+void testConcurrent()
+{
+  DPBufferPool& pool = DPBufferPool::instance();
+  pool.clear();
+  const uint nthread = 8;
+  IPosition shape(3, 4, 16, 10);
+  vector<thread> threads;
+  for (uint i=0; i<nthread; ++i) {
+    threads.emplace_back ([&pool, &shape, i]() {
+      for (uint j=0; j<200; ++j) {
+        DPBuffer buf = pool.get (shape, true);
+        buf.getData() = Complex(i, j);
+        buf.getWeights() = float(i);
+        this_thread::yield();
+        assert (allEQ (buf.getData(), Complex(i, j)));
+        assert (allEQ (buf.getWeights(), float(i)));
+      }
+    });
+  }
+  for (thread& thr : threads) {
+    thr.join();
+  }
+  assert (pool.nused() == 0);
+  assert (pool.size() <= nthread);
+}
+
+int main()
+{
+  testGet();
+  testRecycle();
+  testCopy();
+  testConcurrent();
+  cout << "tDPBufferPool OK" << endl;
+  return 0;
+}
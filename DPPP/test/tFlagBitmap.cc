@@ -0,0 +1,98 @@
+//# tFlagBitmap.cc: Test program for class FlagBitmap
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+
+#include <lofar_config.h>
+#include <DPPP/FlagBitmap.h>
+
+#include <casacore/casa/Arrays/ArrayLogical.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+using namespace DP3::DPPP;
+using namespace casacore;
+using namespace std;
+
+// Test the conversions and operations for the given sizes.
+void test (uint ncorr, uint nchan, uint nbl)
+{
+  // Make flags which are equal for all correlations.
+  Cube<bool> flags (ncorr, nchan, nbl);
+  uint64_t nset = 0;
+  for (uint bl=0; bl<nbl; ++bl) {
+    for (uint ch=0; ch<nchan; ++ch) {
+      bool flag = (rand()%3 == 0);
+      nset += flag;
+      for (uint corr=0; corr<ncorr; ++corr) {
+        flags(corr,ch,bl) = flag;
+      }
+    }
+  }
+  FlagBitmap bitmap;
+  bitmap.fromCube (flags);
+  assert (bitmap.nchan() == nchan  &&  bitmap.nbaselines() == nbl);
+  assert (bitmap.count() == nset);
+  uint64_t nbl0 = 0;
+  for (uint bl=0; bl<nbl; ++bl) {
+    uint nr = 0;
+    for (uint ch=0; ch<nchan; ++ch) {
+      assert (bitmap.get(ch,bl) == flags(0,ch,bl));
+      nr += flags(0,ch,bl);
+    }
+    assert (bitmap.countBaseline(bl) == nr);
+    nbl0 += nr;
+  }
+  assert (nbl0 == nset);
+  Cube<bool> result;
+  bitmap.toCube (result, ncorr);
+  assert (allEQ (result, flags));
+  // Test the logical operations.
+  FlagBitmap all (nchan, nbl);
+  assert (all.count() == 0);
+  all.setAll (true);
+  assert (all.count() == uint64_t(nchan)*nbl);
+  FlagBitmap copy (bitmap);
+  copy &= all;
+  assert (copy.count() == nset);
+  copy |= all;
+  assert (copy.count() == uint64_t(nchan)*nbl);
+  copy.andNot (bitmap);
+  assert (copy.count() == uint64_t(nchan)*nbl - nset);
+  if (nchan > 0  &&  nbl > 0) {
+    copy.set (nchan-1, nbl-1);
+    assert (copy.get (nchan-1, nbl-1));
+    copy.clear (nchan-1, nbl-1);
+    assert (! copy.get (nchan-1, nbl-1));
+  }
+}
+
+int main()
+{
+  uint nchans[] = {0, 1, 63, 64, 65, 130};
+  for (uint nchan : nchans) {
+    test (4, nchan, 3);
+    test (1, nchan, 5);
+  }
+  cout << "tFlagBitmap OK" << endl;
+  return 0;
+}
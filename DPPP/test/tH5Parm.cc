@@ -1,4 +1,5 @@
 #include <DPPP/H5Parm.h>
+#include <DPPP/SolTabCache.h>
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
@@ -188,6 +189,34 @@ int main(int, char**) {
           ASSERT(casa::near(newgridvals[idx++], min(double((time+1)/3),double(ntimes-1))));
         }
       }
+
+      cout<<"Checking interpolation from the in-memory copy"<<endl;
+      SolTabCache cache(soltab, freqs);
+      for (size_t ant=1; ant<=3; ++ant) {
+        stringstream antNameStr;
+        antNameStr<<"Antenna"<<ant;
+        ASSERT(cache.getValuesOrWeights("val", antNameStr.str(),
+                                        times, freqs, 0, 0) ==
+               soltab.getValuesOrWeights("val", antNameStr.str(),
+                                         times, freqs, 0, 0));
+        vector<double> cachedweights =
+          cache.getValuesOrWeights("weight", antNameStr.str(),
+                                   times, freqs, 0, 0);
+        for (size_t i=0; i<cachedweights.size(); ++i) {
+          ASSERT(casa::near(cachedweights[i], 0.4));
+        }
+      }
+
+      cout<<"Checking sharing of the in-memory copies"<<endl;
+      SolTabCache::ShPtr shared1 =
+        SolTabCache::get("tH5Parm_tmp.h5", "sol000", soltab, freqs);
+      SolTabCache::ShPtr shared2 =
+        SolTabCache::get("tH5Parm_tmp.h5", "sol000", soltab, freqs);
+      ASSERT(shared1 == shared2);
+      // A SolTab with the same name in another SolSet is not shared.
+      SolTabCache::ShPtr shared3 =
+        SolTabCache::get("tH5Parm_tmp.h5", "sol001", soltab, freqs);
+      ASSERT(shared3 != shared1);
       
     }
     // Remove the file
@@ -177,6 +177,96 @@ void testCopy()
   checkCopy ("tNDPPP_tmp.MS", "tNDPPP_tmp.MS1", 1);
 }
 
+// Check that two written MSs have the same main table contents.
+void checkSameMS (const String& ms1, const String& ms2)
+{
+  Table t1(ms1);
+  Table t2(ms2);
+  ASSERT (t1.nrow() == t2.nrow());
+  ASSERT (allEQ(ROArrayColumn<Complex>(t1,"DATA").getColumn(),
+                ROArrayColumn<Complex>(t2,"DATA").getColumn()));
+  ASSERT (allEQ(ROArrayColumn<Bool>(t1,"FLAG").getColumn(),
+                ROArrayColumn<Bool>(t2,"FLAG").getColumn()));
+  ASSERT (allEQ(ROArrayColumn<uChar>(t1,"LOFAR_FULL_RES_FLAG").getColumn(),
+                ROArrayColumn<uChar>(t2,"LOFAR_FULL_RES_FLAG").getColumn()));
+  ASSERT (allEQ(ROArrayColumn<float>(t1,"WEIGHT_SPECTRUM").getColumn(),
+                ROArrayColumn<float>(t2,"WEIGHT_SPECTRUM").getColumn()));
+  ASSERT (allEQ(ROArrayColumn<double>(t1,"UVW").getColumn(),
+                ROArrayColumn<double>(t2,"UVW").getColumn()));
+  ASSERT (allEQ(ROScalarColumn<double>(t1,"TIME").getColumn(),
+                ROScalarColumn<double>(t2,"TIME").getColumn()));
+  ASSERT (allEQ(ROScalarColumn<Int>(t1,"ANTENNA1").getColumn(),
+                ROScalarColumn<Int>(t2,"ANTENNA1").getColumn()));
+  ASSERT (allEQ(ROScalarColumn<Int>(t1,"ANTENNA2").getColumn(),
+                ROScalarColumn<Int>(t2,"ANTENNA2").getColumn()));
+}
+
+void testCopyBatch()
+{
+  cout << endl << "** testCopyBatch **" << endl;
+  // First write the MS one time slot at a time (process).
+  {
+    ofstream ostr("tNDPPP_tmp.parset");
+    ostr << "msin=tNDPPP_tmp.MS" << endl;
+    ostr << "msin.starttime=03-Aug-2000/13:21:45" << endl;
+    ostr << "msin.endtime=03-Aug-2000/13:33:15" << endl;
+    ostr << "msout=tNDPPP_tmp.MS1p" << endl;
+    ostr << "msout.overwrite=true" << endl;
+    ostr << "steps=[]" << endl;
+  }
+  DPRun::execute ("tNDPPP_tmp.parset");
+  // The writer gets batches of 5 time slots (the last one has 4), so it
+  // writes several merged batches. In the second run a queue in front of
+  // the writer combines the time slots it has queued.
+  // Both are done without and with reading ahead.
+  for (int writeBehind=0; writeBehind<=3; writeBehind+=3) {
+    for (int readAhead=0; readAhead<=2; readAhead+=2) {
+      {
+        ofstream ostr("tNDPPP_tmp.parset");
+        ostr << "msin=tNDPPP_tmp.MS" << endl;
+        ostr << "msin.starttime=03-Aug-2000/13:21:45" << endl;
+        ostr << "msin.endtime=03-Aug-2000/13:33:15" << endl;
+        ostr << "batchsize=5" << endl;
+        ostr << "msin.readahead=" << readAhead << endl;
+        ostr << "msout=tNDPPP_tmp.MS1c" << endl;
+        ostr << "msout.overwrite=true" << endl;
+        ostr << "msout.writebehind=" << writeBehind << endl;
+        ostr << "steps=[]" << endl;
+      }
+      DPRun::execute ("tNDPPP_tmp.parset");
+      checkCopy ("tNDPPP_tmp.MS", "tNDPPP_tmp.MS1c", 1);
+      checkSameMS ("tNDPPP_tmp.MS1p", "tNDPPP_tmp.MS1c");
+    }
+  }
+}
+
+void testPipelined()
+{
+  cout << endl << "** testPipelined **" << endl;
+  // Run the same steps without and with pipelining. The queues between
+  // the steps must not change the result.
+  for (int pipelined=0; pipelined<2; ++pipelined) {
+    {
+      ofstream ostr("tNDPPP_tmp.parset");
+      ostr << "msin=tNDPPP_tmp.MS" << endl;
+      ostr << "msout=" << (pipelined ? "tNDPPP_tmp.MS1q" : "tNDPPP_tmp.MS1s")
+           << endl;
+      ostr << "msout.overwrite=true" << endl;
+      ostr << "pipelined=" << (pipelined ? "true" : "false") << endl;
+      ostr << "pipelinequeuesize=2" << endl;
+      ostr << "steps=[preflag,madflag,average]" << endl;
+      ostr << "preflag.timeslot=[10,11]" << endl;
+      ostr << "madflag.timewindow=5" << endl;
+      ostr << "madflag.freqwindow=3" << endl;
+      ostr << "average.timestep=3" << endl;
+      // The averager runs in the thread of the flagger.
+      ostr << "average.thread=false" << endl;
+    }
+    DPRun::execute ("tNDPPP_tmp.parset");
+  }
+  checkSameMS ("tNDPPP_tmp.MS1s", "tNDPPP_tmp.MS1q");
+}
+
 void testCopyColumn()
 {
   cout << endl << "** testCopyColumn 1 **" << endl;
@@ -218,6 +308,20 @@ void testMultiIn()
   }
   DPRun::execute ("tNDPPP_tmp.parset");
   checkCopy ("tNDPPP_tmp.MS", "tNDPPP_tmp.MS1a", 2);
+  // Reading the MSs in parallel must give the same result as reading
+  // them one by one.
+  for (int nreadthreads=1; nreadthreads<=3; nreadthreads+=2) {
+    {
+      ofstream ostr("tNDPPP_tmp.parset");
+      ostr << "msin=[tNDPPP_tmp.MS1, tNDPPP_tmp.MS1, tNDPPP_tmp.MS1]" << endl;
+      ostr << "msin.nreadthreads=" << nreadthreads << endl;
+      ostr << "msout=tNDPPP_tmp.MS1r" << nreadthreads << endl;
+      ostr << "msout.overwrite=true" << endl;
+      ostr << "steps=[]" << endl;
+    }
+    DPRun::execute ("tNDPPP_tmp.parset");
+  }
+  checkSameMS ("tNDPPP_tmp.MS1r1", "tNDPPP_tmp.MS1r3");
   {
     ofstream ostr("tNDPPP_tmp.parset");
     ostr << "msin=[tNDPPP_tmp.MS1, tNDPPP_tmp.MS1]" << endl;
@@ -1001,6 +1105,8 @@ int main()
   try
   {
     testCopy();
+    testCopyBatch();
+    testPipelined();
     testCopyColumn();
     testMultiIn();
     testAvg1();
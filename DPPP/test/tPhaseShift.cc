@@ -42,10 +42,12 @@ using namespace std;
 // It can only set all flags to true or all false.
 // Weights are always 1.
 // It can be used with different nr of times, channels, etc.
+// The channels are regularly spaced unless irregular is true.
 class TestInput: public DPInput
 {
 public:
-  TestInput(int ntime, int nbl, int nchan, int ncorr, bool flag)
+  TestInput(int ntime, int nbl, int nchan, int ncorr, bool flag,
+            bool irregular=false)
     : itsCount(0), itsNTime(ntime), itsNBl(nbl), itsNChan(nchan),
       itsNCorr(ncorr), itsFlag(flag)
   {
@@ -57,6 +59,11 @@ public:
     Vector<double> chanWidth (nchan, 100000.);
     Vector<double> chanFreqs (nchan);
     indgen (chanFreqs, 1050000., 100000.);
+    if (irregular) {
+      for (int i=0; i<nchan; ++i) {
+        chanFreqs[i] += i*i*1000.;
+      }
+    }
     info().set (chanFreqs, chanWidth);
     // Fill the baseline stations.
     // Determine nr of stations using:  na*(na+1)/2 = nbl
@@ -260,6 +267,28 @@ private:
   bool itsFlag;
 };
 
+// Class to keep a copy of the buffers it gets.
+class Collector: public DPStep
+{
+public:
+  explicit Collector(vector<DPBuffer>& bufs)
+    : itsBufs(bufs)
+  {}
+private:
+  virtual bool process (const DPBuffer& buf)
+  {
+    DPBuffer copy;
+    copy.copy (buf);
+    itsBufs.push_back (copy);
+    return true;
+  }
+
+  virtual void finish() {}
+  virtual void show (std::ostream&) const {}
+
+  vector<DPBuffer>& itsBufs;
+};
+
 
 // Execute steps.
 void execute (const DPStep::ShPtr& step1)
@@ -291,12 +320,14 @@ void test1(int ntime, int nbl, int nchan, int ncorr, bool flag)
 }
 
 // Test with a shift to another and then to the original phase center.
-void test2(int ntime, int nbl, int nchan, int ncorr, bool flag)
+void test2(int ntime, int nbl, int nchan, int ncorr, bool flag,
+           bool irregular=false)
 {
   cout << "test2: ntime=" << ntime << " nrbl=" << nbl << " nchan=" << nchan
-       << " ncorr=" << ncorr << " flag=" << flag << endl;
+       << " ncorr=" << ncorr << " flag=" << flag
+       << " irregular=" << irregular << endl;
   // Create the steps.
-  TestInput* in = new TestInput(ntime, nbl, nchan, ncorr, flag);
+  TestInput* in = new TestInput(ntime, nbl, nchan, ncorr, flag, irregular);
   DPStep::ShPtr step1(in);
   // First shift to another center, then back to original.
   ParameterSet parset;
@@ -314,6 +345,45 @@ void test2(int ntime, int nbl, int nchan, int ncorr, bool flag)
   execute (step1);
 }
 
+// Test that processBatch gives the same result as process per time slot.
+void test3(int ntime, int nbl, int nchan, int ncorr, bool irregular=false)
+{
+  cout << "test3: ntime=" << ntime << " nrbl=" << nbl << " nchan=" << nchan
+       << " ncorr=" << ncorr << " irregular=" << irregular << endl;
+  // Collect the input buffers.
+  TestInput* in = new TestInput(ntime, nbl, nchan, ncorr, false, irregular);
+  DPStep::ShPtr step1(in);
+  vector<DPBuffer> inBufs;
+  step1->setNextStep (DPStep::ShPtr(new Collector(inBufs)));
+  execute (step1);
+  ParameterSet parset;
+  parset.add ("phasecenter", "[50deg, 35deg]");
+  vector<DPBuffer> outBufs[2];
+  for (int batch=0; batch<2; ++batch) {
+    DPStep::ShPtr step2(new PhaseShift(in, parset, ""));
+    step2->setNextStep (DPStep::ShPtr(new Collector(outBufs[batch])));
+    step2->setInfo (in->getInfo());
+    if (batch) {
+      step2->processBatch (inBufs);
+    } else {
+      for (const DPBuffer& buf : inBufs) {
+        step2->process (buf);
+      }
+    }
+    step2->finish();
+  }
+  ASSERT (int(outBufs[0].size()) == ntime);
+  ASSERT (outBufs[1].size() == outBufs[0].size());
+  for (int i=0; i<ntime; ++i) {
+    ASSERT (allNear(real(outBufs[1][i].getData()),
+                    real(outBufs[0][i].getData()), 1e-6));
+    ASSERT (allNear(imag(outBufs[1][i].getData()),
+                    imag(outBufs[0][i].getData()), 1e-6));
+    ASSERT (allNear(outBufs[1][i].getUVW(), outBufs[0][i].getUVW(), 1e-10));
+    ASSERT (near(outBufs[1][i].getTime(), outBufs[0][i].getTime()));
+  }
+}
+
 
 int main()
 {
@@ -322,6 +392,11 @@ int main()
     test1(10, 10, 30, 1, true);
     test2(10, 6, 32, 4, false);
     test2(10, 6, 30, 1, true);
+    // More channels than a phasor recurrence chunk.
+    test2(4, 6, 150, 4, false);
+    test2(4, 6, 150, 2, false, true);
+    test3(5, 6, 32, 4);
+    test3(3, 10, 150, 2, true);
   } catch (std::exception& x) {
     cout << "Unexpected exception: " << x.what() << endl;
     return 1;
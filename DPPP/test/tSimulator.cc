@@ -0,0 +1,238 @@
+//# tSimulator.cc: Test program for class Simulator
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <DPPP/Simulator.h>
+#include <DPPP/GaussianSource.h>
+#include <DPPP/PointSource.h>
+
+#include <casacore/casa/BasicSL/Constants.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace DP3::DPPP;
+using namespace casacore;
+using namespace std;
+
+const size_t nStation = 5;
+const Position reference (0.5, 0.8);
+
+// Make ncomp components around the reference position. Every third one is
+// a Gaussian source if withGaussians is true.
+vector<ModelComponent::ConstPtr> makeComponents (size_t ncomp,
+                                                 bool withGaussians)
+{
+  vector<ModelComponent::ConstPtr> components;
+  for (size_t i=0; i<ncomp; ++i) {
+    Position position (reference[0] + 0.002*(i%7) - 0.006,
+                       reference[1] + 0.003*(i%5) - 0.006);
+    Stokes stokes;
+    stokes.I = 1 + 0.1*i;
+    stokes.Q = 0.05*(i%3);
+    stokes.U = 0.02*(i%4);
+    stokes.V = 0.01*(i%2);
+    if (withGaussians  &&  i%3 == 0) {
+      GaussianSource::Ptr source (new GaussianSource(position, stokes));
+      source->setMajorAxis (1e-3 + 1e-4*(i%4));
+      source->setMinorAxis (5e-4);
+      source->setPositionAngle (0.3*i);
+      components.push_back (source);
+    } else {
+      components.push_back (PointSource::Ptr(new PointSource(position,
+                                                             stokes)));
+    }
+  }
+  return components;
+}
+
+// Make nchan frequencies around 150 MHz; the channel widths differ slightly
+// if irregular is true.
+Vector<double> makeFreqs (size_t nchan, bool irregular)
+{
+  Vector<double> freqs(nchan);
+  for (size_t ch=0; ch<nchan; ++ch) {
+    freqs[ch] = 150e6 + ch*195312.5 + (irregular ? 1000.*(ch%3) : 0.);
+  }
+  return freqs;
+}
+
+// All baselines of the stations, including the autocorrelations.
+Vector<Baseline> makeBaselines()
+{
+  Vector<Baseline> baselines(nStation*(nStation+1)/2);
+  size_t bl = 0;
+  for (size_t p=0; p<nStation; ++p) {
+    for (size_t q=p; q<nStation; ++q) {
+      baselines[bl++] = Baseline(p, q);
+    }
+  }
+  return baselines;
+}
+
+Matrix<double> makeUVW()
+{
+  Matrix<double> uvw(3, nStation);
+  for (size_t st=0; st<nStation; ++st) {
+    uvw(0,st) = 70.*st - 150.;
+    uvw(1,st) = 110. - 45.*st;
+    uvw(2,st) = 5.*st;
+  }
+  return uvw;
+}
+
+Cube<dcomplex> simulate (const vector<ModelComponent::ConstPtr>& components,
+                         const Vector<double>& freqs, bool stokesIOnly,
+                         bool singlePrecision, size_t nBlBlocks=1,
+                         bool oneByOne=false)
+{
+  Vector<Baseline> baselines = makeBaselines();
+  Cube<dcomplex> vis(stokesIOnly ? 1:4, freqs.size(), baselines.size());
+  vis = dcomplex();
+  Simulator simulator (reference, nStation, baselines.size(), freqs.size(),
+                       baselines, freqs, makeUVW(), vis, stokesIOnly,
+                       singlePrecision);
+  simulator.setNBaselineBlocks (nBlBlocks);
+  if (oneByOne) {
+    for (const ModelComponent::ConstPtr& component : components) {
+      simulator.simulate (component);
+    }
+  } else {
+    simulator.simulate (components.begin(), components.end());
+  }
+  return vis;
+}
+
+// Compute the visibilities of the components directly. A Gaussian source
+// is a point source attenuated by the Fourier transform of its shape.
+Cube<dcomplex> referenceVis (const vector<ModelComponent::ConstPtr>& components,
+                             const Vector<double>& freqs, bool stokesIOnly)
+{
+  Vector<Baseline> baselines = makeBaselines();
+  Matrix<double> uvw = makeUVW();
+  Cube<dcomplex> vis(stokesIOnly ? 1:4, freqs.size(), baselines.size());
+  vis = dcomplex();
+  for (const ModelComponent::ConstPtr& component : components) {
+    const PointSource& source =
+      dynamic_cast<const PointSource&>(*component);
+    const GaussianSource* gaussian =
+      dynamic_cast<const GaussianSource*>(component.get());
+    const double dRA = source.position()[0] - reference[0];
+    const double dec = source.position()[1];
+    const double l = cos(dec) * sin(dRA);
+    const double m = sin(dec) * cos(reference[1]) -
+      cos(dec) * sin(reference[1]) * cos(dRA);
+    const double n = sqrt(1. - l*l - m*m) - 1.;
+    for (size_t bl=0; bl<baselines.size(); ++bl) {
+      const size_t p = baselines[bl].first;
+      const size_t q = baselines[bl].second;
+      if (p == q) {
+        continue;
+      }
+      const double u = uvw(0,q) - uvw(0,p);
+      const double v = uvw(1,q) - uvw(1,p);
+      const double w = uvw(2,q) - uvw(2,p);
+      for (size_t ch=0; ch<freqs.size(); ++ch) {
+        const double lambda = C::c / freqs[ch];
+        const double phase = C::_2pi * (u*l + v*m + w*n) / lambda;
+        dcomplex shift (cos(phase), sin(phase));
+        if (gaussian) {
+          // The axes are FWHM in radians; the position angle is from
+          // North over East.
+          const double sigma = 1. / (2. * sqrt(2. * log(2.)));
+          const double pa = gaussian->positionAngle();
+          const double uMajor = (u * sin(pa) + v * cos(pa)) / lambda;
+          const double vMinor = (v * sin(pa) - u * cos(pa)) / lambda;
+          const double major = gaussian->majorAxis() * sigma * uMajor;
+          const double minor = gaussian->minorAxis() * sigma * vMinor;
+          shift *= exp(-2. * C::pi * C::pi * (major*major + minor*minor));
+        }
+        const Stokes stokes = source.stokes(freqs[ch]);
+        if (stokesIOnly) {
+          vis(0,ch,bl) += shift * stokes.I;
+        } else {
+          vis(0,ch,bl) += shift * (stokes.I + stokes.Q);
+          vis(1,ch,bl) += shift * dcomplex(stokes.U, stokes.V);
+          vis(2,ch,bl) += shift * dcomplex(stokes.U, -stokes.V);
+          vis(3,ch,bl) += shift * (stokes.I - stokes.Q);
+        }
+      }
+    }
+  }
+  return vis;
+}
+
+// Check that the visibilities match within tolerance times the total flux.
+void compare (const Cube<dcomplex>& vis, const Cube<dcomplex>& ref,
+              double tolerance, size_t ncomp)
+{
+  assert (vis.shape() == ref.shape());
+  const double maxDiff = tolerance * (ncomp + 0.05*ncomp*ncomp);
+  for (size_t i=0; i<vis.size(); ++i) {
+    if (abs(vis.data()[i] - ref.data()[i]) > maxDiff) {
+      cout << "Mismatch at " << i << ": " << vis.data()[i] << ' '
+           << ref.data()[i] << endl;
+      exit(1);
+    }
+  }
+}
+
+void test (size_t ncomp, size_t nchan, bool irregular)
+{
+  cout << "test: ncomp=" << ncomp << " nchan=" << nchan
+       << " irregular=" << irregular << endl;
+  Vector<double> freqs = makeFreqs (nchan, irregular);
+  // Point sources against the direct computation. A component count that
+  // is not a multiple of the block size tests the partial last block.
+  vector<ModelComponent::ConstPtr> points = makeComponents (ncomp, false);
+  Cube<dcomplex> ref = referenceVis (points, freqs, false);
+  compare (simulate (points, freqs, false, false), ref, 1e-9, ncomp);
+  compare (simulate (points, freqs, false, true), ref, 1e-4, ncomp);
+  // Mixed blocks against the direct computation and against one component
+  // at a time (blocks of one), in double and single precision and with
+  // parallel baseline blocks.
+  vector<ModelComponent::ConstPtr> mixed = makeComponents (ncomp, true);
+  for (int stokesIOnly=0; stokesIOnly<2; ++stokesIOnly) {
+    Cube<dcomplex> ref1 = simulate (mixed, freqs, stokesIOnly, false,
+                                    1, true);
+    compare (ref1, referenceVis (mixed, freqs, stokesIOnly), 1e-9, ncomp);
+    compare (simulate (mixed, freqs, stokesIOnly, false), ref1, 1e-9, ncomp);
+    compare (simulate (mixed, freqs, stokesIOnly, true), ref1, 1e-4, ncomp);
+    compare (simulate (mixed, freqs, stokesIOnly, false, 4), ref1, 1e-12,
+             ncomp);
+  }
+}
+
+int main()
+{
+  const size_t blockSize = Simulator::blockSize;
+  for (int irregular=0; irregular<2; ++irregular) {
+    test (1, 3, irregular);
+    test (blockSize, 70, irregular);
+    test (blockSize+5, 70, irregular);
+    test (2*blockSize+31, 130, irregular);
+  }
+  cout << "tSimulator OK" << endl;
+  return 0;
+}
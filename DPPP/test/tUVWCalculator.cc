@@ -0,0 +1,128 @@
+//# tUVWCalculator.cc: Test program for class UVWCalculator
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <DPPP/UVWCalculator.h>
+
+#include <casacore/measures/Measures/MEpoch.h>
+#include <casacore/measures/Measures/Muvw.h>
+#include <casacore/casa/Quanta/Quantum.h>
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace DP3::DPPP;
+using namespace casacore;
+using namespace std;
+
+// Some ITRF positions around the LOFAR core, up to tens of km apart.
+vector<MPosition> makeStations()
+{
+  const double pos[][3] = {{3826896.235, 460979.455, 5064658.203},
+                           {3826979.384, 460897.597, 5064603.189},
+                           {3827420.418, 461218.069, 5064236.891},
+                           {3820760.022, 466233.431, 5068997.317},
+                           {3850973.962, 462753.271, 5045862.436},
+                           {3806569.398, 478839.549, 5078626.173}};
+  vector<MPosition> stations;
+  for (const double* p : pos) {
+    stations.push_back (MPosition(MVPosition(p[0], p[1], p[2]),
+                                  MPosition::ITRF));
+  }
+  return stations;
+}
+
+// Compute the UVW of each antenna directly with a baseline conversion
+// to J2000 for the given time.
+vector<Vector<double> > referenceUVW (const MDirection& phaseDir,
+                                      const vector<MPosition>& stations,
+                                      double time)
+{
+  MeasFrame frame (stations[0]);
+  frame.set (MEpoch(MVEpoch(Quantity(time, "s").get("d").getValue()),
+                    MEpoch::UTC));
+  MDirection dir = MDirection::Convert
+    (phaseDir, MDirection::Ref(MDirection::J2000, frame))();
+  frame.set (dir);
+  const Vector<double> pos0 = stations[0].getValue().getVector();
+  vector<Vector<double> > uvws;
+  for (const MPosition& station : stations) {
+    const Vector<double> pos = station.getValue().getVector();
+    MBaseline mbl (MVBaseline(MVPosition(pos[0] - pos0[0], pos[1] - pos0[1],
+                                         pos[2] - pos0[2])),
+                   MBaseline::Ref(MBaseline::ITRF, frame));
+    MVBaseline bas = MBaseline::Convert(mbl, MBaseline::J2000)().getValue();
+    MVuvw uvw (bas, dir.getValue());
+    uvws.push_back (uvw.getVector());
+  }
+  return uvws;
+}
+
+void test (const MDirection& phaseDir)
+{
+  cout << "test: " << phaseDir << endl;
+  vector<MPosition> stations = makeStations();
+  const size_t nant = stations.size();
+  UVWCalculator calc (phaseDir, stations[0], stations);
+  Vector<int> ant1(nant*(nant-1)/2);
+  Vector<int> ant2(ant1.size());
+  size_t nbl = 0;
+  for (size_t p=0; p<nant; ++p) {
+    for (size_t q=p+1; q<nant; ++q) {
+      ant1[nbl] = p;
+      ant2[nbl] = q;
+      ++nbl;
+    }
+  }
+  // A few times spread over a day, so the Sun moves noticeably.
+  for (int i=0; i<5; ++i) {
+    const double time = 4.87e9 + i*20000.;
+    vector<Vector<double> > ref = referenceUVW (phaseDir, stations, time);
+    const vector<double>& antUVW = calc.getAntUVW (time);
+    for (size_t ant=0; ant<nant; ++ant) {
+      for (int j=0; j<3; ++j) {
+        assert (abs(antUVW[3*ant + j] - ref[ant][j]) < 1e-6);
+      }
+    }
+    vector<double> uvws(3*nbl);
+    calc.getUVWs (ant1, ant2, time, uvws.data());
+    for (size_t bl=0; bl<nbl; ++bl) {
+      Vector<double> uvw = calc.getUVW (ant1[bl], ant2[bl], time);
+      for (int j=0; j<3; ++j) {
+        const double expected = ref[ant2[bl]][j] - ref[ant1[bl]][j];
+        assert (abs(uvw[j] - expected) < 1e-6);
+        assert (abs(uvws[3*bl + j] - expected) < 1e-6);
+      }
+    }
+  }
+}
+
+int main()
+{
+  test (MDirection(Quantity(2.1, "rad"), Quantity(0.8, "rad"),
+                   MDirection::J2000));
+  // A moving phase center.
+  test (MDirection(MDirection::SUN));
+  cout << "tUVWCalculator OK" << endl;
+  return 0;
+}
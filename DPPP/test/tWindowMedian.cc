@@ -0,0 +1,116 @@
+//# tWindowMedian.cc: Test program for class WindowMedian
+//# Copyright (C) 2018
+//# ASTRON (Netherlands Institute for Radio Astronomy)
+//# P.O.Box 2, 7990 AA Dwingeloo, The Netherlands
+//#
+//# This file is part of the LOFAR software suite.
+//# The LOFAR software suite is free software: you can redistribute it and/or
+//# modify it under the terms of the GNU General Public License as published
+//# by the Free Software Foundation, either version 3 of the License, or
+//# (at your option) any later version.
+//#
+//# The LOFAR software suite is distributed in the hope that it will be useful,
+//# but WITHOUT ANY WARRANTY; without even the implied warranty of
+//# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//# GNU General Public License for more details.
+//#
+//# You should have received a copy of the GNU General Public License along
+//# with the LOFAR software suite. If not, see <http://www.gnu.org/licenses/>.
+//#
+//# $Id$
+
+#include <lofar_config.h>
+#include <DPPP/WindowMedian.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace DP3::DPPP;
+using namespace std;
+
+// Compute the medians from scratch in the way MedFlagger does.
+void computeMedians (const vector<const float*>& data,
+                     const vector<const bool*>& flags,
+                     int nchan, int stride, int freqWindow, int chan,
+                     float& Z1, float& Z2)
+{
+  int s1, e1, s2, e2;
+  WindowMedian::windowRanges (chan, freqWindow/2, nchan, s1, e1, s2, e2);
+  vector<float> values;
+  for (size_t r=0; r<data.size(); ++r) {
+    for (int ch=s1; ch<e1; ++ch) {
+      if (!flags[r][ch*stride]) values.push_back (data[r][ch*stride]);
+    }
+    for (int ch=s2; ch<e2; ++ch) {
+      if (!flags[r][ch*stride]) values.push_back (data[r][ch*stride]);
+    }
+  }
+  if (values.empty()) {
+    Z1 = -1;
+    Z2 = 0;
+    return;
+  }
+  size_t k = values.size() / 2;
+  nth_element (values.begin(), values.begin()+k, values.end());
+  Z1 = values[k];
+  for (float& value : values) {
+    value = std::abs(value - Z1);
+  }
+  nth_element (values.begin(), values.begin()+k, values.end());
+  Z2 = values[k];
+}
+
+// Slide over the channels and flag some values in the center row, like
+// MedFlagger does. Integer values are used to test many equal values.
+void test (int ntime, int nchan, int freqWindow, int stride, bool integer)
+{
+  vector<float> data(ntime*nchan*stride);
+  std::unique_ptr<bool[]> flagBuf(new bool[data.size()]);
+  bool* flags = flagBuf.get();
+  for (size_t i=0; i<data.size(); ++i) {
+    data[i] = (integer ? rand()%8 : rand() / float(RAND_MAX));
+    flags[i] = (rand()%10 == 0);
+  }
+  vector<const float*> rowData(ntime);
+  vector<const bool*> rowFlags(ntime);
+  WindowMedian median;
+  for (int corr=0; corr<stride; ++corr) {
+    for (int r=0; r<ntime; ++r) {
+      rowData[r] = &(data[r*nchan*stride]) + corr;
+      rowFlags[r] = flags + r*nchan*stride + corr;
+    }
+    median.init (rowData, rowFlags, nchan, stride, freqWindow);
+    bool* centerFlags = flags + (ntime/2)*nchan*stride + corr;
+    for (int ch=0; ch<nchan; ++ch) {
+      median.move (ch);
+      float Z1, Z2, expZ1, expZ2;
+      median.getMedians (Z1, Z2);
+      computeMedians (rowData, rowFlags, nchan, stride, freqWindow, ch,
+                      expZ1, expZ2);
+      assert (Z1 == expZ1  &&  Z2 == expZ2);
+      if (ch%3 == 0) {
+        centerFlags[ch*stride] = true;
+        median.updateFlags (ch);
+      }
+    }
+  }
+}
+
+int main()
+{
+  for (int ntime=1; ntime<=7; ntime+=2) {
+    for (int nchan=1; nchan<=20; ++nchan) {
+      for (int freqWindow=1; freqWindow<=nchan; freqWindow+=2) {
+        test (ntime, nchan, freqWindow, 1, false);
+        test (ntime, nchan, freqWindow, 2, true);
+      }
+    }
+  }
+  cout << "tWindowMedian OK" << endl;
+  return 0;
+}
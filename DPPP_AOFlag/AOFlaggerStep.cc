@@ -46,6 +46,8 @@ namespace DP3 {
                                   const string& prefix)
       : itsName        (prefix),
         itsBufIndex    (0),
+        itsWinStart    (0),
+        itsFlagStart   (0),
         itsNTimes      (0),
         itsMemoryNeeded(0),
         itsFlagCounter (input->msName(), parset, prefix+"count."),
@@ -68,10 +70,16 @@ namespace DP3 {
       itsPedantic     = parset.getBool   (prefix+"pedantic", false);
       itsDoAutoCorr   = parset.getBool   (prefix+"autocorr", true);
       itsDoRfiStats   = parset.getBool   (prefix+"keepstatistics", true);
+      itsDoubleBuffer = parset.getBool   (prefix+"doublebuffer", false);
     }
 
     AOFlaggerStep::~AOFlaggerStep()
-    {}
+    {
+      // Only happens if the pipeline was aborted before finish.
+      if (itsFlagFuture.valid()) {
+        itsFlagFuture.wait();
+      }
+    }
 
     DPStep::ShPtr AOFlaggerStep::makeStep (DPInput* input,
                                            const ParameterSet& parset,
@@ -90,6 +98,7 @@ namespace DP3 {
       os << "  pedantic:       " << itsPedantic << std::endl;
       os << "  keepstatistics: " << itsDoRfiStats << std::endl;
       os << "  autocorr:       " << itsDoAutoCorr << std::endl;
+      os << "  doublebuffer:   " << itsDoubleBuffer << std::endl;
       os << "  nthreads (omp)  " << OpenMP::maxThreads() << std::endl;
       os << "  max memory used ";
       formatBytes(os, itsMemoryNeeded);
@@ -138,26 +147,33 @@ namespace DP3 {
         memory = availMemory - std::min(0.5 * availMemory, 2.*1024*1024*1024);
       }
       // Determine how much buffer space is needed per time slot.
+      // The flags are kept as bits per channel and baseline.
       // The flagger needs 3 extra work buffers (data+flags) per thread.
-      double timeSize = (sizeof(casacore::Complex) + sizeof(bool)) *
-        (infoIn.nbaselines() + 3*nthread) * infoIn.nchan() * infoIn.ncorr();
+      double timeSize = sizeof(casacore::Complex) *
+        (infoIn.nbaselines() + 3*nthread) * infoIn.nchan() * infoIn.ncorr() +
+        sizeof(bool) * 3*nthread * infoIn.nchan() * infoIn.ncorr() +
+        FlagBitmap::nbytes (infoIn.nchan(), infoIn.nbaselines());
       // If no overlap percentage is given, set it to 1%.
       if (itsOverlapPerc < 0  &&  itsOverlap == 0) {
         itsOverlapPerc = 1;
       }
+      // When double buffering, the time slots of the next window are
+      // collected while the previous window is flagged, so the buffer has
+      // to hold two windows (sharing the overlap).
+      uint nWindowBufs = (itsDoubleBuffer ? 2 : 1);
       // If no time window given, determine it from the available memory.
       if (itsWindowSize == 0) {
         double nt = memory / timeSize;
         if (itsOverlapPerc > 0) {
           // Determine the overlap (add 0.5 for rounding).
           // If itsOverLap is also given, it is the maximum.
-          double tw = nt / (1 + 2*itsOverlapPerc/100);
+          double tw = nt / (nWindowBufs + 2*itsOverlapPerc/100);
           uint overlap = uint(itsOverlapPerc*tw/100 + 0.5);
           if (itsOverlap == 0  ||  overlap < itsOverlap) {
             itsOverlap = overlap;
           }
         }
-        itsWindowSize = uint(std::max(1., nt-2*itsOverlap));
+        itsWindowSize = uint(std::max(1., (nt-2*itsOverlap) / nWindowBufs));
         // Make the window size divide the nr of times nicely (if known).
         // In that way we cannot have a very small last window.
         if (infoIn.ntime() > 0) {
@@ -175,7 +191,8 @@ namespace DP3 {
         itsOverlap = uint(itsOverlapPerc*itsWindowSize/100);
       }
       // Check if it all fits in memory.
-      itsMemoryNeeded = (itsWindowSize + 2*itsOverlap) * timeSize;
+      uint nbuf = nWindowBufs*itsWindowSize + 2*itsOverlap;
+      itsMemoryNeeded = nbuf * timeSize;
       if (itsMemoryNeeded >= availMemory)
 				throw std::runtime_error(
                  "Timewindow " + std::to_string(itsWindowSize)
@@ -183,7 +200,10 @@ namespace DP3 {
                  + ' ' + std::to_string(memory)
                  + " too large for available memory " + std::to_string(availMemory));
       // Size the buffer (need overlap on both sides).
-      itsBuf.resize (itsWindowSize + 2*itsOverlap);
+      // It is used as a ring buffer, so the overlap does not need to be
+      // moved to the start of the next window.
+      itsBuf.resize (nbuf);
+      itsFlags.resize (itsBuf.size());
       // Initialize the flag counters.
       itsFlagCounter.init (getInfo());
       itsFreqs = infoIn.chanFreqs();
@@ -208,6 +228,16 @@ namespace DP3 {
       os << "  ";
       FlagCounter::showPerc1 (os, flagDur, duration);
       os << " AOFlaggerStep " << itsName << '\n';
+      if (itsDoubleBuffer) {
+        os << "          ";
+        FlagCounter::showPerc1 (os, itsWaitTimer.getElapsed(), flagDur);
+        os << " of it spent waiting for background flagging" << '\n';
+        // The flagging is done in the background, so show its parts
+        // relative to the time spent in the background.
+        flagDur = itsComputeTimer.getElapsed();
+        os << "          background flagging took " << flagDur
+           << " sec; of which:" << '\n';
+      }
       os << "          ";
       // move time and flag time are sum of all threads.
       // Scale them to a single elapsed time.
@@ -236,26 +266,63 @@ namespace DP3 {
       itsTimer.start();
       // Accumulate in the time window until the window and overlap are full. 
       itsNTimes++;
-      itsBuf[itsBufIndex].copy (buf);
+      // Copy the buffer without its flags; they are kept packed.
+      uint index = (itsWinStart + itsBufIndex) % itsBuf.size();
+      DPBuffer noFlags (buf);
+      noFlags.setFlags (casacore::Cube<bool>());
+      itsBuf[index].copy (noFlags);
+      itsFlags[index].fromCube (buf.getFlags());
       ++itsBufIndex;
       if (itsBufIndex == itsWindowSize+2*itsOverlap) {
-        flag(2*itsOverlap);
+        // The window starts with the right overlap of the previous window,
+        // so the flagging of that window has to be finished first.
+        waitForFlag();
+        uint start = itsWinStart;
+        if (itsDoubleBuffer) {
+          // Flag in the background while the next window is collected.
+          // The number of OpenMP threads is a per-thread setting.
+          const uint nThreads = OpenMP::maxThreads();
+          itsFlagFuture = std::async(std::launch::async, [=]() {
+            OpenMP::setNumThreads(nThreads);
+            flag (start, itsWindowSize, 2*itsOverlap);
+          });
+          itsFlagStart = start;
+        } else {
+          flag (start, itsWindowSize, 2*itsOverlap);
+          sendWindow (start, itsWindowSize);
+        }
+        itsWinStart = (start + itsWindowSize) % itsBuf.size();
+        itsBufIndex = 2*itsOverlap;
       }
       itsTimer.stop();
       return true;
     }
 
+    void AOFlaggerStep::waitForFlag()
+    {
+      if (itsFlagFuture.valid()) {
+        {
+          NSTimer::StartStop sstime(itsWaitTimer);
+          // Rethrows an exception thrown while flagging.
+          itsFlagFuture.get();
+        }
+        sendWindow (itsFlagStart, itsWindowSize);
+      }
+    }
+
     void AOFlaggerStep::finish()
     {
       std::cerr << "  " << itsBufIndex << " time slots to finish in AOFlaggerStep ...\n";
       itsTimer.start();
-      // Set window size to all entries left.
-      itsWindowSize = itsBufIndex;
-      if (itsWindowSize > 0) {
+      waitForFlag();
+      if (itsBufIndex > 0) {
         // Flag the remaining time slots (without right overlap).
-        flag (0);
+        flag (itsWinStart, itsBufIndex, 0);
+        sendWindow (itsWinStart, itsBufIndex);
+        itsBufIndex = 0;
       }
       itsBuf.clear();
+      itsFlags.clear();
       itsTimer.stop();
       // Let the next step finish its processing.
       getNextStep()->finish();
@@ -273,12 +340,12 @@ namespace DP3 {
       getPrevStep()->addToMS (msName);
     }
 
-    void AOFlaggerStep::flag (uint rightOverlap)
+    void AOFlaggerStep::flag (uint start, uint windowSize, uint rightOverlap)
     {
       // Get the sizes of the axes.
       // Note: OpenMP 2.5 needs signed iteration variables.
-      int  nrbl   = itsBuf[0].getData().shape()[2];
-      uint ncorr  = itsBuf[0].getData().shape()[0];
+      int  nrbl   = itsBuf[start].getData().shape()[2];
+      uint ncorr  = itsBuf[start].getData().shape()[0];
       if (ncorr!=4)
 				throw std::runtime_error("AOFlaggerStep can only handle all 4 correlations");
       // Get antenna numbers in case applyautocorr is true.
@@ -294,9 +361,9 @@ namespace DP3 {
         counter.init (getInfo());
 	
         // Create a statistics object for all polarizations.
-	std::vector<double> scanTimes(itsBuf.size());
-	for (size_t i=0; i<itsBuf.size(); ++i) {
-	  scanTimes[i] = itsBuf[i].getTime();
+	std::vector<double> scanTimes(windowSize + rightOverlap);
+	for (size_t i=0; i<scanTimes.size(); ++i) {
+	  scanTimes[i] = itsBuf[(start+i) % itsBuf.size()].getTime();
         }
 	aoflagger::QualityStatistics rfiStats =
 	  itsAOFlagger.MakeQualityStatistics (scanTimes.data(),
@@ -314,11 +381,11 @@ namespace DP3 {
           // Do autocorrelations only if told so.
           if (ant1[ib] == ant2[ib]) {
             if (itsDoAutoCorr) {
-              flagBaseline (0, itsWindowSize+rightOverlap, 0, ib,
+              flagBaseline (start, windowSize+rightOverlap, ib,
                             counter, rfiStats);
             }
           } else {
-            flagBaseline (0, itsWindowSize+rightOverlap, 0, ib,
+            flagBaseline (start, windowSize+rightOverlap, ib,
                           counter, rfiStats);
           }
         } // end of OMP for
@@ -339,36 +406,33 @@ namespace DP3 {
         }
       } // end of OMP parallel
       itsComputeTimer.stop();
+    }
+
+    void AOFlaggerStep::sendWindow (uint start, uint windowSize)
+    {
       itsTimer.stop();
       // Let the next step process the buffers.
-      // If possible, discard the buffer processed to minimize memory usage.
-      for (uint i=0; i<itsWindowSize; ++i) {
-        getNextStep()->process (itsBuf[i]);
-        ///        itsBuf[i] = DPBuffer();
-        ///cout << "cleared buffer " << i << endl;
+      // The flags are expanded into a single cube, so a next step keeping
+      // a buffer has to copy it (as it should anyway).
+      for (uint i=0; i<windowSize; ++i) {
+        uint index = (start + i) % itsBuf.size();
+        itsFlags[index].toCube (itsOutFlags, itsBuf[index].getData().shape()[0]);
+        DPBuffer buf (itsBuf[index]);
+        buf.setFlags (itsOutFlags);
+        getNextStep()->process (buf);
       }
       itsTimer.start();
-      // Shift the buffers still needed to the beginning of the vector.
-      // This is a bit easier than keeping a wrapped vector.
-      // Note it is a cheap operation, because shallow copies are made.
-      for (uint i=0; i<rightOverlap; ++i) {
-        itsBuf[i].copy (itsBuf[i+itsWindowSize]);
-        ///cout << "moved buffer " <<i+itsWindowSize<<" to "<< i << endl;
-      }
-      itsBufIndex = rightOverlap;
     }
 
-    void AOFlaggerStep::flagBaseline (uint leftOverlap, uint windowSize,
-                                      uint rightOverlap, uint bl,
+    void AOFlaggerStep::flagBaseline (uint start, uint ntime, uint bl,
                                       FlagCounter& counter,
                                       aoflagger::QualityStatistics& rfiStats)
     {
       NSTimer moveTimer, flagTimer, qualTimer;
       moveTimer.start();
       // Get the sizes of the axes.
-      uint ntime  = leftOverlap + windowSize + rightOverlap;
-      uint nchan  = itsBuf[0].getData().shape()[1];
-      uint blsize = nchan * itsBuf[0].getData().shape()[0];
+      uint nchan  = itsBuf[start].getData().shape()[1];
+      uint blsize = nchan * itsBuf[start].getData().shape()[0];
       // Fill the rficonsole buffers and flag.
       // Create the objects for the real and imaginary data of all corr.
       aoflagger::ImageSet imageSet =
@@ -378,16 +442,16 @@ namespace DP3 {
       const uint iStride = imageSet.HorizontalStride();
       const uint fStride = origFlags.HorizontalStride();
       for (uint i=0; i<ntime; ++i) {
-        const casacore::Complex* data = itsBuf[i].getData().data()  + bl*blsize;
-        const bool*   flags = itsBuf[i].getFlags().data() + bl*blsize;
+        uint index = (start + i) % itsBuf.size();
+        const casacore::Complex* data = itsBuf[index].getData().data()  + bl*blsize;
+        const FlagBitmap& flags = itsFlags[index];
         for (uint j=0; j<nchan; ++j) {
 	  for (uint p=0; p!=4; ++p) {
 	    imageSet.ImageBuffer(p*2  )[i + j*iStride] = data->real();
 	    imageSet.ImageBuffer(p*2+1)[i + j*iStride] = data->imag();
 	    data++;
 	  }
-	  origFlags.Buffer()[i + j*fStride] = *flags;
-          flags += 4;
+	  origFlags.Buffer()[i + j*fStride] = flags.get (j, bl);
         }
       }
       // Execute the strategy to do the flagging.
@@ -396,31 +460,22 @@ namespace DP3 {
       aoflagger::FlagMask rfiMask = itsAOFlagger.Run(*itsStrategy, imageSet);
       flagTimer.stop();
       // Put back the true flags and count newly set flags.
+      // A baseline's bits are in its own words, so threads flagging other
+      // baselines do not interfere.
       moveTimer.start();
-      for (uint i=leftOverlap; i<windowSize+leftOverlap; ++i) {
-        bool* flags = itsBuf[i].getFlags().data() + bl*blsize;
+      for (uint i=0; i<ntime; ++i) {
+        FlagBitmap& flags = itsFlags[(start + i) % itsBuf.size()];
         for (uint j=0; j<nchan; ++j) {
           // Only set if not already set.
-          // If any corr is newly set, set all corr.
-          if (! flags[0]) {
-            bool setFlag = true;
-            if (rfiMask.Buffer()[i + j*fStride]) {
-              counter.incrCorrelation(0);
-              counter.incrCorrelation(1);
-              counter.incrCorrelation(2);
-              counter.incrCorrelation(3);
-            } else {
-              setFlag = false;
-            }
-            if (setFlag) {
-              counter.incrBaseline(bl);
-              counter.incrChannel(j);
-              for (int k=0; k<4; ++k) {
-                flags[k] = true;
-              }
-            }
+          if (! flags.get (j, bl)  &&  rfiMask.Buffer()[i + j*fStride]) {
+            counter.incrCorrelation(0);
+            counter.incrCorrelation(1);
+            counter.incrCorrelation(2);
+            counter.incrCorrelation(3);
+            counter.incrBaseline(bl);
+            counter.incrChannel(j);
+            flags.set (j, bl);
           }
-          flags += 4;
         }
       }
       moveTimer.stop();
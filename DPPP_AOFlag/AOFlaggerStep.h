@@ -29,8 +29,10 @@
 
 #include "../DPPP/DPInput.h"
 #include "../DPPP/DPBuffer.h"
+#include "../DPPP/FlagBitmap.h"
 #include "../DPPP/FlagCounter.h"
 
+#include <future>
 #include <memory>
 
 #include <aoflagger.h>
@@ -64,6 +66,14 @@ namespace DP3 {
     // <br>Furthermore it is possible to only flag the autocorrelations and
     // apply the resulting flags to the crosscorrelations, possibly selected
     // on baseline length.
+    //
+    // The time slots are collected in a ring buffer, so the overlap of a
+    // window is shared with the next window instead of copied.
+    // If <src>doublebuffer</src> is true, a full window is flagged in a
+    // background thread while the time slots of the next window are
+    // collected. The window is handed to the next step when the next window
+    // is full. The buffer then holds two windows, which is taken into
+    // account when deriving the window size from the memory.
 
     class AOFlaggerStep : public DPStep
     {
@@ -102,13 +112,20 @@ namespace DP3 {
       virtual void showTimings (std::ostream&, double duration) const;
 
     private:
-      // Flag all baselines in the time window (using OpenMP to parallellize).
-      // Process the buffers in the next step.
-      void flag (uint rightOverlap);
+      // Flag all baselines in the time window starting at the given index
+      // in the ring buffer (using OpenMP to parallellize).
+      // The flags are also set in the right overlap.
+      void flag (uint start, uint windowSize, uint rightOverlap);
+
+      // Let the next step process the buffers of a flagged window.
+      void sendWindow (uint start, uint windowSize);
+
+      // Wait until the window flagged in the background is done and
+      // let the next step process it.
+      void waitForFlag();
 
-      // Flag a single baseline using the rfistrategy.
-      void flagBaseline (uint leftOverlap, uint windowSize,
-                         uint rightOverlap, uint bl,
+      // Flag a single baseline in ntime time slots using the rfistrategy.
+      void flagBaseline (uint start, uint ntime, uint bl,
                          FlagCounter& counter,
                          aoflagger::QualityStatistics& rfiStats);
 
@@ -126,7 +143,9 @@ namespace DP3 {
 
       //# Data members.
       string           itsName;
-      uint             itsBufIndex;
+      uint             itsBufIndex;      //# nr of time slots in window
+      uint             itsWinStart;      //# ring index of window start
+      uint             itsFlagStart;     //# ring index of background window
       uint             itsNTimes;
       string           itsStrategyName;
       uint             itsWindowSize;
@@ -139,11 +158,16 @@ namespace DP3 {
       bool             itsPedantic;
       bool             itsDoAutoCorr;
       bool             itsDoRfiStats;
-      vector<DPBuffer> itsBuf;
+      bool             itsDoubleBuffer;
+      std::future<void> itsFlagFuture;   //# flagging in background
+      vector<DPBuffer> itsBuf;           //# window buffers without flags
+      vector<FlagBitmap> itsFlags;       //# packed flags of itsBuf
+      casacore::Cube<bool> itsOutFlags;  //# flags of buffer sent to next step
       FlagCounter      itsFlagCounter;
       NSTimer          itsTimer;
       NSTimer          itsQualityTimer;  //# quality writing timer
       NSTimer          itsComputeTimer;  //# move/flag timer
+      NSTimer          itsWaitTimer;     //# waiting for background flagging
       double           itsMoveTime;      //# data move timer (sum all threads)
       double           itsFlagTime;      //# flag timer (sum of all threads)
       double           itsQualTime;      //# quality timer (sum of all threads)
@@ -191,6 +191,26 @@ private:
   int itsNTime, itsNBl, itsNChan, itsNCorr;
 };
 
+// Class to keep the flags of each time slot.
+class FlagRecorder: public DPStep
+{
+public:
+  explicit FlagRecorder(vector<Cube<bool> >& flags)
+    : itsFlags(flags)
+  {}
+private:
+  virtual bool process (const DPBuffer& buf)
+  {
+    itsFlags.push_back (buf.getFlags().copy());
+    return true;
+  }
+
+  virtual void finish() {}
+  virtual void show (std::ostream&) const {}
+
+  vector<Cube<bool> >& itsFlags;
+};
+
 
 // Execute steps.
 void execute (const DPStep::ShPtr& step1)
@@ -244,6 +264,36 @@ void test2(int ntime, int nant, int nchan, int ncorr, bool flag, int threshold)
   execute (step1);
 }
 
+// Run the flagger with and without double buffering (using a time window
+// smaller than the nr of times and a non-zero overlap) and check that both
+// modes give the same flags.
+void test3(int ntime, int nant, int nchan, int ncorr)
+{
+  cout << "test3: ntime=" << ntime << " nrant=" << nant << " nchan=" << nchan
+       << " ncorr=" << ncorr << endl;
+  vector<Cube<bool> > flags[2];
+  for (int doubleBuffer=0; doubleBuffer<2; ++doubleBuffer) {
+    TestInput* in = new TestInput(ntime, nant, nchan, ncorr, false);
+    DPStep::ShPtr step1(in);
+    ParameterSet parset;
+    parset.add ("timewindow", "4");
+    parset.add ("overlapmax", "2");
+    parset.add ("doublebuffer", doubleBuffer ? "true" : "false");
+    DPStep::ShPtr step2 = DPRun::findStepCtor("aoflag")(in, parset, "");
+    DPStep::ShPtr step3(new FlagRecorder(flags[doubleBuffer]));
+    step1->setNextStep (step2);
+    step2->setNextStep (step3);
+    execute (step1);
+  }
+  assert (int(flags[0].size()) == ntime);
+  assert (flags[1].size() == flags[0].size());
+  for (size_t i=0; i<flags[0].size(); ++i) {
+    assert (allEQ (flags[1][i], flags[0][i]));
+  }
+  // The spike that TestInput adds at time 5 must be flagged.
+  assert (allTrue (flags[0][5]));
+}
+
 
 int main()
 {
@@ -258,6 +308,8 @@ int main()
       test2(14, 2,  8, 4, false, 100);
       ///      test2(99, 8, 64, 4, false, 100);
     }
+    test3(14, 2,  8, 4);
+    test3(10, 5, 32, 4);
   } catch (std::exception& x) {
     cout << "Unexpected exception: " << x.what() << endl;
     return 1;
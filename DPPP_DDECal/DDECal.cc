@@ -92,6 +92,9 @@ namespace DP3 {
         itsTimeStep      (0),
         itsSolInt        (parset.getInt (prefix + "solint", 1)),
         itsStepInSolInt  (0),
+        itsAsyncSolve    (parset.getBool (prefix + "asyncsolve", false)),
+        itsNParallelSolves (parset.getUint (prefix + "nparallelsolves", 1)),
+        itsBufferSet     (0),
         itsNChan         (parset.getInt (prefix + "nchan", 1)),
         itsUVWFlagStep   (input, parset, prefix),
         itsCoreConstraint(parset.getDouble (prefix + "coreconstraint", 0.0)),
@@ -111,13 +114,35 @@ namespace DP3 {
       itsMultiDirSolver.set_constraint_accuracy(parset.getDouble(prefix + "approxtolerance", tolerance*10.0));
       itsMultiDirSolver.set_step_size(parset.getDouble(prefix + "stepsize", 0.2));
       itsMultiDirSolver.set_detect_stalling(parset.getBool(prefix + "detectstalling", true));
+      string llsSolver = boost::to_lower_copy(parset.getString(prefix + "llssolver", "qr"));
+      if (llsSolver == "qr") {
+        itsMultiDirSolver.set_lls_solver_type(MultiDirSolver::LLSSolverType::QR);
+      } else if (llsSolver == "normalequations") {
+        itsMultiDirSolver.set_lls_solver_type(MultiDirSolver::LLSSolverType::NormalEquations);
+      } else {
+        throw std::runtime_error("Unknown llssolver " + llsSolver +
+                                 "; use qr or normalequations");
+      }
+      string acceleration = boost::to_lower_copy(parset.getString(prefix + "acceleration", "none"));
+      if (acceleration == "nesterov") {
+        itsMultiDirSolver.set_use_momentum(true);
+      } else if (acceleration != "none") {
+        throw std::runtime_error("Unknown acceleration " + acceleration +
+                                 "; use none or nesterov");
+      }
 
       if(!itsStatFilename.empty())
         itsStatStream.reset(new std::ofstream(itsStatFilename));
+
+      // Solution intervals can only be solved in parallel if they do not
+      // depend on each other. The statistics file is written sequentially.
+      if (itsNParallelSolves == 0 || itsPropagateSolutions || itsStatStream) {
+        itsNParallelSolves = 1;
+      }
+      itsNBufferSets = itsNParallelSolves * (itsAsyncSolve ? 2 : 1);
       
       vector<string> strDirections;
       if (itsUseModelColumn) {
-        itsModelData.resize(itsSolInt);
         strDirections.push_back("pointing");
         itsDirections.push_back(vector<string>());
       } else {
@@ -144,6 +169,35 @@ namespace DP3 {
       itsMode = GainCal::stringToCalType(
                    boost::to_lower_copy(parset.getString(prefix + "mode",
                                             "complexgain")));
+      // Every parallel solve needs its own constraints.
+      for (uint i=0; i<itsNParallelSolves; ++i) {
+        addConstraints(parset, prefix);
+      }
+
+      const size_t nDir = itsDirections.size();
+      if (itsUseModelColumn) {
+        assert(nDir == 1);
+      } else {
+        itsPredictSteps.resize(nDir);
+        for (size_t dir=0; dir<nDir; ++dir) {
+          itsPredictSteps[dir]=Predict(input, parset, prefix, itsDirections[dir]);
+        }
+      }
+    }
+
+    DDECal::~DDECal()
+    {}
+
+    DPStep::ShPtr DDECal::makeStep (DPInput* input,
+                                    const ParameterSet& parset,
+                                    const std::string& prefix)
+    {
+      return DPStep::ShPtr(new DDECal(input, parset, prefix));
+    }
+
+    void DDECal::addConstraints (const ParameterSet& parset,
+                                 const string& prefix)
+    {
       if(itsCoreConstraint != 0.0) {
         itsConstraints.push_back(casacore::CountedPtr<Constraint>(
           new CoreConstraint()));
@@ -245,26 +299,6 @@ namespace DP3 {
           throw std::runtime_error("Unexpected mode: " + 
                           GainCal::calTypeToString(itsMode));
       }
-
-      const size_t nDir = itsDirections.size();
-      if (itsUseModelColumn) {
-        assert(nDir == 1);
-      } else {
-        itsPredictSteps.resize(nDir);
-        for (size_t dir=0; dir<nDir; ++dir) {
-          itsPredictSteps[dir]=Predict(input, parset, prefix, itsDirections[dir]);
-        }
-      }
-    }
-
-    DDECal::~DDECal()
-    {}
-
-    DPStep::ShPtr DDECal::makeStep (DPInput* input,
-                                    const ParameterSet& parset,
-                                    const std::string& prefix)
-    {
-      return DPStep::ShPtr(new DDECal(input, parset, prefix));
     }
 
     void DDECal::updateInfo (const DPInfo& infoIn)
@@ -283,24 +317,34 @@ namespace DP3 {
         itsSolInt=info().ntime();
       }
 
-      itsDataPtrs.resize(itsSolInt);
-      itsModelDataPtrs.resize(itsSolInt);
-      for (uint t=0; t<itsSolInt; ++t) {
+      const size_t nSlots = itsSolInt*itsNBufferSets;
+      itsDataPtrs.resize(nSlots);
+      itsModelDataPtrs.resize(nSlots);
+      for (uint t=0; t<nSlots; ++t) {
         itsModelDataPtrs[t].resize(nDir);
       }
-      for  (uint i=0;i<itsConstraints.size();i++) {
-        itsMultiDirSolver.add_constraint(itsConstraints[i].get());
+      if (itsUseModelColumn) {
+        itsModelData.resize(nSlots);
+      }
+      // The other solvers get the settings of the first one.
+      itsExtraSolvers.assign(itsNParallelSolves-1, itsMultiDirSolver);
+      const size_t nConstraints = itsConstraints.size() / itsNParallelSolves;
+      for (uint k=0; k<itsNParallelSolves; ++k) {
+        for  (uint i=0;i<nConstraints;i++) {
+          solver(k).add_constraint(itsConstraints[k*nConstraints+i].get());
+        }
       }
+      itsIntervals.resize(itsNBufferSets);
 
 
-      itsBufs.resize(itsSolInt);
+      itsBufs.resize(nSlots);
 
       itsDataResultStep = ResultStep::ShPtr(new ResultStep());
       itsUVWFlagStep.setNextStep(itsDataResultStep);
 
       itsResultSteps.resize(itsPredictSteps.size());
       for (size_t dir=0; dir<itsPredictSteps.size(); ++dir) {
-        itsResultSteps[dir] = MultiResultStep::ShPtr(new MultiResultStep(itsSolInt));
+        itsResultSteps[dir] = MultiResultStep::ShPtr(new MultiResultStep(nSlots));
         itsPredictSteps[dir].setNextStep(itsResultSteps[dir]);
       }
 
@@ -369,7 +413,8 @@ namespace DP3 {
       }
       itsChanBlockStart[itsChanBlockStart.size()-1] = info().nchan();
 
-      itsWeights.assign(itsChanBlockFreqs.size()*info().nantenna(), 0.0);
+      itsWeights.assign(itsNBufferSets,
+                        vector<double>(itsChanBlockFreqs.size()*info().nantenna(), 0.0));
 
       for (uint i=0; i<itsConstraints.size();++i) {
         // Initialize the constraint with some common metadata
@@ -445,8 +490,10 @@ namespace DP3 {
       }
 
       uint nSt = info().antennaNames().size();
-      itsMultiDirSolver.init(nSt, nDir, info().nchan(), ant1, ant2);
-      itsMultiDirSolver.set_channel_blocks(nChannelBlocks);
+      for (uint k=0; k<itsNParallelSolves; ++k) {
+        solver(k).init(nSt, nDir, info().nchan(), ant1, ant2);
+        solver(k).set_channel_blocks(nChannelBlocks);
+      }
 
       for (uint i=0; i<nSolTimes; ++i) {
         itsSols[i].resize(nChannelBlocks);
@@ -466,10 +513,17 @@ namespace DP3 {
         << "  max iter:            " << itsMultiDirSolver.max_iterations() << '\n'
         << "  detect stalling:     " << std::boolalpha << itsMultiDirSolver.get_detect_stalling() << '\n'
         << "  step size:           " << itsMultiDirSolver.get_step_size() << '\n'
+        << "  lls solver:          " << (itsMultiDirSolver.get_lls_solver_type() ==
+                                         MultiDirSolver::LLSSolverType::QR ?
+                                         "qr" : "normalequations") << '\n'
+        << "  acceleration:        " << (itsMultiDirSolver.get_use_momentum() ?
+                                         "nesterov" : "none") << '\n'
         << "  mode (constraints):  " << GainCal::calTypeToString(itsMode) << '\n'
         << "  coreconstraint:      " << itsCoreConstraint << '\n'
   << "  smoothnessconstraint:" << itsSmoothnessConstraint << '\n'
-        << "  approximate fitter:  " << itsApproximateTEC << '\n';
+        << "  approximate fitter:  " << itsApproximateTEC << '\n'
+        << "  async solve:         " << itsAsyncSolve << '\n'
+        << "  parallel solves:     " << itsNParallelSolves << '\n';
       for (uint i=0; i<itsPredictSteps.size(); ++i) {
         itsPredictSteps[i].show(os);
       }
@@ -481,7 +535,9 @@ namespace DP3 {
       double totaltime=itsTimer.getElapsed();
       os << "  ";
       FlagCounter::showPerc1 (os, itsTimer.getElapsed(), duration);
-      os << " DDECal " << itsName << endl;
+      os << " DDECal " << itsName;
+      FlagCounter::showCores (os, itsCoreUsage.Cores(totaltime));
+      os << endl;
 
       os << "          ";
       FlagCounter::showPerc1 (os, itsTimerPredict.getElapsed(), totaltime);
@@ -493,6 +549,12 @@ namespace DP3 {
 
       itsMultiDirSolver.showTimings(os, itsTimerSolve.getElapsed());
 
+      if (itsAsyncSolve) {
+        os << "          ";
+        FlagCounter::showPerc1 (os, itsTimerWaitSolve.getElapsed(), totaltime);
+        os << " of it spent in waiting for the previous solve" << endl;
+      }
+
       os << "          ";
       FlagCounter::showPerc1 (os, itsTimerWrite.getElapsed(), totaltime);
       os << " of it spent in writing gain solutions to disk" << endl;
@@ -510,27 +572,27 @@ namespace DP3 {
       os<<"]"<<endl;
     }
 
-    void DDECal::initializeScalarSolutions() {
-      if (itsTimeStep/itsSolInt>0 && itsPropagateSolutions) {
+    void DDECal::initializeScalarSolutions(uint solIndex) {
+      if (solIndex>0 && itsPropagateSolutions) {
         // initialize solutions with those of the previous step
-        itsSols[itsTimeStep/itsSolInt] = itsSols[itsTimeStep/itsSolInt-1];
+        itsSols[solIndex] = itsSols[solIndex-1];
       } else {
         // initialize solutions with 1.
         size_t n = itsDirections.size()*info().antennaNames().size();
-        for (vector<DComplex>& solvec : itsSols[itsTimeStep/itsSolInt]) {
+        for (vector<DComplex>& solvec : itsSols[solIndex]) {
           solvec.assign(n, 1.0);
         }
       }
     }
 
-    void DDECal::initializeFullMatrixSolutions() {
-      if (itsTimeStep/itsSolInt>0 && itsPropagateSolutions) {
+    void DDECal::initializeFullMatrixSolutions(uint solIndex) {
+      if (solIndex>0 && itsPropagateSolutions) {
         // initialize solutions with those of the previous step
-        itsSols[itsTimeStep/itsSolInt] = itsSols[itsTimeStep/itsSolInt-1];
+        itsSols[solIndex] = itsSols[solIndex-1];
       } else {
         // initialize solutions with unity matrix [1 0 ; 0 1].
         size_t n = itsDirections.size()*info().antennaNames().size();
-        for (vector<DComplex>& solvec : itsSols[itsTimeStep/itsSolInt]) {
+        for (vector<DComplex>& solvec : itsSols[solIndex]) {
           solvec.resize(n*4);
           for(size_t i=0; i!=n; ++i)
           {
@@ -561,30 +623,39 @@ namespace DP3 {
       return res;
     }
 
-    void DDECal::doSolve ()
+    void DDECal::doSolve (uint bufferSet, uint solverIndex)
     {
+      const SolveInterval& interval = itsIntervals[bufferSet];
+      const uint solIndex = interval.solIndex;
       if(itsFullMatrixMinimalization)
-        initializeFullMatrixSolutions();
+        initializeFullMatrixSolutions(solIndex);
       else
-        initializeScalarSolutions();
+        initializeScalarSolutions(solIndex);
 
-      itsTimerSolve.start();
+      // The time slots of this buffer set.
+      const size_t first = bufferSet*itsSolInt;
+      const size_t last = first + interval.nTimes;
+      std::vector<casacore::Complex*> dataPtrs(itsDataPtrs.begin()+first,
+                                              itsDataPtrs.begin()+last);
+      std::vector<std::vector<casacore::Complex*> > modelDataPtrs(
+        itsModelDataPtrs.begin()+first, itsModelDataPtrs.begin()+last);
+
+      MultiDirSolver& multiDirSolver = solver(solverIndex);
       MultiDirSolver::SolveResult solveResult;
       if(itsFullMatrixMinimalization)
       {
-        solveResult = itsMultiDirSolver.processFullMatrix(itsDataPtrs, itsModelDataPtrs,
-          itsSols[itsTimeStep/itsSolInt],
-    itsAvgTime / itsSolInt, itsStatStream.get());
+        solveResult = multiDirSolver.processFullMatrix(dataPtrs, modelDataPtrs,
+          itsSols[solIndex],
+    interval.avgTime / itsSolInt, itsStatStream.get());
       }
       else {
-        solveResult = itsMultiDirSolver.processScalar(itsDataPtrs, itsModelDataPtrs,
-          itsSols[itsTimeStep/itsSolInt],
-    itsAvgTime / itsSolInt, itsStatStream.get());
+        solveResult = multiDirSolver.processScalar(dataPtrs, modelDataPtrs,
+          itsSols[solIndex],
+    interval.avgTime / itsSolInt, itsStatStream.get());
       }
-      itsTimerSolve.stop();
 
-      itsNIter[itsTimeStep/itsSolInt] = solveResult.iterations;
-      itsNApproxIter[itsTimeStep/itsSolInt] = solveResult.constraintIterations;
+      itsNIter[solIndex] = solveResult.iterations;
+      itsNApproxIter[solIndex] = solveResult.constraintIterations;
 
       // Store constraint solutions if any constaint has a non-empty result
       bool someConstraintHasResult = false;
@@ -595,7 +666,71 @@ namespace DP3 {
         }
       }
       if (someConstraintHasResult) {
-        itsConstraintSols[itsTimeStep/itsSolInt]=solveResult._results;
+        itsConstraintSols[solIndex]=solveResult._results;
+      }
+    }
+
+    void DDECal::startSolve (uint firstSet, uint nSets)
+    {
+      // The solvers and constraints can do only one solve at a time, and
+      // the solutions of the previous interval may be needed as start values.
+      waitForSolve();
+
+      // The constraints keep a copy of the weights.
+      const size_t nConstraints = itsConstraints.size() / itsNParallelSolves;
+      for (uint k=0; k<nSets; ++k) {
+        for (uint constraint_num = 0; constraint_num < nConstraints; ++constraint_num) {
+          itsConstraints[k*nConstraints + constraint_num]->SetWeights(itsWeights[firstSet+k]);
+        }
+      }
+
+      // The number of OpenMP threads is a per-thread setting.
+      // Each solve gets its share of the threads. An asynchronous solve
+      // runs concurrently with the predict of the next interval in this
+      // thread, which therefore also counts as a share.
+      const uint nThreads = OpenMP::maxThreads();
+      const uint nShares = nSets + (itsAsyncSolve ? 1 : 0);
+      const uint nThreadsPerSolve = std::max(1u, nThreads / nShares);
+      auto solveSets = [=]() {
+        itsTimerSolve.start();
+        // The extra solves run in their own threads, not in the thread pool,
+        // to avoid that they block the pool for the predict of the next
+        // interval.
+        std::vector<std::future<void>> solves;
+        for (uint k=1; k<nSets; ++k) {
+          solves.emplace_back(std::async(std::launch::async, [=]() {
+            OpenMP::setNumThreads(nThreadsPerSolve);
+            ThreadPool::UsageScope usageScope(itsCoreUsage);
+            doSolve(firstSet+k, k);
+          }));
+        }
+        OpenMP::setNumThreads(nThreadsPerSolve);
+        doSolve(firstSet, 0);
+        OpenMP::setNumThreads(nThreads);
+        // Rethrows an exception thrown by one of the solves.
+        for (std::future<void>& solve : solves) {
+          solve.get();
+        }
+        itsTimerSolve.stop();
+      };
+
+      if (itsAsyncSolve) {
+        itsSolveFuture = std::async(std::launch::async, [=]() {
+          OpenMP::setNumThreads(nThreadsPerSolve);
+          ThreadPool::UsageScope usageScope(itsCoreUsage);
+          solveSets();
+        });
+      } else {
+        solveSets();
+      }
+    }
+
+    void DDECal::waitForSolve()
+    {
+      if (itsSolveFuture.valid()) {
+        NSTimer::StartStop sstime(itsTimerWaitSolve);
+        // Rethrows an exception thrown by the solve.
+        itsSolveFuture.get();
       }
     }
 
@@ -603,32 +738,41 @@ namespace DP3 {
     {
       itsTimer.start();
 
-      itsBufs[itsStepInSolInt].copy(bufin);
-      itsDataPtrs[itsStepInSolInt] = itsBufs[itsStepInSolInt].getData().data();
+      // Index of the time slot in the buffers of the current buffer set.
+      const size_t slot = itsBufferSet*itsSolInt + itsStepInSolInt;
+      if (slot == 0) {
+        // Start filling the result steps from the first slot again. With
+        // asyncsolve the solve of the last buffer sets may still be running,
+        // but the slots of those sets are only overwritten after startSolve
+        // has waited for it.
+        for (size_t dir=0; dir<itsResultSteps.size(); ++dir) {
+          itsResultSteps[dir]->clear();
+        }
+      }
+
+      itsBufs[slot].copy(bufin);
+      itsDataPtrs[slot] = itsBufs[slot].getData().data();
 
       // Fetch inputs because parallel PredictSteps should not read it from disk
-      itsInput->fetchUVW(bufin, itsBufs[itsStepInSolInt], itsTimer);
-      itsInput->fetchWeights(bufin, itsBufs[itsStepInSolInt], itsTimer);
-      itsInput->fetchFullResFlags(bufin, itsBufs[itsStepInSolInt], itsTimer);
+      itsInput->fetchUVW(bufin, itsBufs[slot], itsTimer);
+      itsInput->fetchWeights(bufin, itsBufs[slot], itsTimer);
+      itsInput->fetchFullResFlags(bufin, itsBufs[slot], itsTimer);
 
       // UVW flagging happens on a copy of the buffer, so these flags are not written
-      itsUVWFlagStep.process(itsBufs[itsStepInSolInt]);
+      itsUVWFlagStep.process(itsBufs[slot]);
 
       itsTimerPredict.start();
 
       if (itsUseModelColumn) {
-        itsInput->getModelData (itsBufs[itsStepInSolInt].getRowNrs(),
-                                itsModelData[itsStepInSolInt]);
-        itsModelDataPtrs[itsStepInSolInt][0] = itsModelData[itsStepInSolInt].data();
+        itsInput->getModelData (itsBufs[slot].getRowNrs(),
+                                itsModelData[slot]);
+        itsModelDataPtrs[slot][0] = itsModelData[slot].data();
       } else {
-        if(itsThreadPool == nullptr)
-          itsThreadPool.reset(new ThreadPool(OpenMP::maxThreads()));
-        for(DP3::DPPP::Predict& predict : itsPredictSteps)
-          predict.setThreadPool(*itsThreadPool);
-        itsThreadPool->For(0, itsPredictSteps.size(), [&](size_t dir, size_t /*thread*/) {
-          itsPredictSteps[dir].process(itsBufs[itsStepInSolInt]);
-          itsModelDataPtrs[itsStepInSolInt][dir] =
-            itsResultSteps[dir]->get()[itsStepInSolInt].getData().data();
+        ThreadPool::UsageScope usageScope(itsCoreUsage);
+        ThreadPool::GetInstance().For(0, itsPredictSteps.size(), [&](size_t dir, size_t /*thread*/) {
+          itsPredictSteps[dir].process(itsBufs[slot]);
+          itsModelDataPtrs[slot][dir] =
+            itsResultSteps[dir]->get()[slot].getData().data();
         });
       }
 
@@ -639,6 +783,7 @@ namespace DP3 {
       
       size_t nchanblocks = itsChanBlockFreqs.size();
       size_t chanblock = 0;
+      vector<double>& weights = itsWeights[itsBufferSet];
 
       double weightFactor = 1./(nCh*(info().nantenna()-1)*nCr*itsSolInt);
 
@@ -648,27 +793,27 @@ namespace DP3 {
         }
         for (size_t bl=0; bl<nBl; ++bl) {
           for (size_t cr=0; cr<nCr; ++cr) {
-            if (itsBufs[itsStepInSolInt].getFlags().data()[bl*nCr*nCh+ch*nCr+cr]) {
+            if (itsBufs[slot].getFlags().data()[bl*nCr*nCh+ch*nCr+cr]) {
               // Flagged points: set data and model to 0
-              itsDataPtrs[itsStepInSolInt][bl*nCr*nCh+ch*nCr+cr] = 0;
+              itsDataPtrs[slot][bl*nCr*nCh+ch*nCr+cr] = 0;
               for (size_t dir=0; dir<itsModelDataPtrs[0].size(); ++dir) {
-                itsModelDataPtrs[itsStepInSolInt][dir][bl*nCr*nCh+ch*nCr+cr] = 0;
+                itsModelDataPtrs[slot][dir][bl*nCr*nCh+ch*nCr+cr] = 0;
               }
             } else {
               // Premultiply non-flagged data with sqrt(weight)
-              double weight = itsBufs[itsStepInSolInt].getWeights().data()[bl*nCr*nCh+ch*nCr+cr];
-              itsDataPtrs[itsStepInSolInt][bl*nCr*nCh+ch*nCr+cr] *= sqrt(weight);
-              itsWeights[info().getAnt1()[bl]*nchanblocks + chanblock] += weight;
-              itsWeights[info().getAnt2()[bl]*nchanblocks + chanblock] += weight;
+              double weight = itsBufs[slot].getWeights().data()[bl*nCr*nCh+ch*nCr+cr];
+              itsDataPtrs[slot][bl*nCr*nCh+ch*nCr+cr] *= sqrt(weight);
+              weights[info().getAnt1()[bl]*nchanblocks + chanblock] += weight;
+              weights[info().getAnt2()[bl]*nchanblocks + chanblock] += weight;
               for (size_t dir=0; dir<itsModelDataPtrs[0].size(); ++dir) {
-                itsModelDataPtrs[itsStepInSolInt][dir][bl*nCr*nCh+ch*nCr+cr] *= sqrt(weight);
+                itsModelDataPtrs[slot][dir][bl*nCr*nCh+ch*nCr+cr] *= sqrt(weight);
               }
             }
           }
         }
       }
 
-      for (auto& weight: itsWeights) {
+      for (auto& weight: weights) {
         weight *= weightFactor;
       }
 
@@ -677,19 +822,20 @@ namespace DP3 {
       itsAvgTime += itsAvgTime + bufin.getTime();
 
       if (itsStepInSolInt==itsSolInt-1) {
-        for (uint constraint_num = 0; constraint_num < itsConstraints.size(); ++constraint_num) {
-          itsConstraints[constraint_num]->SetWeights(itsWeights);
+        itsIntervals[itsBufferSet] = SolveInterval{itsSolInt,
+                                                   itsTimeStep/itsSolInt,
+                                                   itsAvgTime};
+        // Solve when the last interval of a group of parallel solves is in.
+        const uint firstSet = itsBufferSet - itsBufferSet%itsNParallelSolves;
+        if (itsBufferSet+1 == firstSet+itsNParallelSolves) {
+          startSolve(firstSet, itsNParallelSolves);
         }
 
-        doSolve();
-
         // Clean up, prepare for next iteration
         itsStepInSolInt=0;
         itsAvgTime=0;
-        itsWeights.assign(itsWeights.size(), 0.);
-        for (size_t dir=0; dir<itsResultSteps.size(); ++dir) {
-          itsResultSteps[dir]->clear();
-        }
+        itsBufferSet = (itsBufferSet+1) % itsNBufferSets;
+        itsWeights[itsBufferSet].assign(itsWeights[itsBufferSet].size(), 0.);
       } else {
         itsStepInSolInt++;
       }
@@ -965,15 +1111,19 @@ namespace DP3 {
     {
       itsTimer.start();
 
+      // Solve the intervals of the last, possibly incomplete, group.
+      const uint firstSet = itsBufferSet - itsBufferSet%itsNParallelSolves;
+      uint nSets = itsBufferSet - firstSet;
       if (itsStepInSolInt!=0) {
-        //shrink itsDataPtrs, itsModelDataPtrs
-        std::vector<casacore::Complex*>(itsDataPtrs.begin(),
-            itsDataPtrs.begin()+itsStepInSolInt).swap(itsDataPtrs);
-        std::vector<std::vector<casacore::Complex*> >(itsModelDataPtrs.begin(),
-                    itsModelDataPtrs.begin()+itsStepInSolInt).swap(itsModelDataPtrs);
-
-        doSolve();
+        itsIntervals[itsBufferSet] = SolveInterval{itsStepInSolInt,
+                                                   itsTimeStep/itsSolInt,
+                                                   itsAvgTime};
+        nSets++;
+      }
+      if (nSets > 0) {
+        startSolve(firstSet, nSets);
       }
+      waitForSolve();
 
       writeSolutions();
 
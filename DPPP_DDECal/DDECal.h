@@ -38,6 +38,8 @@
 #include "../DPPP/SourceDBUtil.h"
 #include "../DPPP/ApplyBeam.h"
 
+#include "../Common/ThreadPool.h"
+
 #include "MultiDirSolver.h"
 #include "Constraint.h"
 
@@ -53,15 +55,32 @@
 #include <casacore/measures/Measures/MEpoch.h>
 #include <casacore/casa/Arrays/ArrayMath.h>
 
+#include <future>
+
 namespace DP3 {
 
   class ParameterSet;
-	class ThreadPool;
 
   namespace DPPP {
     // @ingroup NDPPP
 
     // This class is a DPStep class to calibrate (direction independent) gains.
+    //
+    // If <src>asyncsolve=true</src>, the data and model visibilities are
+    // double buffered: the solve of a solution interval runs in a separate
+    // thread while the predict and weighting of the next interval proceed.
+    // A solve waits for the previous one to finish, so solutions are still
+    // propagated in order if <src>propagatesolutions=true</src>.
+    // The predict in this thread counts as a share of the threads, so a
+    // single solve gets numthreads/2 OpenMP threads.
+    //
+    // If <src>propagatesolutions=false</src>, the solution intervals are
+    // independent. With <src>nparallelsolves=n</src>, n intervals are
+    // buffered and then solved concurrently, each by its own solver and
+    // constraints. Each solve gets numthreads/(n+1) OpenMP threads if
+    // asyncsolve is on, otherwise numthreads/n. This keeps the cores
+    // busy when there are fewer channel blocks than cores. The solutions are
+    // stored by interval, so they are still written in order.
 
     typedef vector<Patch::ConstPtr> PatchList;
     typedef std::pair<size_t, size_t> Baseline;
@@ -84,8 +103,9 @@ namespace DP3 {
       // When processed, it invokes the process function of the next step.
       virtual bool process (const DPBuffer&);
 
-      // Call the actual solver (called once per solution interval)
-      void doSolve();
+      // Call the actual solver (called once per solution interval) for the
+      // given buffer set, using the given parallel solver.
+      void doSolve (uint bufferSet, uint solverIndex);
 
       // Initialize H5parm-file
       void initH5parm();
@@ -108,9 +128,25 @@ namespace DP3 {
 
     private:
       // Initialize solutions
-      void initializeScalarSolutions();
+      void initializeScalarSolutions (uint solIndex);
       
-      void initializeFullMatrixSolutions();
+      void initializeFullMatrixSolutions (uint solIndex);
+
+      // Add the constraints for one solver to itsConstraints.
+      void addConstraints (const ParameterSet&, const std::string& prefix);
+
+      // Get the solver for the given parallel solve.
+      MultiDirSolver& solver (uint solverIndex)
+        { return solverIndex==0 ? itsMultiDirSolver :
+                                  itsExtraSolvers[solverIndex-1]; }
+
+      // Solve the nSets buffer sets starting at firstSet concurrently,
+      // in a separate thread if asyncsolve is on.
+      // It first waits for the previous solve to finish.
+      void startSolve (uint firstSet, uint nSets);
+
+      // Wait until the running solve (if any) has finished.
+      void waitForSolve();
 
       // Convert itsDirections to a vector of strings like "[Patch1, Patch2]"
       // Used for setting source names.
@@ -119,6 +155,7 @@ namespace DP3 {
       //# Data members.
       DPInput*         itsInput;
       std::string      itsName;
+      // For each buffer set, itsSolInt buffers (index bufferSet*itsSolInt+t)
       vector<DPBuffer> itsBufs;
 
       bool             itsUseModelColumn;
@@ -126,9 +163,10 @@ namespace DP3 {
 
       // The time of the current buffer (in case of solint, average time)
       double           itsAvgTime;
+      // For each buffer set and timeslot, the data buffer
       std::vector<casacore::Complex*> itsDataPtrs;
 
-      // For each timeslot, a vector of nDir buffers
+      // For each buffer set and timeslot, a vector of nDir buffers
       std::vector<std::vector<casacore::Complex*> > itsModelDataPtrs;
 
       // For each time, for each channel block, a vector of size nAntennas * nDirections
@@ -149,13 +187,26 @@ namespace DP3 {
       uint             itsTimeStep;
       uint             itsSolInt;
       uint             itsStepInSolInt;
+      bool             itsAsyncSolve;
+      uint             itsNParallelSolves;
+      uint             itsNBufferSets;  // nparallelsolves, twice if asyncsolve
+      uint             itsBufferSet;    // buffer set being filled
+
+      // The solution interval held by a buffer set.
+      struct SolveInterval {
+        uint   nTimes;
+        uint   solIndex;
+        double avgTime;
+      };
+      vector<SolveInterval> itsIntervals;   // for each buffer set
       uint             itsNChan;
       vector<size_t>   itsChanBlockStart;    // For each channel block, the index in the channels at which this channel block starts
       vector<double>   itsChanBlockFreqs;
       vector<vector<string> > itsDirections; // For each direction, a vector of patches
+      // The constraints of all parallel solvers, one set after the other
       vector<casacore::CountedPtr<Constraint> > itsConstraints;
 
-      vector<double>   itsWeights;
+      vector<vector<double> > itsWeights;   // for each buffer set
 
       UVWFlagger       itsUVWFlagStep;
       ResultStep::ShPtr itsDataResultStep; // Result step for data after UV-flagging
@@ -166,16 +217,21 @@ namespace DP3 {
       NSTimer          itsTimerPredict;
       NSTimer          itsTimerSolve;
       NSTimer          itsTimerWrite;
+      NSTimer          itsTimerWaitSolve;
       double           itsCoreConstraint;
       double           itsSmoothnessConstraint;
       double           itsScreenCoreConstraint;
 
       MultiDirSolver   itsMultiDirSolver;
+      vector<MultiDirSolver> itsExtraSolvers; // for nparallelsolves > 1
       bool itsFullMatrixMinimalization;
       bool itsApproximateTEC;
       std::string itsStatFilename;
-			std::unique_ptr<ThreadPool> itsThreadPool;
+      ThreadPool::CoreUsage itsCoreUsage;
       std::unique_ptr<std::ofstream> itsStatStream;
+      // The running asynchronous solve; declared last, so that its
+      // destructor waits for the solve before other members are destroyed.
+      std::future<void> itsSolveFuture;
     };
 
   } //# end namespace
@@ -16,7 +16,12 @@ MultiDirSolver::MultiDirSolver() :
   _constraintAccuracy(1e-4),
   _stepSize(0.2),
   _detectStalling(true),
-  _phaseOnly(false)
+  _phaseOnly(false),
+  _llsSolverType(LLSSolverType::QR),
+  _useMomentum(false),
+  _workspaceNTimes(0),
+  _workspaceFullMatrix(false),
+  _workspaceLLSSolverType(LLSSolverType::QR)
 { }
 
 void MultiDirSolver::init(size_t nAntennas,
@@ -31,6 +36,57 @@ void MultiDirSolver::init(size_t nAntennas,
   _nChannelBlocks = nChannels;
   _ant1 = ant1;
   _ant2 = ant2;
+  _workspace.clear();
+}
+
+void MultiDirSolver::prepareWorkspace(size_t nTimes, bool fullMatrix)
+{
+  if(_workspace.size() == _nChannelBlocks && _workspaceNTimes == nTimes &&
+     _workspaceFullMatrix == fullMatrix &&
+     _workspaceLLSSolverType == _llsSolverType)
+    return;
+  _workspace.resize(_nChannelBlocks);
+  _workspaceNTimes = nTimes;
+  _workspaceFullMatrix = fullMatrix;
+  _workspaceLLSSolverType = _llsSolverType;
+  for(size_t chBlock=0; chBlock!=_nChannelBlocks; ++chBlock)
+  {
+    const size_t
+      channelIndexStart = chBlock * _nChannels / _nChannelBlocks,
+      channelIndexEnd = (chBlock+1) * _nChannels / _nChannelBlocks,
+      curChannelBlockSize = channelIndexEnd - channelIndexStart;
+    // Scalar: model matrix [N x D] and visibility vector [N x 1]
+    // Full matrix: model matrix [2N x 2D] and visibility matrix [2N x 2]
+    // Also space for the auto correlation is reserved, but they will be set to 0.
+    size_t m, n, nrhs;
+    if(fullMatrix)
+    {
+      m = _nAntennas * nTimes * curChannelBlockSize * 2;
+      n = _nDirections * 2;
+      nrhs = 2;
+    }
+    else {
+      m = _nAntennas * nTimes * curChannelBlockSize * 4;
+      n = _nDirections;
+      nrhs = 1;
+    }
+    ChannelBlockWorkspace& workspace = _workspace[chBlock];
+    if(_llsSolverType == LLSSolverType::NormalEquations)
+    {
+      // Normal matrix [D x D] and right hand side [D x 1] (or 2D and 2)
+      workspace.gTimesCs.assign(_nAntennas, Matrix(n, n));
+      workspace.vs.assign(_nAntennas, Matrix(n, nrhs));
+      workspace.gTimesCs.shrink_to_fit();
+      workspace.vs.shrink_to_fit();
+      workspace.solver = QRSolver();
+      workspace.normalSolver = NormalEquationsSolver(n, nrhs);
+    }
+    else {
+      workspace.gTimesCs.assign(_nAntennas, Matrix(m, n));
+      workspace.vs.assign(_nAntennas, Matrix(std::max(m, n), nrhs));
+      workspace.solver = QRSolver(m, n, nrhs);
+    }
+  }
 }
 
 void MultiDirSolver::makeStep(const std::vector<std::vector<DComplex> >& solutions,
@@ -61,6 +117,31 @@ void MultiDirSolver::makeStep(const std::vector<std::vector<DComplex> >& solutio
   }
 }
 
+void MultiDirSolver::extrapolate(std::vector<std::vector<DComplex> >& solutions,
+  std::vector<std::vector<DComplex> >& previousSolutions,
+  size_t& momentumIteration) const
+{
+  // y_k = x_k + (k-1)/(k+2) (x_k - x_{k-1}), with k counted from the
+  // last restart. The new x_k is kept for the next extrapolation.
+  if(momentumIteration >= 2)
+  {
+    const double beta = double(momentumIteration-1) / (momentumIteration+2);
+    for(size_t chBlock=0; chBlock<_nChannelBlocks; ++chBlock)
+    {
+      for(size_t i=0; i!=solutions[chBlock].size(); ++i)
+      {
+        const DComplex x = solutions[chBlock][i];
+        solutions[chBlock][i] = x + beta * (x - previousSolutions[chBlock][i]);
+        previousSolutions[chBlock][i] = x;
+      }
+    }
+  }
+  else {
+    previousSolutions = solutions;
+  }
+  ++momentumIteration;
+}
+
 void MultiDirSolver::makeSolutionsFinite(std::vector<std::vector<DComplex> >& solutions, size_t perPol) const
 {
   for(std::vector<DComplex>& solVector : solutions)
@@ -196,29 +277,10 @@ MultiDirSolver::SolveResult MultiDirSolver::processScalar(std::vector<Complex *>
   
   // Model matrix ant x [N x D] and visibility vector ant x [N x 1],
   // for each channelblock
-  // The following loop allocates all structures
-  std::vector<std::vector<Matrix> > gTimesCs(_nChannelBlocks);
-  std::vector<std::vector<Matrix> > vs(_nChannelBlocks);
+  prepareWorkspace(nTimes, false);
   for(size_t chBlock=0; chBlock!=_nChannelBlocks; ++chBlock)
   {
     nextSolutions[chBlock].resize(_nDirections * _nAntennas);
-    const size_t
-      channelIndexStart = chBlock * _nChannels / _nChannelBlocks,
-      channelIndexEnd = (chBlock+1) * _nChannels / _nChannelBlocks,
-      curChannelBlockSize = channelIndexEnd - channelIndexStart;
-    gTimesCs[chBlock].resize(_nAntennas);
-    vs[chBlock].resize(_nAntennas);
-    
-    for(size_t ant=0; ant!=_nAntennas; ++ant)
-    {
-      // Model matrix [N x D] and visibility vector [N x 1]
-      // Also space for the auto correlation is reserved, but they will be set to 0.
-      size_t
-        m = _nAntennas * nTimes * curChannelBlockSize * 4,
-        n = _nDirections, nrhs = 1;
-      gTimesCs[chBlock][ant] = Matrix(m, n);
-      vs[chBlock][ant] = Matrix(std::max(m, n), nrhs);
-    }
   }
   
   ///
@@ -234,15 +296,28 @@ MultiDirSolver::SolveResult MultiDirSolver::processScalar(std::vector<Complex *>
   std::vector<double> stepMagnitudes;
   stepMagnitudes.reserve(_maxIterations);
 
+  std::vector<std::vector<DComplex> > previousSolutions;
+  size_t momentumIteration = 0;
+
   do {
     makeSolutionsFinite(solutions, 1);
+    if(_useMomentum)
+      extrapolate(solutions, previousSolutions, momentumIteration);
     
 #pragma omp parallel for
     for(size_t chBlock=0; chBlock<_nChannelBlocks; ++chBlock)
     {
-      performScalarIteration(chBlock, gTimesCs[chBlock], vs[chBlock],
-                            solutions[chBlock], nextSolutions[chBlock],
-                            data, modelData);
+      ChannelBlockWorkspace& workspace = _workspace[chBlock];
+      if(_llsSolverType == LLSSolverType::NormalEquations)
+        performScalarIterationNormalEquations(chBlock, workspace.gTimesCs, workspace.vs,
+                              workspace.normalSolver,
+                              solutions[chBlock], nextSolutions[chBlock],
+                              data, modelData);
+      else
+        performScalarIteration(chBlock, workspace.gTimesCs, workspace.vs,
+                              workspace.solver,
+                              solutions[chBlock], nextSolutions[chBlock],
+                              data, modelData);
     }
       
     makeStep(solutions, nextSolutions);
@@ -271,6 +346,10 @@ MultiDirSolver::SolveResult MultiDirSolver::processScalar(std::vector<Complex *>
     
     double avgSquaredDiff;
     hasConverged = assignSolutions<1>(solutions, nextSolutions, !constraintsSatisfied, avgSquaredDiff, stepMagnitudes);
+    // Restart the momentum when it did not help.
+    if(stepMagnitudes.size() >= 2 &&
+       stepMagnitudes.back() > stepMagnitudes[stepMagnitudes.size()-2])
+      momentumIteration = 0;
     if(statStream)
     {
       (*statStream) << stepMagnitudes.back() << '\t' << avgSquaredDiff << '\n';
@@ -297,6 +376,7 @@ MultiDirSolver::SolveResult MultiDirSolver::processScalar(std::vector<Complex *>
 void MultiDirSolver::performScalarIteration(size_t channelBlockIndex,
                        std::vector<Matrix>& gTimesCs,
                        std::vector<Matrix>& vs,
+                       QRSolver& solver,
                        const std::vector<DComplex>& solutions,
                        std::vector<DComplex>& nextSolutions,
                        const std::vector<Complex *>& data,
@@ -315,9 +395,9 @@ void MultiDirSolver::performScalarIteration(size_t channelBlockIndex,
     nTimes = data.size();
   
   // The following loop fills the matrices for all antennas
+  std::vector<const Complex*> modelPtrs(_nDirections);
   for(size_t timeIndex=0; timeIndex!=nTimes; ++timeIndex)
   {
-    std::vector<const Complex*> modelPtrs(_nDirections);
     for(size_t baseline=0; baseline!=_ant1.size(); ++baseline)
     {
       size_t antenna1 = _ant1[baseline];
@@ -362,9 +442,6 @@ void MultiDirSolver::performScalarIteration(size_t channelBlockIndex,
   
   // The matrices have been filled; compute the linear solution
   // for each antenna.
-  size_t m = _nAntennas * nTimes * curChannelBlockSize * 4;
-  size_t n = _nDirections, nrhs = 1;
-  QRSolver solver(m, n, nrhs);
   for(size_t ant=0; ant!=_nAntennas; ++ant) {
     // solve x^H in [g C] x^H  = v
     bool success = solver.Solve(gTimesCs[ant].data(), vs[ant].data());
@@ -381,6 +458,97 @@ void MultiDirSolver::performScalarIteration(size_t channelBlockIndex,
   }
 }
 
+void MultiDirSolver::addToNormalEquations(Matrix& normalMatrix, Matrix& rhs,
+                                          const DComplex* row, size_t n,
+                                          const DComplex* rowRhs, size_t nrhs)
+{
+  for(size_t j=0; j!=n; ++j)
+  {
+    for(size_t i=0; i<=j; ++i)
+      normalMatrix(i, j) += std::conj(row[i]) * row[j];
+  }
+  for(size_t c=0; c!=nrhs; ++c)
+  {
+    for(size_t i=0; i!=n; ++i)
+      rhs(i, c) += std::conj(row[i]) * rowRhs[c];
+  }
+}
+
+void MultiDirSolver::performScalarIterationNormalEquations(size_t channelBlockIndex,
+                       std::vector<Matrix>& normalMatrices,
+                       std::vector<Matrix>& rhs,
+                       NormalEquationsSolver& solver,
+                       const std::vector<DComplex>& solutions,
+                       std::vector<DComplex>& nextSolutions,
+                       const std::vector<Complex *>& data,
+                       const std::vector<std::vector<Complex *> >& modelData)
+{
+  for(size_t ant=0; ant!=_nAntennas; ++ant)
+  {
+    normalMatrices[ant].zeros();
+    rhs[ant].zeros();
+  }
+  
+  const size_t
+    channelIndexStart = channelBlockIndex * _nChannels / _nChannelBlocks,
+    channelIndexEnd = (channelBlockIndex+1) * _nChannels / _nChannelBlocks,
+    nTimes = data.size();
+  
+  // The rows of the systems of performScalarIteration() are added to the
+  // normal equations directly, so the large matrices are never formed.
+  std::vector<const Complex*> modelPtrs(_nDirections);
+  std::vector<DComplex> row1(_nDirections), row2(_nDirections);
+  for(size_t timeIndex=0; timeIndex!=nTimes; ++timeIndex)
+  {
+    for(size_t baseline=0; baseline!=_ant1.size(); ++baseline)
+    {
+      size_t antenna1 = _ant1[baseline];
+      size_t antenna2 = _ant2[baseline];
+      if(antenna1 != antenna2)
+      {
+        for(size_t d=0; d!=_nDirections; ++d)
+          modelPtrs[d] = modelData[timeIndex][d] + (channelIndexStart + baseline * _nChannels) * 4;
+        const Complex* dataPtr = data[timeIndex] + (channelIndexStart + baseline * _nChannels) * 4;
+        for(size_t ch=channelIndexStart; ch!=channelIndexEnd; ++ch)
+        {
+          for(size_t p=0; p!=4; ++p)
+          {
+            for(size_t d=0; d!=_nDirections; ++d)
+            {
+              std::complex<double> predicted = *modelPtrs[d];
+              row2[d] = std::conj(solutions[antenna1*_nDirections + d] * predicted);
+              row1[d] = std::conj(solutions[antenna2*_nDirections + d]) * predicted;
+              ++modelPtrs[d]; // Goto the next polarization of this 2x2 matrix.
+            }
+            const DComplex v = *dataPtr, vConj = std::conj(v);
+            addToNormalEquations(normalMatrices[antenna1], rhs[antenna1],
+                                 row1.data(), _nDirections, &v, 1);
+            addToNormalEquations(normalMatrices[antenna2], rhs[antenna2],
+                                 row2.data(), _nDirections, &vConj, 1);
+            ++dataPtr; // Goto the next polarization of this 2x2 matrix.
+          }
+        }
+      }
+    }
+  }
+  
+  // The normal equations have been filled; compute the linear solution
+  // for each antenna.
+  for(size_t ant=0; ant!=_nAntennas; ++ant) {
+    bool success = solver.Solve(normalMatrices[ant].data(), rhs[ant].data());
+    Matrix& x = rhs[ant];
+    if(success && x(0, 0) != 0.)
+    {
+      for(size_t d=0; d!=_nDirections; ++d)
+        nextSolutions[ant*_nDirections + d] = x(d, 0);
+    }
+    else {
+      for(size_t d=0; d!=_nDirections; ++d)
+        nextSolutions[ant*_nDirections + d] = std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+}
+
 MultiDirSolver::SolveResult MultiDirSolver::processFullMatrix(std::vector<Complex *>& data,
   std::vector<std::vector<Complex *> >& modelData,
   std::vector<std::vector<DComplex> >& solutions, double time,
@@ -436,28 +604,10 @@ MultiDirSolver::SolveResult MultiDirSolver::processFullMatrix(std::vector<Comple
   
   // Dimensions for each channelblock:
   // Model matrix ant x [2N x 2D] and visibility matrix ant x [2N x 2],
-  // The following loop allocates all structures
-  std::vector<std::vector<Matrix> > gTimesCs(_nChannelBlocks);
-  std::vector<std::vector<Matrix> > vs(_nChannelBlocks);
+  prepareWorkspace(nTimes, true);
   for(size_t chBlock=0; chBlock!=_nChannelBlocks; ++chBlock)
   {
     nextSolutions[chBlock].resize(_nDirections * _nAntennas * 4);
-    const size_t
-      channelIndexStart = chBlock * _nChannels / _nChannelBlocks,
-      channelIndexEnd = (chBlock+1) * _nChannels / _nChannelBlocks,
-      curChannelBlockSize = channelIndexEnd - channelIndexStart;
-    gTimesCs[chBlock].resize(_nAntennas);
-    vs[chBlock].resize(_nAntennas);
-    
-    for(size_t ant=0; ant!=_nAntennas; ++ant)
-    {
-      // Model matrix [2N x 2D] and visibility matrix [2N x 2]
-      // Also space for the auto correlation is reserved, but they will be set to 0.
-      size_t m = _nAntennas * nTimes * curChannelBlockSize * 2;
-      size_t n = _nDirections * 2, nrhs = 2;
-      gTimesCs[chBlock][ant] = Matrix(m, n);
-      vs[chBlock][ant] = Matrix(std::max(n, m), nrhs);
-    }
   }
   
   ///
@@ -472,15 +622,28 @@ MultiDirSolver::SolveResult MultiDirSolver::processFullMatrix(std::vector<Comple
   std::vector<double> step_magnitudes;
   step_magnitudes.reserve(_maxIterations);
 
+  std::vector<std::vector<DComplex> > previousSolutions;
+  size_t momentumIteration = 0;
+
   do {
     makeSolutionsFinite(solutions, 4);
+    if(_useMomentum)
+      extrapolate(solutions, previousSolutions, momentumIteration);
     
 #pragma omp parallel for
     for(size_t chBlock=0; chBlock<_nChannelBlocks; ++chBlock)
     {
-      performFullMatrixIteration(chBlock, gTimesCs[chBlock], vs[chBlock],
-                                solutions[chBlock], nextSolutions[chBlock],
-                                data, modelData);
+      ChannelBlockWorkspace& workspace = _workspace[chBlock];
+      if(_llsSolverType == LLSSolverType::NormalEquations)
+        performFullMatrixIterationNormalEquations(chBlock, workspace.gTimesCs, workspace.vs,
+                                  workspace.normalSolver,
+                                  solutions[chBlock], nextSolutions[chBlock],
+                                  data, modelData);
+      else
+        performFullMatrixIteration(chBlock, workspace.gTimesCs, workspace.vs,
+                                  workspace.solver,
+                                  solutions[chBlock], nextSolutions[chBlock],
+                                  data, modelData);
     }
       
     makeStep(solutions, nextSolutions);
@@ -503,6 +666,10 @@ MultiDirSolver::SolveResult MultiDirSolver::processFullMatrix(std::vector<Comple
     
     double avgSquaredDiff;
     hasConverged = assignSolutions<4>(solutions, nextSolutions, !constraintsSatisfied, avgSquaredDiff, step_magnitudes);
+    // Restart the momentum when it did not help.
+    if(step_magnitudes.size() >= 2 &&
+       step_magnitudes.back() > step_magnitudes[step_magnitudes.size()-2])
+      momentumIteration = 0;
     if(statStream)
     {
       (*statStream) << step_magnitudes.back() << '\t' << avgSquaredDiff << '\n';
@@ -539,6 +706,7 @@ bool MultiDirSolver::detectStall(size_t iteration, const std::vector<double>& st
 void MultiDirSolver::performFullMatrixIteration(size_t channelBlockIndex,
                              std::vector<Matrix>& gTimesCs,
                              std::vector<Matrix>& vs,
+                             QRSolver& solver,
                              const std::vector<DComplex>& solutions,
                              std::vector<DComplex>& nextSolutions,
                              const std::vector<Complex *>& data,
@@ -558,9 +726,9 @@ void MultiDirSolver::performFullMatrixIteration(size_t channelBlockIndex,
   
   // The following loop fills the matrices for all antennas
   _timerFillMatrices.Start();
+  std::vector<const Complex*> modelPtrs(_nDirections);
   for(size_t timeIndex=0; timeIndex!=nTimes; ++timeIndex)
   {
-    std::vector<const Complex*> modelPtrs(_nDirections);
     for(size_t baseline=0; baseline!=_ant1.size(); ++baseline)
     {
       size_t antenna1 = _ant1[baseline];
@@ -625,10 +793,6 @@ void MultiDirSolver::performFullMatrixIteration(size_t channelBlockIndex,
   // for each antenna.
   _timerSolve.Start();
 
-  size_t m = _nAntennas * nTimes * curChannelBlockSize * 2;
-  size_t n = _nDirections * 2, nrhs = 2;
-  QRSolver solver(m, n, nrhs);
-
   for(size_t ant=0; ant!=_nAntennas; ++ant) {
     // solve x^H in [g C] x^H  = v
     bool success = solver.Solve(gTimesCs[ant].data(), vs[ant].data());
@@ -652,6 +816,103 @@ void MultiDirSolver::performFullMatrixIteration(size_t channelBlockIndex,
   _timerSolve.Pause();
 }
 
+void MultiDirSolver::performFullMatrixIterationNormalEquations(size_t channelBlockIndex,
+                             std::vector<Matrix>& normalMatrices,
+                             std::vector<Matrix>& rhs,
+                             NormalEquationsSolver& solver,
+                             const std::vector<DComplex>& solutions,
+                             std::vector<DComplex>& nextSolutions,
+                             const std::vector<Complex *>& data,
+                             const std::vector<std::vector<Complex *> >& modelData)
+{
+  for(size_t ant=0; ant!=_nAntennas; ++ant)
+  {
+    normalMatrices[ant].zeros();
+    rhs[ant].zeros();
+  }
+  
+  const size_t
+    channelIndexStart = channelBlockIndex * _nChannels / _nChannelBlocks,
+    channelIndexEnd = (channelBlockIndex+1) * _nChannels / _nChannelBlocks,
+    nTimes = data.size(),
+    n = _nDirections * 2;
+  
+  // Each visibility gives two rows of the [2N x 2D] systems of
+  // performFullMatrixIteration() for both antennas; these are added to
+  // the normal equations directly.
+  std::vector<const Complex*> modelPtrs(_nDirections);
+  std::vector<DComplex> rows1(n*2), rows2(n*2);
+  for(size_t timeIndex=0; timeIndex!=nTimes; ++timeIndex)
+  {
+    for(size_t baseline=0; baseline!=_ant1.size(); ++baseline)
+    {
+      size_t antenna1 = _ant1[baseline];
+      size_t antenna2 = _ant2[baseline];
+      if(antenna1 != antenna2)
+      {
+        for(size_t d=0; d!=_nDirections; ++d)
+          modelPtrs[d] = modelData[timeIndex][d] + (channelIndexStart + baseline * _nChannels) * 4;
+        const Complex* dataPtr = data[timeIndex] + (channelIndexStart + baseline * _nChannels) * 4;
+        for(size_t ch=channelIndexStart; ch!=channelIndexEnd; ++ch)
+        {
+          for(size_t d=0; d!=_nDirections; ++d)
+          {
+            MC2x2
+              modelMat(modelPtrs[d]),
+              gTimesC1Mat, gTimesC2Mat;
+            size_t solIndex1 = (antenna1*_nDirections + d) * 4;
+            size_t solIndex2 = (antenna2*_nDirections + d) * 4;
+            Matrix2x2::ATimesB(gTimesC2Mat.Data(), &solutions[solIndex1], modelMat.Data());
+            Matrix2x2::ATimesHermB(gTimesC1Mat.Data(), &solutions[solIndex2], modelMat.Data());
+            // Row i of the 2x2 block of this direction.
+            for(size_t p=0; p!=4; ++p)
+            {
+              rows2[(p/2)*n + d*2+p%2] = gTimesC2Mat[p];
+              rows1[(p/2)*n + d*2+p%2] = gTimesC1Mat[p];
+            }
+            
+            modelPtrs[d] += 4; // Goto the next 2x2 matrix.
+          }
+          const DComplex
+            v1[4] = { std::conj(dataPtr[0]), std::conj(dataPtr[2]),
+                      std::conj(dataPtr[1]), std::conj(dataPtr[3]) },
+            v2[4] = { dataPtr[0], dataPtr[1], dataPtr[2], dataPtr[3] };
+          for(size_t i=0; i!=2; ++i)
+          {
+            addToNormalEquations(normalMatrices[antenna1], rhs[antenna1],
+                                 &rows1[i*n], n, &v1[i*2], 2);
+            addToNormalEquations(normalMatrices[antenna2], rhs[antenna2],
+                                 &rows2[i*n], n, &v2[i*2], 2);
+          }
+          dataPtr += 4; // Goto the next 2x2 matrix.
+        }
+      }
+    }
+  }
+  
+  // The normal equations have been filled; compute the linear solution
+  // for each antenna.
+  for(size_t ant=0; ant!=_nAntennas; ++ant) {
+    bool success = solver.Solve(normalMatrices[ant].data(), rhs[ant].data());
+    Matrix& x = rhs[ant];
+    if(success && x(0, 0) != 0.)
+    {
+      for(size_t d=0; d!=_nDirections; ++d)
+      {
+        for(size_t p=0; p!=4; ++p) {
+          // The conj transpose is also performed at this point (note swap of % and /)
+          nextSolutions[(ant*_nDirections + d)*4 + p] = std::conj(x(d*2+p%2, p/2));
+        }
+      }
+    }
+    else {
+      for(size_t i=0; i!=_nDirections*4; ++i) {
+        nextSolutions[ant*_nDirections*4 + i] = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+  }
+}
+
 void MultiDirSolver::showTimings (std::ostream& os, double duration) const {
   //os << "                " << std::fixed << std::setprecision(2) << _timerSolve.Seconds()/duration << "% spent in solve" << std::endl;
   //os << "                " << std::fixed << std::setprecision(2) << _timerFillMatrices.Seconds()/duration << "% spent in filling matrices" << std::endl;
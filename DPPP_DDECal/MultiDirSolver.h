@@ -8,6 +8,8 @@
 #endif
 
 #include "Constraint.h"
+#include "NormalEquationsSolver.h"
+#include "QRSolver.h"
 #include "Stopwatch.h"
 
 #include <complex>
@@ -39,6 +41,15 @@ public:
   };
 
   
+  /**
+   * How the linear least squares problem of an iteration is solved.
+   * QR solves the full system per antenna with a QR decomposition.
+   * NormalEquations accumulates the small normal matrix while going
+   * over the data and solves it with a Cholesky decomposition; its
+   * cost per iteration does not grow with the matrix size of QR.
+   */
+  enum class LLSSolverType { QR, NormalEquations };
+
   struct SolveResult {
     size_t iterations, constraintIterations;
     std::vector<std::vector<Constraint::Result> > _results;
@@ -71,7 +82,11 @@ public:
   
   void set_phase_only(bool phaseOnly) { _phaseOnly = phaseOnly; }
   
-  void set_channel_blocks(size_t nChannelBlocks) { _nChannelBlocks = nChannelBlocks; }
+  void set_channel_blocks(size_t nChannelBlocks)
+  {
+    _nChannelBlocks = nChannelBlocks;
+    _workspace.clear();
+  }
   
   size_t max_iterations() const { return _maxIterations; }
   void set_max_iterations(size_t maxIterations) { _maxIterations = maxIterations; }
@@ -89,31 +104,111 @@ public:
   void set_detect_stalling(bool detectStalling) { _detectStalling = detectStalling; }
 
   bool get_detect_stalling() const { return _detectStalling; }
+
+  void set_lls_solver_type(LLSSolverType llsSolverType)
+  {
+    _llsSolverType = llsSolverType;
+    _workspace.clear();
+  }
+  LLSSolverType get_lls_solver_type() const { return _llsSolverType; }
+
+  /**
+   * Enable Nesterov momentum: before each iteration the solutions are
+   * extrapolated along the difference with those of the previous
+   * iteration. The momentum is restarted when the step magnitude grows,
+   * e.g. when a constraint moved the extrapolated solutions back.
+   */
+  void set_use_momentum(bool useMomentum) { _useMomentum = useMomentum; }
+  bool get_use_momentum() const { return _useMomentum; }
   
   void add_constraint(Constraint* constraint) { _constraints.push_back(constraint); }
   
   void showTimings (std::ostream& os, double duration) const;
 
 private:
+  /**
+   * The matrices and linear solver of one channel block. They are kept
+   * between solves, so that the iterations do not allocate memory.
+   */
+  struct ChannelBlockWorkspace
+  {
+    // Model matrix and visibility vector for each antenna. For the normal
+    // equations, these are the normal matrix and right hand side.
+    std::vector<Matrix> gTimesCs, vs;
+    QRSolver solver;
+    NormalEquationsSolver normalSolver;
+  };
+
+  /**
+   * Make sure the workspace has the sizes for a solve of nTimes timesteps.
+   * It is only reallocated when the sizes change, which normally only
+   * happens for the first and for a final shorter solution interval.
+   */
+  void prepareWorkspace(size_t nTimes, bool fullMatrix);
+
   void performScalarIteration(size_t channelBlockIndex,
                              std::vector<Matrix>& gTimesCs,
                              std::vector<Matrix>& vs,
+                             QRSolver& solver,
                              const std::vector<DComplex>& solutions,
                              std::vector<DComplex>& nextSolutions,
                              const std::vector<Complex *>& data,
                              const std::vector<std::vector<Complex *> >& modelData);
                              
+  /**
+   * Same as performScalarIteration(), but accumulates and solves the
+   * normal equations.
+   */
+  void performScalarIterationNormalEquations(size_t channelBlockIndex,
+                             std::vector<Matrix>& normalMatrices,
+                             std::vector<Matrix>& rhs,
+                             NormalEquationsSolver& solver,
+                             const std::vector<DComplex>& solutions,
+                             std::vector<DComplex>& nextSolutions,
+                             const std::vector<Complex *>& data,
+                             const std::vector<std::vector<Complex *> >& modelData);
+
   void performFullMatrixIteration(size_t channelBlockIndex,
                              std::vector<Matrix>& gTimesCs,
                              std::vector<Matrix>& vs,
+                             QRSolver& solver,
+                             const std::vector<DComplex>& solutions,
+                             std::vector<DComplex>& nextSolutions,
+                             const std::vector<Complex *>& data,
+                             const std::vector<std::vector<Complex *> >& modelData);
+
+  /**
+   * Same as performFullMatrixIteration(), but accumulates and solves the
+   * normal equations.
+   */
+  void performFullMatrixIterationNormalEquations(size_t channelBlockIndex,
+                             std::vector<Matrix>& normalMatrices,
+                             std::vector<Matrix>& rhs,
+                             NormalEquationsSolver& solver,
                              const std::vector<DComplex>& solutions,
                              std::vector<DComplex>& nextSolutions,
                              const std::vector<Complex *>& data,
                              const std::vector<std::vector<Complex *> >& modelData);
 
+  /**
+   * Add the row of a linear system to the upper triangle of its normal
+   * matrix and to its right hand side.
+   */
+  static void addToNormalEquations(Matrix& normalMatrix, Matrix& rhs,
+                                   const DComplex* row, size_t n,
+                                   const DComplex* rowRhs, size_t nrhs);
+
   void makeStep(const std::vector<std::vector<DComplex> >& solutions,
     std::vector<std::vector<DComplex> >& nextSolutions) const;
 
+  /**
+   * Extrapolate the solutions with Nesterov momentum. momentumIteration
+   * counts the iterations since the last restart; it is incremented.
+   */
+  void extrapolate(std::vector<std::vector<DComplex> >& solutions,
+    std::vector<std::vector<DComplex> >& previousSolutions,
+    size_t& momentumIteration) const;
+
   bool detectStall(size_t iteration, const std::vector<double>& stepMagnitudes) const;
                 
   void makeSolutionsFinite(std::vector<std::vector<DComplex> >& solutions, size_t perPol) const;
@@ -140,8 +235,16 @@ private:
   double _stepSize;
   bool _detectStalling;
   bool _phaseOnly;
+  LLSSolverType _llsSolverType;
+  bool _useMomentum;
   std::vector<Constraint*> _constraints;
 
+  // Solver workspace for each channel block
+  std::vector<ChannelBlockWorkspace> _workspace;
+  size_t _workspaceNTimes;
+  bool _workspaceFullMatrix;
+  LLSSolverType _workspaceLLSSolverType;
+
   // Timers
   Stopwatch _timerSolve;
   Stopwatch _timerConstrain;
@@ -0,0 +1,60 @@
+#ifndef NORMAL_EQUATIONS_SOLVER_H
+#define NORMAL_EQUATIONS_SOLVER_H
+
+#include <complex>
+
+typedef std::complex<double> dcomplex;
+
+/* ZPOTRF and ZPOTRS prototypes */
+extern "C" void zpotrf_(char* uplo, int* n, dcomplex* a, int* lda, int* info);
+extern "C" void zpotrs_(char* uplo, int* n, int* nrhs, dcomplex* a,
+  int* lda, dcomplex* b, int* ldb, int* info);
+
+/**
+ * Solves a linear least squares problem from its normal equations.
+ *
+ * Instead of the tall M x N system A*X = B (see QRSolver), the caller
+ * accumulates the N x N matrix A^H A and the N x NRHS matrix A^H B,
+ * which are solved with a Cholesky factorisation. The cost of the solve
+ * is independent of M, but the condition number is squared, so it should
+ * only be used for well-conditioned problems.
+ */
+class NormalEquationsSolver
+{
+public:
+  NormalEquationsSolver() :
+    _n(0), _nrhs(0)
+  { }
+  
+  NormalEquationsSolver(int n, int nrhs) :
+    _n(n), _nrhs(nrhs)
+  { }
+  
+  /**
+   * Find X that solves (A^H A) X = A^H B.
+   * Inputs are ordered column-major.
+   * @param ata The N-by-N matrix A^H A; only its upper triangle is used.
+   * It is overwritten by its Cholesky factor.
+   * @param atb On entry: the N-by-NRHS matrix A^H B.
+   * On succesful exit: the solution vectors, stored columnwise (N, NRHS)
+   * @returns false if A^H A is not positive definite (e.g. A is not of full rank).
+   */
+  bool Solve(dcomplex* ata, dcomplex* atb)
+  {
+    int info;
+    char uplo = 'U';
+    zpotrf_(&uplo, &_n, ata, &_n, &info);
+    if(info != 0)
+      return false;
+    zpotrs_(&uplo, &_n, &_nrhs, ata, &_n, atb, &_n, &info);
+    return info == 0;
+  }
+private:
+  /** Number of unknowns: rows and cols of A^H A */
+  int _n;
+  
+  /** Number of columns in matrices A^H B and X */
+  int _nrhs;
+};
+
+#endif
@@ -14,6 +14,10 @@ extern "C" void zgels_(char* trans, int* m, int* n, int* nrhs, dcomplex* a,
 class QRSolver
 {
 public:
+  QRSolver() :
+    _m(0), _n(0), _nrhs(0)
+  { }
+  
   QRSolver(int m, int n, int nrhs) :
     _m(m), _n(n), _nrhs(nrhs)
   { }
@@ -24,6 +28,9 @@ public:
    * @param a The M-by-N matrix A
    * @param b On entry: input matrix of size M x NRHS, but with leading dimension max(M, N)
    * On succesful exit: the solution vectors, stored columnwise (N, NRHS)
+   * The LAPACK workspace is allocated at the first call and reused
+   * by later calls, so the same solver should be used for systems of
+   * equal size.
    */
   bool Solve(dcomplex* a, dcomplex* b)
   {
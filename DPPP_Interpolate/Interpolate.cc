@@ -2,6 +2,7 @@
 #include "buffered_lane.h"
 
 #include "../DPPP/DPBuffer.h"
+#include "../DPPP/DPBufferPool.h"
 #include "../DPPP/DPInfo.h"
 #include "../DPPP/DPRun.h"
 
@@ -76,9 +77,9 @@ void Interpolate::showTimings(std::ostream& os, double duration) const
 bool Interpolate::process(const DPBuffer& buf)
 {
 	_timer.start();
-	// Collect the data in buffers.
-	_buffers.emplace_back();
-	_buffers.back().copy(buf);
+	// Collect the data in buffers. The arrays come from the buffer pool, so
+	// those of buffers that were sent on are reused instead of reallocated.
+	_buffers.emplace_back(DPBufferPool::instance().copy(buf));
 	// If we have a full window of data, interpolate everything
 	// up to the middle of the window
 	if(_buffers.size() >= _windowSize)